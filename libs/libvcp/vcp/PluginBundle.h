@@ -32,15 +32,26 @@ public:
 
     bool isOpen() const { return libraryOpen; }
 
+    /** Returns the bundle directory */
+    const String& getBundlePath() const { return bundlePath; }
+
+    /** Returns the binary inside the bundle */
+    File getLibraryFile() const
+    {
+        const File bundle (bundlePath);
+        return bundle.getChildFile (bundle.getFileNameWithoutExtension() + binaryExtension());
+    }
+
+    /** Descriptors of an open bundle */
+    int getNumDescriptors() const { return descriptors.size(); }
+    const VCPDescriptor* getDescriptorAt (int index) const { return descriptors [index]; }
+
     bool open()
     {
         close();
         if (! libraryOpen)
         {
-            File libraryFile (bundlePath);
-            String fileName = libraryFile.getFileNameWithoutExtension(); 
-            fileName << binaryExtension();
-            libraryFile = libraryFile.getChildFile (fileName);
+            const auto libraryFile = getLibraryFile();
             libraryOpen = library.open (libraryFile.getFullPathName().toRawUTF8());
             if (libraryOpen)
             {
@@ -65,6 +76,7 @@ public:
             return;
         libraryOpen = false;
         descriptors.clearQuick();
+        descriptorFunction = nullptr;
         library.close();
     }
 
@@ -91,7 +103,7 @@ protected:
 private:
     const String bundlePath;
     DynamicLibrary library;
-    bool libraryOpen;
+    bool libraryOpen = false;
     Array<const VCPDescriptor*> descriptors;
     DescriptorFunction descriptorFunction = nullptr;
 
@@ -21,6 +21,30 @@ public:
         handle = nullptr;
     }
 
+    /** Returns the plugin's identifier */
+    const char* getIdentifier() const   { return desc.ID; }
+
+    /** Returns the handle to pass to extension callbacks */
+    VCPHandle getHandle() const         { return handle; }
+
+    /** Returns extension data or nullptr if not supported */
+    const void* getExtension (const char* identifier) const
+    {
+        return desc.extension != nullptr ? desc.extension (identifier) : nullptr;
+    }
+
+    /** Returns the processor extension if the plugin provides a version this
+        host understands */
+    const VCPProcessor* getProcessor() const
+    {
+        auto* processor = static_cast<const VCPProcessor*> (getExtension (VCP_PROCESSOR_URI));
+        if (processor == nullptr || processor->version < 1 || processor->version > VCP_PROCESSOR_VERSION)
+            return nullptr;
+        if (processor->process == nullptr)
+            return nullptr;
+        return processor;
+    }
+
 private:
     const VCPDescriptor desc;
     VCPHandle handle;
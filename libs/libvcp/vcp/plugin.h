@@ -53,6 +53,87 @@ typedef struct _VCPDescriptor {
     const void * (*extension)(const char * identifier);
 } VCPDescriptor;
 
+/** Extension for plugins which process or write samples while exporting. The
+    extension data is a VCPProcessor. Hosts must check the version field and
+    ignore processors with a version newer than they know */
+#define VCP_PROCESSOR_URI       VCP_PREFIX "#processor"
+#define VCP_PROCESSOR_VERSION   1
+
+/** Describes the sample a buffer belongs to */
+typedef struct _VCPSampleInfo {
+    /** Name of the sample without file extension */
+    const char* name;
+
+    /** Absolute path of the captured source file */
+    const char* source;
+
+    /** Root note and the key and velocity range it is mapped to */
+    int32_t note;
+    int32_t low_key;
+    int32_t high_key;
+    int32_t low_velocity;
+    int32_t high_velocity;
+
+    double sample_rate;
+    int32_t num_channels;
+
+    /** Total length in frames */
+    int64_t num_frames;
+
+    /** Loop points in frames, -1 when the sample doesn't loop */
+    int64_t loop_start;
+    int64_t loop_end;
+} VCPSampleInfo;
+
+enum {
+    /** The buffer holds the first block of its sample */
+    VCP_BUFFER_FIRST    = 1 << 0,
+    /** The buffer holds the last block of its sample */
+    VCP_BUFFER_LAST     = 1 << 1
+};
+
+/** A block of non-interleaved audio. Channel data and info are owned by the
+    host, channels may be modified in place. Both are only valid during
+    process() */
+typedef struct _VCPBuffer {
+    const VCPSampleInfo* info;
+    float* const* channels;
+    int32_t num_channels;
+    int32_t num_frames;
+
+    /** Position of the first frame within the sample */
+    int64_t offset;
+    uint32_t flags;
+} VCPBuffer;
+
+/** Every export task uses its own instance, so calls on one handle never
+    overlap, but several instances may run on different threads at once.
+    A plugin with a file_extension gets every sample through one instance */
+typedef struct _VCPProcessor {
+    /** VCP_PROCESSOR_VERSION the plugin was built against */
+    uint32_t version;
+
+    /** Display name of the exporter */
+    const char* name;
+
+    /** File extension of what the plugin writes, e.g. ".xyz". When NULL the
+        plugin only processes audio and the host writes the results */
+    const char* file_extension;
+
+    /** Called before the first batch. target_path is the export directory
+        and max_frames the largest block passed to process(). Return
+        non-zero on failure */
+    int32_t (*prepare)(VCPHandle handle, const char* target_path, int32_t max_frames);
+
+    /** Processes a batch of buffers, at most one per sample. Samples in a
+        batch advance together, finished samples drop out of later batches.
+        Return non-zero on failure */
+    int32_t (*process)(VCPHandle handle, const VCPBuffer* buffers, uint32_t num_buffers);
+
+    /** Called after the last batch. Return non-zero on failure */
+    int32_t (*finish)(VCPHandle handle);
+} VCPProcessor;
+
 #ifdef __cplusplus
  #define VCP_SYMBOL_EXTERN extern "C"
 #else
@@ -1,11 +1,13 @@
 #include "vcp/plugin.h"
+#include <cmath>
 #include <iostream>
 
+/** Processes exported samples in place, applying a fixed gain */
 VCP_PLUGIN_CLASS (TestPlugin)
 {
 public:
     TestPlugin() {}
-    
+
     ~TestPlugin()
     {
         std::clog << "hi there" << std::endl;
@@ -18,25 +20,48 @@ public:
 
     static const void* extension (const char* ext)
     {
-        if (strcmp (ext, "com.versicap.Plugin") == 0)
+        if (strcmp (ext, VCP_PROCESSOR_URI) == 0)
         {
-            static VersicapDescriptor vcpdesc;
-            vcpdesc.testvcp     = &TestPlugin::_testVcp;
-            return &vcpdesc;
+            static VCPProcessor processor;
+            processor.version           = VCP_PROCESSOR_VERSION;
+            processor.name              = "Test Plugin";
+            processor.file_extension    = NULL;
+            processor.prepare           = &TestPlugin::_prepare;
+            processor.process           = &TestPlugin::_process;
+            processor.finish            = &TestPlugin::_finish;
+            return &processor;
         }
-        
+
         return nullptr;
     }
 
 private:
-    struct VersicapDescriptor
+    float gain = 1.f;
+
+    static int32_t _prepare (VCPHandle handle, const char* targetPath, int32_t maxFrames)
+    {
+        auto* plugin = static_cast<TestPlugin*> (handle);
+        plugin->gain = std::pow (10.f, -3.f / 20.f);
+        return 0;
+    }
+
+    static int32_t _process (VCPHandle handle, const VCPBuffer* buffers, uint32_t numBuffers)
     {
-        void (*testvcp)(VCPHandle handle);
-    };
+        auto* plugin = static_cast<TestPlugin*> (handle);
+        for (uint32_t i = 0; i < numBuffers; ++i)
+        {
+            const auto& buffer = buffers[i];
+            for (int32_t c = 0; c < buffer.num_channels; ++c)
+                for (int32_t f = 0; f < buffer.num_frames; ++f)
+                    buffer.channels[c][f] *= plugin->gain;
+        }
+        return 0;
+    }
 
-    static void _testVcp (VCPHandle handle) {
-        std::clog << "testVcp()\n";
+    static int32_t _finish (VCPHandle handle)
+    {
+        return 0;
     }
 };
 
-VCP_REGISTER_PLUGIN (TestPlugin, "com.versicap.TestPlugin", {});
+VCP_REGISTER_PLUGIN (TestPlugin, "com.versicap.TestPlugin", { VCP_PROCESSOR_URI });
@@ -0,0 +1,150 @@
+
+#include "vcp/PluginBundle.h"
+#include "BundleManager.h"
+
+namespace vcp {
+
+BundleManager::BundleManager() {}
+BundleManager::~BundleManager()
+{
+    bundles.clear (true);
+}
+
+void BundleManager::scan (const FileSearchPath& path, const File& cacheFile, bool force)
+{
+    ScopedLock sl (lock);
+    if (scanned && ! force)
+        return;
+
+    std::unique_ptr<XmlElement> cache;
+    if (! force && cacheFile.existsAsFile())
+        cache.reset (XmlDocument::parse (cacheFile));
+    XmlElement newCache ("bundles");
+
+    descriptions.clearQuick();
+    for (int i = 0; i < path.getNumPaths(); ++i)
+    {
+        Array<File> found;
+        path[i].findChildFiles (found, File::findDirectories, false, "*.vcp");
+        found.sort();
+        for (const auto& bundle : found)
+            scanBundle (bundle, cache.get(), newCache);
+    }
+
+    if (cacheFile != File())
+        newCache.writeToFile (cacheFile, String());
+
+    scanned = true;
+    DBG("[VCP] found " << descriptions.size() << " bundle plugin(s)");
+}
+
+void BundleManager::scanBundle (const File& bundleDir, const XmlElement* cache, XmlElement& newCache)
+{
+    PluginBundle probe (bundleDir.getFullPathName());
+    const auto libraryFile = probe.getLibraryFile();
+    if (! libraryFile.existsAsFile())
+        return;
+
+    const auto bundlePath = bundleDir.getFullPathName();
+    const auto modified = String (libraryFile.getLastModificationTime().toMilliseconds());
+
+    // unchanged bundles are restored without loading them
+    if (cache != nullptr)
+    {
+        forEachXmlChildElementWithTagName (*cache, e, "bundle")
+        {
+            if (e->getStringAttribute ("path") != bundlePath || e->getStringAttribute ("modified") != modified)
+                continue;
+
+            forEachXmlChildElementWithTagName (*e, p, "plugin")
+            {
+                Description desc;
+                desc.identifier     = p->getStringAttribute ("id");
+                desc.bundlePath     = bundlePath;
+                desc.name           = p->getStringAttribute ("name");
+                desc.fileExtension  = p->getStringAttribute ("extension");
+                desc.isProcessor    = p->getBoolAttribute ("processor");
+                descriptions.add (desc);
+            }
+
+            newCache.addChildElement (new XmlElement (*e));
+            return;
+        }
+    }
+
+    auto* bundle = getBundle (bundlePath);
+    if (bundle == nullptr)
+    {
+        DBG("[VCP] could not load bundle: " << bundlePath);
+        return;
+    }
+
+    String bundleName;
+    if (auto json = JSON::parse (bundleDir.getChildFile (bundleDir.getFileNameWithoutExtension() + ".json")))
+        bundleName = json.getProperty ("name", String()).toString();
+
+    auto* const element = newCache.createNewChildElement ("bundle");
+    element->setAttribute ("path", bundlePath);
+    element->setAttribute ("modified", modified);
+
+    for (int i = 0; i < bundle->getNumDescriptors(); ++i)
+    {
+        const auto* const vcpdesc = bundle->getDescriptorAt (i);
+        if (vcpdesc == nullptr || vcpdesc->ID == nullptr)
+            continue;
+
+        Description desc;
+        desc.identifier = String::fromUTF8 (vcpdesc->ID);
+        desc.bundlePath = bundlePath;
+        desc.name = bundleName.isNotEmpty() ? bundleName : desc.identifier;
+
+        const auto* processor = vcpdesc->extension != nullptr
+            ? static_cast<const VCPProcessor*> (vcpdesc->extension (VCP_PROCESSOR_URI)) : nullptr;
+        if (processor != nullptr && processor->version >= 1 && processor->version <= VCP_PROCESSOR_VERSION)
+        {
+            desc.isProcessor = true;
+            if (processor->name != nullptr)
+                desc.name = String::fromUTF8 (processor->name);
+            if (processor->file_extension != nullptr)
+                desc.fileExtension = String::fromUTF8 (processor->file_extension);
+        }
+
+        auto* const plugin = element->createNewChildElement ("plugin");
+        plugin->setAttribute ("id", desc.identifier);
+        plugin->setAttribute ("name", desc.name);
+        plugin->setAttribute ("extension", desc.fileExtension);
+        plugin->setAttribute ("processor", desc.isProcessor);
+        descriptions.add (desc);
+    }
+}
+
+const BundleManager::Description* BundleManager::findDescription (const String& identifier) const
+{
+    for (const auto& desc : descriptions)
+        if (desc.identifier == identifier)
+            return &desc;
+    return nullptr;
+}
+
+PluginInstance* BundleManager::createInstance (const String& identifier)
+{
+    ScopedLock sl (lock);
+    if (const auto* desc = findDescription (identifier))
+        if (auto* bundle = getBundle (desc->bundlePath))
+            return bundle->createInstance (identifier);
+    return nullptr;
+}
+
+PluginBundle* BundleManager::getBundle (const String& bundlePath)
+{
+    for (auto* bundle : bundles)
+        if (bundle->getBundlePath() == bundlePath)
+            return bundle;
+
+    std::unique_ptr<PluginBundle> bundle (new PluginBundle (bundlePath));
+    if (! bundle->open())
+        return nullptr;
+    return bundles.add (bundle.release());
+}
+
+}
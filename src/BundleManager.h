@@ -0,0 +1,53 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+class PluginBundle;
+class PluginInstance;
+
+/** Finds .vcp bundles in the plugin directories. What the bundles provide is
+    cached by the modification time of their binaries, so unchanged bundles
+    are only loaded once one of their plugins gets instantiated */
+class BundleManager
+{
+public:
+    struct Description
+    {
+        String identifier;
+        String bundlePath;
+        String name;
+        String fileExtension;
+        bool isProcessor = false;
+    };
+
+    BundleManager();
+    ~BundleManager();
+
+    /** Scans the search path for bundles. This only happens once unless
+        forced, the cache file is read and rewritten when given */
+    void scan (const FileSearchPath& path, const File& cacheFile, bool force = false);
+    bool hasScanned() const { return scanned; }
+
+    /** Returns everything found by the last scan */
+    const Array<Description>& getDescriptions() const { return descriptions; }
+
+    /** Returns the description of a plugin or nullptr if not found */
+    const Description* findDescription (const String& identifier) const;
+
+    /** Creates a plugin instance, loading its bundle if needed. Loaded
+        bundles stay open until the manager is deleted */
+    PluginInstance* createInstance (const String& identifier);
+
+private:
+    CriticalSection lock;
+    bool scanned = false;
+    Array<Description> descriptions;
+    OwnedArray<PluginBundle> bundles;
+
+    PluginBundle* getBundle (const String& bundlePath);
+    void scanBundle (const File& bundle, const XmlElement* cache, XmlElement& newCache);
+};
+
+}
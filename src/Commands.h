@@ -10,11 +10,14 @@ enum ID {
     projectRecord,
     projectShowDataPath,
     projectExport,
+    projectFindLoops,
+    projectPreviewContainer,
 
     layerRecord         = 0x00002000,
     
     showAbout           = 0x00005000,
     showLicenseManagement,
+    showDiagnostics,
 
     checkForUpdates     = 0x00006000
 };
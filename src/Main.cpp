@@ -2,7 +2,7 @@
 #ifndef VCP_STLIB
 
 #include "vcp/plugin.h"
-#include "vcp/PluginBundle.h"
+#include "engine/RenderWorker.h"
 #include "gui/LookAndFeel.h"
 #include "gui/MainWindow.h"
 
@@ -27,22 +27,6 @@ public:
     void initialise (const String& commandLine) override
     {
         versicap.reset (new Versicap());
-#if 1
-        PluginBundle bundle ("/Users/mfisher/workspace/kushview/versicap/build/plugins/test.vcp");
-
-        bundle.open();
-        
-        if (bundle.isOpen())
-        {
-            if (auto* instance = bundle.createInstance ("com.versicap.TestPlugin"))
-            {
-                Logger::writeToLog ("YES");
-                deleteAndZero (instance);
-            }
-        }
-
-        bundle.close();
-#endif
 
         if (maybeLaunchSlave (commandLine))
             return;
@@ -112,19 +96,17 @@ private:
     {
         slaves.clearQuick (true);
         slaves.add (versicap->getPluginManager().createAudioPluginScannerSlave());
-        StringArray processIds = { VCP_PLUGIN_SCANNER_PROCESS_ID };
-        for (auto* slave : slaves)
+        slaves.add (RenderWorkerPool::createSlave());
+        StringArray processIds = { VCP_PLUGIN_SCANNER_PROCESS_ID, VCP_RENDER_WORKER_PROCESS_ID };
+        for (int i = 0; i < slaves.size(); ++i)
         {
-            for (const auto& pid : processIds)
+            if (slaves.getUnchecked(i)->initialiseFromCommandLine (commandLine, processIds[i]))
             {
-                if (slave->initialiseFromCommandLine (commandLine, pid))
-                {
-				   #if JUCE_MAC
-                    Process::setDockIconVisible (false);
-				   #endif
-                    juce::shutdownJuce_GUI();
-                    return true;
-                }
+			   #if JUCE_MAC
+                Process::setDockIconVisible (false);
+			   #endif
+                juce::shutdownJuce_GUI();
+                return true;
             }
         }
         
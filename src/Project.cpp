@@ -3,6 +3,7 @@
 #include "exporters/Exporter.h"
 #include "PluginManager.h"
 #include "Project.h"
+#include "ProjectWatcher.h"
 #include "Tags.h"
 #include "Types.h"
 
@@ -61,6 +62,50 @@ void SampleSet::setMissingProperties()
     stabilizePropertyPOD (Tags::midiProgram, -1);
 }
 
+//=========================================================================
+Rig::Rig()
+    : kv::ObjectModel (Tags::rig)
+{
+    setMissingProperties();
+}
+
+Rig::Rig (const ValueTree& data)
+    : kv::ObjectModel (data)
+{
+    if (objectData.hasType (Tags::rig))
+        setMissingProperties();
+}
+
+String Rig::getUuidString() const {   return getProperty (Tags::uuid).toString(); }
+
+Uuid Rig::getUuid() const
+{
+    const Uuid uuid (getUuidString());
+    return uuid;
+}
+
+bool Rig::isValid() const
+{
+    return objectData.hasType (Tags::rig) &&
+           objectData.hasProperty (Tags::uuid) &&
+           ! Uuid (getProperty (Tags::uuid).toString()).isNull();
+}
+
+String Rig::getMidiOutputName() const   { return getProperty (Tags::midiOutput).toString(); }
+int Rig::getMidiChannel() const         { return (int) getProperty (Tags::midiChannel); }
+int Rig::getInputChannel() const        { return (int) getProperty (Tags::inputChannel); }
+double Rig::getMeasuredLatency() const  { return (double) getProperty (Tags::measuredLatency, -1.0); }
+
+void Rig::setMissingProperties()
+{
+    stabilizePropertyString (Tags::uuid, Uuid().toString());
+    stabilizePropertyString (Tags::name, "");
+    stabilizePropertyString (Tags::midiOutput, "");
+    stabilizePropertyPOD (Tags::midiChannel, 0);
+    stabilizePropertyPOD (Tags::inputChannel, 0);
+    stabilizePropertyPOD (Tags::measuredLatency, -1.0);
+}
+
 //=========================================================================
 Project::Project()
     : ObjectModel (ValueTree())
@@ -149,9 +194,13 @@ void Project::getRenderContext (RenderContext& context) const
     context.channels        = (int) getProperty (Tags::channels, 2);
     context.bitDepth        = (int) getProperty (Tags::bitDepth, 16);
     context.latency         = (int) getProperty (Tags::latencyComp, 0);
+    context.measuredLatency = (double) getProperty (Tags::measuredLatency, -1.0);
 
-    // not currently used
-    context.sampleRate      = 44100.0;
+    context.sampleRate      = (double) getProperty (Tags::fileSampleRate, 0.0);
+    context.programSettle   = (double) getProperty (Tags::programSettle, 3000.0);
+    context.trimThreshold   = (float) (double) getProperty (Tags::trimThreshold, 0.0);
+    context.dither          = (int) getProperty (Tags::dither, 0);
+    context.workers         = (int) getProperty (Tags::workers, 0);
 
     for (int i = 0; i < getNumSampleSets(); ++i)
     {
@@ -163,6 +212,22 @@ void Project::getRenderContext (RenderContext& context) const
         info.midiProgram = layer.getMidiProgram();
         context.layers.add (info);
     }
+
+    if (context.source == SourceType::Hardware)
+    {
+        for (int i = 0; i < getNumRigs(); ++i)
+        {
+            const auto rig (getRig (i));
+            RigInfo info;
+            info.uuid           = rig.getUuidString();
+            info.name           = rig.getName();
+            info.midiOutput     = rig.getMidiOutputName();
+            info.midiChannel    = rig.getMidiChannel();
+            info.inputChannel   = rig.getInputChannel();
+            info.measuredLatency = rig.getMeasuredLatency();
+            context.rigs.add (info);
+        }
+    }
 }
 
 //=========================================================================
@@ -203,6 +268,47 @@ int Project::indexOf (const SampleSet& layer) const
     return objectData.getChildWithName(Tags::sets).indexOf (layer.getValueTree());
 }
 
+//=========================================================================
+int Project::getNumRigs() const { return objectData.getChildWithName (Tags::rigs).getNumChildren(); }
+Rig Project::getRig (int index) const { return Rig (objectData.getChildWithName (Tags::rigs).getChild (index)); }
+
+Rig Project::addRig()
+{
+    auto rigs = objectData.getChildWithName (Tags::rigs);
+    Rig rig;
+    String rigName = "Rig ";
+    rigName << int (getNumRigs() + 1);
+    rig.setProperty (Tags::name, rigName)
+       .setProperty (Tags::inputChannel, getNumRigs() * (int) getProperty (Tags::channels, 2));
+    rigs.appendChild (rig.getValueTree(), nullptr);
+    rebuildSampleList();
+    return rig;
+}
+
+void Project::removeRig (int index)
+{
+    if (! isPositiveAndBelow (index, getNumRigs()))
+        return;
+    objectData.getChildWithName (Tags::rigs).removeChild (index, nullptr);
+    rebuildSampleList();
+}
+
+int Project::indexOf (const Rig& rig) const
+{
+    return objectData.getChildWithName (Tags::rigs).indexOf (rig.getValueTree());
+}
+
+StringArray Project::getCaptureRigIds() const
+{
+    StringArray ids;
+    if (getSourceType() == SourceType::Hardware)
+        for (int i = 0; i < getNumRigs(); ++i)
+            ids.add (getRig(i).getUuidString());
+    if (ids.isEmpty())
+        ids.add (String());
+    return ids;
+}
+
 //=========================================================================
 void Project::getAudioDeviceSetup (AudioDeviceManager::AudioDeviceSetup& setup) const
 {
@@ -245,6 +351,7 @@ void Project::rebuildSampleList()
 {
     Array<int> notes;
     getPossibleNoteNumbers (notes);
+    const auto rigIds = getCaptureRigIds();
     auto samples = objectData.getOrCreateChildWithName (Tags::samples, nullptr);
     
     //objectData.removeChild (samples, nullptr);
@@ -258,14 +365,39 @@ void Project::rebuildSampleList()
 
         for (const auto& note : notes)
         {
-            Sample sample (find (Tags::samples, Tags::set, layerId,
-                                                Tags::note,  note));
-            if (! sample.isValid())
+            for (const auto& rigId : rigIds)
             {
-                sample = Sample::create();
-                sample.setProperty (Tags::note, note)
-                      .setProperty (Tags::set, layerId);
-                samples.appendChild (sample.getValueTree(), nullptr);
+                Sample sample (findCapturedSample (layerId, note, rigId));
+
+                // keep takes of a rig that went away, e.g. the rig-less
+                // samples when the first rig is added or the reverse
+                if (! sample.isValid())
+                {
+                    for (int j = 0; j < samples.getNumChildren(); ++j)
+                    {
+                        auto child = samples.getChild (j);
+                        if (child[Tags::set].toString() == layerId && (int) child[Tags::note] == note &&
+                            ! rigIds.contains (child[Tags::rig].toString()))
+                        {
+                            if (rigId.isNotEmpty())
+                                child.setProperty (Tags::rig, rigId, nullptr);
+                            else
+                                child.removeProperty (Tags::rig, nullptr);
+                            sample = Sample (child);
+                            break;
+                        }
+                    }
+                }
+
+                if (! sample.isValid())
+                {
+                    sample = Sample::create();
+                    sample.setProperty (Tags::note, note)
+                          .setProperty (Tags::set, layerId);
+                    if (rigId.isNotEmpty())
+                        sample.setProperty (Tags::rig, rigId);
+                    samples.appendChild (sample.getValueTree(), nullptr);
+                }
             }
         }
     }
@@ -273,7 +405,7 @@ void Project::rebuildSampleList()
     for (int i = samples.getNumChildren(); --i >= 0;)
     {
         const Sample sample (samples.getChild (i));
-        if (! notes.contains (sample.getNote()))
+        if (! notes.contains (sample.getNote()) || ! rigIds.contains (sample.getRigUuidString()))
             samples.removeChild (sample.getValueTree(), nullptr);
     }
 }
@@ -292,16 +424,18 @@ void Project::setAudioDeviceSetup (const AudioDeviceManager::AudioDeviceSetup& s
 //=========================================================================
 void Project::setSamples (const ValueTree& newSamples)
 {
+    ProjectWatcher::Transaction transaction;
     for (int i = 0; i < newSamples.getNumChildren(); ++i)
     {
         const Sample recorded (newSamples.getChild (i));
-        Sample existing (find (Tags::samples, Tags::set, recorded.getSampleSetUuidString(),
-                                              Tags::note,  recorded.getNote()));
+        Sample existing (findCapturedSample (recorded.getSampleSetUuidString(),
+                                             recorded.getNote(),
+                                             recorded.getRigUuidString()));
         
         Array<Identifier> propsToCopy, propsToCopyIfNotThere;
-        propsToCopy.addArray ({ Tags::file, Tags::sampleRate, Tags::length });
+        propsToCopy.addArray ({ Tags::file, Tags::sampleRate, Tags::channels, Tags::length });
         propsToCopyIfNotThere.addArray ({
-            Tags::set, Tags::name, Tags::note, 
+            Tags::set, Tags::rig, Tags::name, Tags::note, 
             Tags::timeIn, Tags::timeOut
         });
         
@@ -313,6 +447,10 @@ void Project::setSamples (const ValueTree& newSamples)
                 existing.getValueTree(), nullptr);
         }
 
+        // trim points detected during capture replace those of the old take
+        if ((bool) recorded.getProperty (Tags::trimmed, false))
+            propsToCopy.addArray ({ Tags::timeIn, Tags::timeOut });
+
         for (const auto& prop : propsToCopy)
             existing.setProperty (prop, recorded.getProperty (prop));
         
@@ -489,6 +627,12 @@ void Project::setMissingProperties()
     RenderContext context;
     stabilizePropertyString (Tags::source,      SourceType::getSlug (SourceType::Hardware));
     stabilizePropertyPOD (Tags::latencyComp,    0);
+    stabilizePropertyPOD (Tags::measuredLatency, -1.0);
+    stabilizePropertyPOD (Tags::fileSampleRate, 0);
+    stabilizePropertyPOD (Tags::programSettle,  3000);
+    stabilizePropertyPOD (Tags::trimThreshold,  0);
+    stabilizePropertyPOD (Tags::dither,         context.dither);
+    stabilizePropertyPOD (Tags::workers,        context.workers);
     stabilizePropertyPOD (Tags::noteStart,      36);
     stabilizePropertyPOD (Tags::noteEnd,        60);
     stabilizePropertyPOD (Tags::noteStep,       4);
@@ -505,6 +649,7 @@ void Project::setMissingProperties()
     objectData.getOrCreateChildWithName (Tags::sets,  nullptr);
     objectData.getOrCreateChildWithName (Tags::samples, nullptr);
     objectData.getOrCreateChildWithName (Tags::plugin,  nullptr);
+    objectData.getOrCreateChildWithName (Tags::rigs,    nullptr);
 }
 
 ValueTree Project::find (const Identifier& listType, 
@@ -526,6 +671,19 @@ ValueTree Project::find (const Identifier& listType,
     return { };
 }
 
+ValueTree Project::findCapturedSample (const String& layerId, int note, const String& rigId) const
+{
+    const auto parent = objectData.getChildWithName (Tags::samples);
+    for (int i = 0; i < parent.getNumChildren(); ++i)
+    {
+        const auto child = parent.getChild (i);
+        if (child[Tags::set].toString() == layerId && (int) child[Tags::note] == note &&
+            child[Tags::rig].toString() == rigId)
+            return child;
+    }
+    return { };
+}
+
 void Project::addExporter (ExporterType& type, const String& name)
 {
     auto exporters = objectData.getChildWithName (Tags::exporters);
@@ -43,6 +43,39 @@ private:
     void setMissingProperties();
 };
 
+class Rig : public kv::ObjectModel
+{
+public:
+    Rig();
+    Rig (const ValueTree& data);
+    ~Rig() = default;
+
+    Uuid getUuid() const;
+    String getUuidString() const;
+
+    bool isValid() const;
+
+    String getName() const { return objectData.getProperty (Tags::name); }
+    String getMidiOutputName() const;
+    int getMidiChannel() const;
+    int getInputChannel() const;
+
+    /** Returns the measured round trip latency in milliseconds or a negative
+        value if it hasn't been measured */
+    double getMeasuredLatency() const;
+
+    void getProperties (Versicap&, Array<PropertyComponent*>&);
+
+    Rig& operator= (const Rig& o)
+    {
+        this->objectData = o.objectData;
+        return *this;
+    }
+
+private:
+    void setMissingProperties();
+};
+
 class Sample : public kv::ObjectModel
 {
 public:
@@ -57,6 +90,7 @@ public:
     bool isEmpty() const;
     bool isForSampleSet (const SampleSet& layer) const;
     String getSampleSetUuidString() const;
+    String getRigUuidString() const;
     
     String getNoteName() const;
     String getFileName() const;
@@ -69,12 +103,19 @@ public:
     int getNote() const { return getProperty (Tags::note); }
     
     double getSampleRate() const;
+    /** Returns the channels in the file, 0 if the sample doesn't know */
+    int getNumChannels() const;
     double getTotalTime() const;
     
     double getStartTime() const;
     double getEndTime() const;
     double getLength() const;
 
+    /** Returns true if loop points were found for this sample */
+    bool hasLoop() const;
+    double getLoopStart() const;
+    double getLoopEnd() const;
+
     void getProperties (Array<PropertyComponent*>&);
     
     Sample& operator= (const Sample& o)
@@ -182,6 +223,18 @@ public:
     void setActiveSampleSet (const SampleSet& layer);
     SampleSet getActiveSampleSet() const;
 
+    //=========================================================================
+    int getNumRigs() const;
+    Rig getRig (int index) const;
+    Rig addRig();
+    void removeRig (int index);
+    Rig findRig (const String& uuid) const { return Rig (find (Tags::rigs, Tags::uuid, uuid)); }
+    int indexOf (const Rig& rig) const;
+
+    /** Returns the rig ids samples are captured for. This is a single empty
+        string when recording a plugin or when no rigs have been defined */
+    StringArray getCaptureRigIds() const;
+
     //=========================================================================
     void setSamples (const ValueTree& samples);
     void setActiveSample (const Sample& sample);
@@ -230,6 +283,7 @@ private:
     ValueTree find (const Identifier& listType,
                     const Identifier& p1, const var& v1,
                     const Identifier& p2, const var& v2) const;
+    ValueTree findCapturedSample (const String& layerId, int note, const String& rigId) const;
 };
 
 }
\ No newline at end of file
@@ -1,14 +1,16 @@
 #pragma once
 
 #include "Project.h"
+#include <unordered_set>
 
 namespace vcp {
 
-class ProjectWatcher : private ValueTree::Listener
+class ProjectWatcher : private ValueTree::Listener,
+                       private AsyncUpdater
 {
 public:
-    ProjectWatcher() = default;
-    virtual ~ProjectWatcher() {}
+    ProjectWatcher()            { getWatchers().add (this); }
+    virtual ~ProjectWatcher()   { getWatchers().removeFirstMatchingValue (this); }
     
     class ScopedBlock
     {
@@ -20,12 +22,66 @@ public:
         ProjectWatcher& watcher;
     };
 
+    /** Holds back onProjectModified and onDelta of every watcher until the
+        outermost transaction ends, then delivers them at once. Use it
+        around bulk edits on the message thread */
+    class Transaction
+    {
+    public:
+        Transaction()   { ++getTransactionDepth(); }
+        ~Transaction()
+        {
+            if (--getTransactionDepth() == 0)
+                for (auto* const watcher : Array<ProjectWatcher*> (getWatchers()))
+                    if (getWatchers().contains (watcher))   // a callback may delete others
+                        watcher->flush();
+        }
+    private:
+        JUCE_DECLARE_NON_COPYABLE (Transaction)
+    };
+
+    /** Changes collected since the last delivery */
+    struct Delta
+    {
+        /** Samples with changed properties, each listed once */
+        Array<ValueTree> samples;
+        /** Every property that changed, each listed once */
+        Array<Identifier> properties;
+        /** True if project properties changed or children were added,
+            removed or moved */
+        bool projectModified = false;
+        int numChanges = 0;
+
+        bool isEmpty() const { return numChanges == 0; }
+        bool hasChanged (const Identifier& property) const { return propertyKeys.count (getKey (property)) > 0; }
+        bool hasChanged (const ValueTree& sample) const { return sampleKeys.count (getKey (sample)) > 0; }
+
+    private:
+        friend class ProjectWatcher;
+
+        // batches touch thousands of samples, so look them up by identity.
+        // Trees sharing their data share the property set, identifiers are pooled
+        std::unordered_set<const void*> sampleKeys, propertyKeys;
+        static const void* getKey (const ValueTree& tree) { return &tree.getProperties(); }
+        static const void* getKey (const Identifier& id) { return id.getCharPointer().getAddress(); }
+
+        void add (const ValueTree& tree, const Identifier& property)
+        {
+            if (tree.hasType (Tags::sample) && sampleKeys.insert (getKey (tree)).second)
+                samples.add (tree);
+            if (propertyKeys.insert (getKey (property)).second)
+                properties.add (property);
+        }
+    };
+
     void setProject (const Project& newProject)
     {
         if (data == newProject.getValueTree())
             return;
         
         data.removeListener (this);
+        cancelPendingUpdate();
+        delta = Delta();
         project = newProject;
         data = project.getValueTree();
         data.addListener (this);
@@ -47,20 +103,84 @@ public:
     std::function<void()> onSampleAdded;
     std::function<void()> onActiveSampleChanged;
 
+    /** Same as onSampleAdded and onSampleRemoved but with the sample
+        involved, for views that update incrementally */
+    std::function<void(const Sample&)> onSampleInserted;
+    std::function<void(const Sample&)> onSampleErased;
+
     std::function<void()> onExportersChanged;
     std::function<void()> onActiveExporterChanged;
 
+    std::function<void()> onRigsChanged;
+
+    /** Called once per message loop tick, or when a transaction ends, if
+        project properties changed or anything was added, removed or moved */
     std::function<void()> onProjectModified;
 
+    /** Called once per message loop tick, or when a transaction ends, with
+        everything that changed since the last call */
+    std::function<void(const Delta&)> onDelta;
+
 private:
     bool blocked = false;
     Project project;
     ValueTree data;
+    Delta delta;
+
+    static int& getTransactionDepth()
+    {
+        static int depth = 0;
+        return depth;
+    }
+
+    static Array<ProjectWatcher*>& getWatchers()
+    {
+        static Array<ProjectWatcher*> watchers;
+        return watchers;
+    }
 
     void notifyModified()
     {
-        if (onProjectModified)
+        if (! onProjectModified && ! onDelta)
+            return;
+        delta.projectModified = true;
+        addChange();
+    }
+
+    void addChange()
+    {
+        ++delta.numChanges;
+        if (getTransactionDepth() == 0)
+            triggerAsyncUpdate();
+    }
+
+    void addPropertyChange (const ValueTree& tree, const Identifier& property)
+    {
+        if (! onDelta)
+            return;
+
+        delta.add (tree, property);
+        addChange();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        if (getTransactionDepth() == 0)
+            flush();
+    }
+
+    void flush()
+    {
+        cancelPendingUpdate();
+        if (delta.isEmpty())
+            return;
+
+        Delta changes;
+        std::swap (changes, delta);
+        if (changes.projectModified && onProjectModified)
             onProjectModified();
+        if (onDelta)
+            onDelta (changes);
     }
 
     void valueTreePropertyChanged (ValueTree& tree, const Identifier& property) override
@@ -91,6 +211,7 @@ private:
 
         if (tree.hasType (Tags::project))
             notifyModified();
+        addPropertyChange (tree, property);
     }
 
     void valueTreeChildAdded (ValueTree& parent, ValueTree& child) override
@@ -111,6 +232,8 @@ private:
                  parent.hasType (Tags::samples) && 
                  parent.getParent() == data)
         {
+            if (onSampleInserted)
+                onSampleInserted (Sample (child));
             if (onSampleAdded)
                 onSampleAdded();
         }
@@ -119,6 +242,11 @@ private:
             if (onExportersChanged)
                 onExportersChanged();
         }
+        else if (child.hasType (Tags::rig) && parent.hasType (Tags::rigs))
+        {
+            if (onRigsChanged)
+                onRigsChanged();
+        }
 
         notifyModified();
     }
@@ -141,6 +269,8 @@ private:
                  parent.hasType (Tags::samples) && 
                  parent.getParent() == data)
         {
+            if (onSampleErased)
+                onSampleErased (Sample (child));
             if (onSampleRemoved)
                 onSampleRemoved();
         }
@@ -149,6 +279,11 @@ private:
             if (onExportersChanged)
                 onExportersChanged();
         }
+        else if (child.hasType (Tags::rig) && parent.hasType (Tags::rigs))
+        {
+            if (onRigsChanged)
+                onRigsChanged();
+        }
         
         notifyModified();
     }
@@ -49,18 +49,22 @@ String Sample::getFileName () const
     const Project project (objectData.getParent().getParent());
     const SampleSet layer (project.findSampleSet (getProperty (Tags::set).toString()));
 
+    const Rig rig (project.findRig (getRigUuidString()));
+
     String name     = getProperty (Tags::name);
     String noteName = getNoteName();
     String noteNo   = String(getNote()).paddedLeft ('0', 3);
     String layerNo  = String(project.indexOf (layer)).paddedLeft ('0', 3);
+    String rigName  = rig.isValid() ? rig.getName() : String();
 
     StringArray tokens;
-    tokens.addArray ({ layerNo, noteNo, name, noteName });
+    tokens.addArray ({ rigName, layerNo, noteNo, name, noteName });
     tokens.removeEmptyStrings (true);
     return tokens.joinIntoString("_");
 }
 
 String Sample::getSampleSetUuidString() const { return getProperty (Tags::set).toString(); }
+String Sample::getRigUuidString() const { return getProperty (Tags::rig).toString(); }
 
 bool Sample::isForSampleSet (const SampleSet& layer) const
 {
@@ -94,9 +98,13 @@ void Sample::getProperties (Array<PropertyComponent*>& props)
 }
 
 double Sample::getSampleRate() const    { return getProperty (Tags::sampleRate); }
+int Sample::getNumChannels() const      { return getProperty (Tags::channels, 0); }
 double Sample::getTotalTime() const     { return getProperty (Tags::length); }
 double Sample::getStartTime() const     { return getProperty (Tags::timeIn); }
 double Sample::getEndTime() const       { return getProperty (Tags::timeOut); }
 double Sample::getLength() const        { return getEndTime() - getStartTime(); }
+double Sample::getLoopStart() const     { return getProperty (Tags::loopStart, -1.0); }
+double Sample::getLoopEnd() const       { return getProperty (Tags::loopEnd, -1.0); }
+bool Sample::hasLoop() const            { return getLoopStart() >= 0.0 && getLoopEnd() > getLoopStart(); }
 
 }
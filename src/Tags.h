@@ -7,6 +7,7 @@ namespace vcp {
 namespace Tags {
 
     static const Identifier active          = "active";
+    static const Identifier analyzed        = "analyzed";
     static const Identifier audioInput      = "audioInput";
     static const Identifier audioInputChannels  = "audioInputChannels";
     
@@ -15,8 +16,10 @@ namespace Tags {
     static const Identifier baseName        = "baseName";
     static const Identifier bitDepth        = "bitDepth";
     static const Identifier bufferSize      = "bufferSize";
+    static const Identifier cents           = "cents";
     static const Identifier channels        = "channels";
     static const Identifier dataPath        = "dataPath";
+    static const Identifier dither          = "dither";
     
     static const Identifier enabled         = "enabled";
     static const Identifier exporters       = "exporters";
@@ -24,25 +27,39 @@ namespace Tags {
     
     static const Identifier file            = "file";
     static const Identifier fileOrId        = "fileOrId";
+    static const Identifier fileSampleRate  = "fileSampleRate";
+    static const Identifier fingerprint     = "fingerprint";
     static const Identifier format          = "format";
+    static const Identifier fundamental     = "fundamental";
     
     static const Identifier height          = "height";
 
     static const Identifier identifier      = "identifier";
+    static const Identifier inputChannel    = "inputChannel";
+    static const Identifier interleaved     = "interleaved";
 
     static const Identifier latencyComp     = "latencyComp";
     static const Identifier layer           = "layer";
     static const Identifier layers          = "layers";
     static const Identifier length          = "length";
     static const Identifier loop            = "loop";
+    static const Identifier loopEnd         = "loopEnd";
+    static const Identifier loopScore       = "loopScore";
+    static const Identifier loopStart       = "loopStart";
+    static const Identifier loudness        = "loudness";
 
     static const Identifier midi            = "midi";
     static const Identifier midiChannel     = "midiChannel";
     static const Identifier midiInput       = "midiInput";
     static const Identifier midiOutput      = "midiOutput";
     static const Identifier midiProgram     = "midiProgram";
+    static const Identifier measuredLatency = "measuredLatency";
     
     static const Identifier name            = "name";
+    static const Identifier noiseFloor      = "noiseFloor";
+    static const Identifier normalize       = "normalize";
+    static const Identifier normalizeMode   = "normalizeMode";
+    static const Identifier normalizeTarget = "normalizeTarget";
     static const Identifier note            = "note";
     static const Identifier notes           = "notes";
     static const Identifier noteStart       = "noteStart";
@@ -53,14 +70,21 @@ namespace Tags {
     static const Identifier object          = "object";
 
     static const Identifier path            = "path";
+    static const Identifier peak            = "peak";
     static const Identifier plugin          = "plugin";
+    static const Identifier programSettle   = "programSettle";
     static const Identifier project         = "project";
 
     static const Identifier quality         = "quality";
 
+    static const Identifier rig             = "rig";
+    static const Identifier rigs            = "rigs";
+    static const Identifier rms             = "rms";
+
     static const Identifier sample          = "sample";
     static const Identifier samples         = "samples";
     static const Identifier sampleRate      = "sampleRate";
+    static const Identifier script          = "script";
 
     static const Identifier set             = "set";
     static const Identifier sets            = "sets";
@@ -71,6 +95,8 @@ namespace Tags {
     static const Identifier tailLength      = "tailLength";
     static const Identifier timeIn          = "timeIn";
     static const Identifier timeOut         = "timeOut";
+    static const Identifier trimmed         = "trimmed";
+    static const Identifier trimThreshold   = "trimThreshold";
     static const Identifier type            = "type";
 
     static const Identifier uuid            = "uuid";
@@ -79,5 +105,7 @@ namespace Tags {
     static const Identifier velocity        = "velocity";
     static const Identifier version         = "version";
 
+    static const Identifier workers         = "workers";
+
 }
 }
@@ -51,6 +51,7 @@ struct FormatType
         {
             case FormatType::WAVE:
             case FormatType::AIFF:
+            case FormatType::FLAC:
                 result = true;
                 break;
             default: break;
@@ -178,7 +179,7 @@ struct LoopType
         {
             case None:          return "None"; break;
             case Forwards:      return "Forwards"; break;
-            case Alternating:   return "Alertnating"; break;
+            case Alternating:   return "Alternating"; break;
             case Reverse:       return "Reverse"; break;
             case RoundRobin:    return "Round Robin"; break;
         }
@@ -200,6 +201,17 @@ struct LoopType
         return "Unknown";
     }
 
+    static int fromSlug (const String& t)
+    {
+        if (t == "forwards")                            return Forwards;
+        if (t == "alertnating" || t == "alternating")   return Alternating;
+        if (t == "reverse")                             return Reverse;
+        if (t == "roundRobin")                          return RoundRobin;
+        return None;
+    }
+
+    int getType() const { return type; }
+
     LoopType() = default;
     LoopType (const int t) : type (t) { jassert (isPositiveAndBelow (t, NumTypes)); }
     LoopType (const ID t) : type (static_cast<int> (t)) {}
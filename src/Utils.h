@@ -17,5 +17,18 @@ inline static String noteValue (const double value)
     return MidiMessage::getMidiNoteName (roundToInt (value), true, true, 4);
 }
 
+/** Formats seconds as m:ss, or h:mm:ss for an hour or more */
+inline static String durationValue (const double seconds)
+{
+    const int total = jmax (0, roundToInt (seconds));
+    String str;
+    if (total >= 3600)
+        str << (total / 3600) << ":" << String ((total / 60) % 60).paddedLeft ('0', 2);
+    else
+        str << (total / 60);
+    str << ":" << String (total % 60).paddedLeft ('0', 2);
+    return str;
+}
+
 }
 }
\ No newline at end of file
@@ -1,4 +1,8 @@
 
+#include "analysis/LoopFinder.h"
+#include "analysis/SampleAnalyzer.h"
+#include "analysis/SampleStats.h"
+
 #include "controllers/GuiController.h"
 #include "controllers/ProjectsController.h"
 
@@ -11,6 +15,7 @@
 #include "gui/MainWindow.h"
 #include "gui/PluginWindow.h"
 
+#include "BundleManager.h"
 #include "Commands.h"
 #include "PluginManager.h"
 #include "Project.h"
@@ -78,8 +83,11 @@ struct Versicap::Impl : public AudioIODeviceCallback,
             Commands::projectRecord,
             Commands::projectShowDataPath,
             Commands::projectExport,
+            Commands::projectFindLoops,
+            Commands::projectPreviewContainer,
             Commands::showAbout,
-            Commands::showLicenseManagement
+            Commands::showLicenseManagement,
+            Commands::showDiagnostics
            #if 0
             Commands::checkForUpdates
            #endif
@@ -152,9 +160,12 @@ struct Versicap::Impl : public AudioIODeviceCallback,
     ApplicationCommandManager commands;
     ExporterTypeArray exporters;
     std::unique_ptr<ExportThread> exporter;
+    std::unique_ptr<SampleAnalyzer> loopAnalyzer;
+    std::unique_ptr<SampleAnalyzer> sampleAnalyzer;
     OptionalScopedPointer<AudioDeviceManager> devices;
     OptionalScopedPointer<AudioFormatManager> formats;
     OptionalScopedPointer<PluginManager> plugins;
+    std::unique_ptr<BundleManager> bundles;
     MidiKeyboardState keyboardState;
     std::unique_ptr<UndoManager> undoManager;
 
@@ -169,6 +180,7 @@ Versicap::Versicap()
     impl->devices.setOwned (new AudioDeviceManager());
     impl->formats.setOwned (new AudioFormatManager());
     impl->plugins.setOwned (new PluginManager());
+    impl->bundles.reset (new BundleManager());
     
     impl->exporter.reset (new ExportThread());
     impl->undoManager.reset (new UndoManager (30000, 30));
@@ -199,6 +211,7 @@ Versicap::Versicap()
         auto project = getProject();
         project.setSamples (impl->engine->getRenderedSamples());
         listeners.call ([](Listener& l) { l.renderStopped(); });
+        analyzeSamples();
     };
 
     impl->engine->onRenderCancelled = [this]()
@@ -228,6 +241,10 @@ Versicap::Versicap()
 
 Versicap::~Versicap()
 {
+    // tasks may hold plugin instances, so export stops before bundles close
+    impl->exporter.reset();
+    impl->loopAnalyzer.reset();
+    impl->sampleAnalyzer.reset();
     impl->engine.reset();
     impl->sampleCache->deacitvate();
     impl->sampleCache.reset();
@@ -271,6 +288,19 @@ void Versicap::initializeDataPath()
         getProjectsPath().createDirectory();
 }
 
+void Versicap::initializeBundles()
+{
+    FileSearchPath path;
+    path.add (getUserDataPath().getChildFile ("Plugins"));
+    const auto app = File::getSpecialLocation (File::currentApplicationFile);
+   #if JUCE_MAC
+    path.add (app.getChildFile ("Contents/PlugIns"));
+   #else
+    path.add (app.getParentDirectory().getChildFile ("plugins"));
+   #endif
+    getBundleManager().scan (path, getApplicationDataPath().getChildFile ("bundles.xml"));
+}
+
 void Versicap::initializeExporters()
 {
     getAudioFormats().registerBasicFormats();
@@ -312,6 +342,7 @@ void Versicap::initializePlugins()
 void Versicap::initialize()
 {
     initializeDataPath();
+    initializeBundles();
     initializeExporters();
     initializePlugins();
     initializeAudioDevice();
@@ -390,6 +421,7 @@ Settings& Versicap::getSettings()                           { return impl->setti
 AudioDeviceManager& Versicap::getDeviceManager()            { return *impl->devices; }
 AudioFormatManager& Versicap::getAudioFormats()             { return *impl->formats; }
 MidiKeyboardState& Versicap::getMidiKeyboardState()         { return impl->keyboardState; }
+BundleManager& Versicap::getBundleManager()                 { return *impl->bundles; }
 PluginManager& Versicap::getPluginManager()                 { return *impl->plugins; }
 UndoManager& Versicap::getUndoManager()                     { return *impl->undoManager; }
 
@@ -599,11 +631,15 @@ bool Versicap::setProject (const Project& newProject)
     {
         auto exporter = project.getExporterData (i);
         auto type = getExporterType (exporter.getProperty (Tags::type));
-        jassert (type);
         if (type)
         {
             exporter.setProperty (Tags::object, type.get(), nullptr);
         }
+        else
+        {
+            // plugin exporters go missing when their bundle was removed
+            DBG("[VCP] unknown exporter type: " << exporter.getProperty (Tags::type).toString());
+        }
     }
     
     engine.setProject (impl->project);
@@ -654,6 +690,58 @@ void Versicap::stopExporting()
     impl->exporter->cancel();
 }
 
+//=============================================================================
+Result Versicap::findLoopPoints()
+{
+    if (impl->loopAnalyzer != nullptr && impl->loopAnalyzer->isRunning())
+        return Result::fail ("samples are already being analyzed");
+
+    impl->loopAnalyzer.reset (new SampleAnalyzer (*impl->formats));
+    impl->loopAnalyzer->addAnalysis ([](const SampleAnalyzer::Source& source, NamedValueSet& results)
+    {
+        const auto loop = LoopFinder::find (source.audio, source.sampleRate,
+                                            source.startFrame, source.endFrame);
+        if (! loop.isValid())
+            return;
+        results.set (Tags::loopStart, static_cast<double> (loop.start) / source.sampleRate);
+        results.set (Tags::loopEnd,   static_cast<double> (loop.end) / source.sampleRate);
+        results.set (Tags::loopScore, loop.score);
+    });
+
+    return impl->loopAnalyzer->start (impl->project);
+}
+
+Result Versicap::analyzeSamples()
+{
+    if (impl->sampleAnalyzer != nullptr)
+        impl->sampleAnalyzer->cancel();
+
+    impl->sampleAnalyzer.reset (new SampleAnalyzer (*impl->formats));
+
+    // only files changed since they were last analyzed
+    impl->sampleAnalyzer->shouldAnalyze = [](const Sample& sample)
+    {
+        return (int64) sample.getProperty (Tags::analyzed, 0) 
+            != sample.getFile().getLastModificationTime().toMilliseconds();
+    };
+
+    impl->sampleAnalyzer->addAnalysis ([](const SampleAnalyzer::Source& source, NamedValueSet& results)
+    {
+        const auto& audio = source.audio;
+        const auto start = source.startFrame, end = source.endFrame;
+        const double fundamental = SampleStats::getFundamental (audio, source.sampleRate, start, end);
+        results.set (Tags::peak,        SampleStats::getPeak (audio, start, end));
+        results.set (Tags::rms,         SampleStats::getRMS (audio, start, end));
+        results.set (Tags::loudness,    SampleStats::getLoudness (audio, source.sampleRate, start, end));
+        results.set (Tags::noiseFloor,  SampleStats::getNoiseFloor (audio, source.sampleRate));
+        results.set (Tags::fundamental, fundamental);
+        results.set (Tags::cents,       SampleStats::getCents (fundamental, source.note));
+        results.set (Tags::analyzed,    source.file.getLastModificationTime().toMilliseconds());
+    });
+
+    return impl->sampleAnalyzer->start (impl->project);
+}
+
 }
 
 #include "../libs/ksp1/src/engine/ADSR.cpp"
@@ -9,6 +9,7 @@ namespace vcp {
 
 class MainWindow;
 class AudioEngine;
+class BundleManager;
 class PluginManager;
 class Render;
 class RenderContext;
@@ -53,6 +54,13 @@ public:
     //=========================================================================
     Result startExporting();
     void stopExporting();
+
+    /** Searches loop points for all samples in the background */
+    Result findLoopPoints();
+
+    /** Measures level, loudness and pitch of samples not yet analyzed.
+        This runs automatically once a render finished */
+    Result analyzeSamples();
     
     //=========================================================================
     static File getApplicationDataPath();
@@ -86,6 +94,7 @@ public:
     AudioThumbnailCache& getAudioThumbnailCache();
     ApplicationCommandManager& getCommandManager();
     AudioDeviceManager& getDeviceManager();
+    BundleManager& getBundleManager();
     PluginManager& getPluginManager();
     AudioFormatManager& getAudioFormats();
     MidiKeyboardState& getMidiKeyboardState();
@@ -127,6 +136,7 @@ private:
 
     //=========================================================================
     void initializeDataPath();
+    void initializeBundles();
     void initializeExporters();
     void initializeAudioDevice();
     void initializePlugins();
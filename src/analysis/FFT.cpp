@@ -0,0 +1,62 @@
+#include "analysis/FFT.h"
+
+namespace vcp {
+
+FFT::FFT (int order)
+    : size (1 << order)
+{
+    jassert (order > 0 && order < 28);
+    twiddles.malloc ((size_t) size / 2);
+    for (int i = 0; i < size / 2; ++i)
+        twiddles[i] = std::polar (1.f, static_cast<float> (-MathConstants<double>::twoPi * i / size));
+
+    reversed.malloc ((size_t) size);
+    for (int i = 0; i < size; ++i)
+    {
+        int r = 0;
+        for (int b = 0; b < order; ++b)
+            if (i & (1 << b))
+                r |= 1 << (order - 1 - b);
+        reversed[i] = r;
+    }
+}
+
+int FFT::getOrderFor (int numSamples)
+{
+    int order = 1;
+    while ((1 << order) < numSamples)
+        ++order;
+    return order;
+}
+
+void FFT::perform (Complex* data, bool inverse) const
+{
+    for (int i = 0; i < size; ++i)
+        if (i < reversed[i])
+            std::swap (data[i], data[reversed[i]]);
+
+    for (int half = 1; half < size; half <<= 1)
+    {
+        const int step = size / (half * 2);
+        for (int start = 0; start < size; start += half * 2)
+        {
+            for (int k = 0; k < half; ++k)
+            {
+                const auto w = inverse ? std::conj (twiddles[k * step]) : twiddles[k * step];
+                const auto a = data[start + k];
+                const auto b = data[start + k + half] * w;
+                data[start + k]        = a + b;
+                data[start + k + half] = a - b;
+            }
+        }
+    }
+
+    if (inverse)
+    {
+        const float scale = 1.f / static_cast<float> (size);
+        for (int i = 0; i < size; ++i)
+            data[i] *= scale;
+    }
+}
+
+}
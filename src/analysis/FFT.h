@@ -0,0 +1,33 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** A plain radix-2 complex FFT used by the sample analysis code */
+class FFT
+{
+public:
+    using Complex = std::complex<float>;
+
+    /** Creates an FFT of size 2^order */
+    explicit FFT (int order);
+    ~FFT() = default;
+
+    int getSize() const { return size; }
+
+    /** Transforms getSize() values in place. The inverse is scaled by 1/size */
+    void perform (Complex* data, bool inverse) const;
+
+    /** Returns the smallest order whose size is at least numSamples */
+    static int getOrderFor (int numSamples);
+
+private:
+    const int size;
+    HeapBlock<Complex> twiddles;
+    HeapBlock<int> reversed;
+
+    JUCE_DECLARE_NON_COPYABLE (FFT)
+};
+
+}
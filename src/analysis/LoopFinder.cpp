@@ -0,0 +1,183 @@
+#include "analysis/FFT.h"
+#include "analysis/LoopFinder.h"
+
+namespace vcp {
+
+namespace {
+
+using Complex = FFT::Complex;
+
+/** Normalized correlation of numFrames starting at a and b */
+float correlate (const float* data, int64 a, int64 b, int numFrames)
+{
+    double ab = 0.0, aa = 0.0, bb = 0.0;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        const double x = data[a + i], y = data[b + i];
+        ab += x * y;
+        aa += x * x;
+        bb += y * y;
+    }
+
+    if (aa <= 0.0 || bb <= 0.0)
+        return aa == bb ? 1.f : 0.f;
+    return static_cast<float> (ab / std::sqrt (aa * bb));
+}
+
+bool isRisingZeroCrossing (const float* data, int64 frame)
+{
+    return data[frame - 1] < 0.f && data[frame] >= 0.f;
+}
+
+/** Compares the magnitude spectra of frames centred at a and b */
+float compareSpectra (const FFT& fft, const float* data, int64 numFrames,
+                      int64 a, int64 b, Complex* bufferA, Complex* bufferB)
+{
+    const int size = fft.getSize();
+    const int64 offsetA = jlimit ((int64) 0, jmax ((int64) 0, numFrames - size), a - size / 2);
+    const int64 offsetB = jlimit ((int64) 0, jmax ((int64) 0, numFrames - size), b - size / 2);
+
+    for (int i = 0; i < size; ++i)
+    {
+        const float window = 0.5f - 0.5f * std::cos (MathConstants<float>::twoPi * i / size);
+        bufferA[i] = offsetA + i < numFrames ? data[offsetA + i] * window : 0.f;
+        bufferB[i] = offsetB + i < numFrames ? data[offsetB + i] * window : 0.f;
+    }
+
+    fft.perform (bufferA, false);
+    fft.perform (bufferB, false);
+
+    double ab = 0.0, aa = 0.0, bb = 0.0;
+    for (int i = 0; i < size / 2; ++i)
+    {
+        const double x = std::abs (bufferA[i]), y = std::abs (bufferB[i]);
+        ab += x * y;
+        aa += x * x;
+        bb += y * y;
+    }
+
+    return aa > 0.0 && bb > 0.0 ? static_cast<float> (ab / std::sqrt (aa * bb)) : 0.f;
+}
+
+}
+
+LoopFinder::Loop LoopFinder::find (const AudioSampleBuffer& audio, double sampleRate,
+                                   int64 startFrame, int64 endFrame,
+                                   const Options& options)
+{
+    Loop best;
+    const int64 totalFrames = audio.getNumSamples();
+    startFrame = jlimit ((int64) 1, totalFrames, startFrame);
+    endFrame   = jlimit (startFrame, totalFrames, endFrame);
+    const int64 length = endFrame - startFrame;
+    if (audio.getNumChannels() <= 0 || length <= 0 || sampleRate <= 0.0)
+        return best;
+
+    const int64 regionStart = startFrame + static_cast<int64> (options.searchStart * length);
+    const int64 regionEnd   = startFrame + static_cast<int64> (options.searchEnd * length);
+    const int window        = jmax (8, roundToInt (options.matchWindow * sampleRate));
+    const int minLag        = jmax (window * 2, roundToInt (options.minLength * sampleRate));
+    if (regionEnd - regionStart < minLag + 2 * window + 2)
+        return best;
+
+    // loop points are found on a mono mix
+    HeapBlock<float> mono ((size_t) totalFrames, true);
+    for (int c = 0; c < audio.getNumChannels(); ++c)
+        FloatVectorOperations::add (mono.get(), audio.getReadPointer (c), (int) totalFrames);
+
+    // autocorrelation of the sustain via the power spectrum, capped so the FFT stays small
+    const int numAnalysis = static_cast<int> (jmin (regionEnd - regionStart, (int64) (1 << 18)));
+    const int64 analysisStart = regionEnd - numAnalysis;
+    FFT fft (FFT::getOrderFor (numAnalysis * 2));
+    HeapBlock<Complex> spectrum ((size_t) fft.getSize(), true);
+
+    double mean = 0.0;
+    for (int i = 0; i < numAnalysis; ++i)
+        mean += mono [analysisStart + i];
+    mean /= numAnalysis;
+    for (int i = 0; i < numAnalysis; ++i)
+        spectrum[i] = static_cast<float> (mono [analysisStart + i] - mean);
+
+    fft.perform (spectrum.get(), false);
+    for (int i = 0; i < fft.getSize(); ++i)
+        spectrum[i] = std::norm (spectrum[i]);
+    fft.perform (spectrum.get(), true);
+
+    const float energy = spectrum[0].real();
+    if (energy <= 0.f)
+        return best;
+
+    struct Candidate { int lag; float value; };
+    Array<Candidate> candidates;
+    const int maxLag = numAnalysis * 3 / 4;
+    auto correlation = [&] (int lag) {
+        return spectrum[lag].real() / energy * numAnalysis / static_cast<float> (numAnalysis - lag);
+    };
+
+    for (int lag = minLag; lag < maxLag; ++lag)
+    {
+        const float value = correlation (lag);
+        if (value <= 0.f || value < correlation (lag - 1) || value < correlation (lag + 1))
+            continue;
+
+        int index = 0;
+        while (index < candidates.size() && candidates.getReference(index).value >= value)
+            ++index;
+        if (index < options.maxCandidates)
+        {
+            candidates.insert (index, { lag, value });
+            if (candidates.size() > options.maxCandidates)
+                candidates.removeLast();
+        }
+    }
+
+    // place each loop length on rising zero crossings near the end of the sustain
+    FFT spectrumFFT (options.spectrumOrder);
+    HeapBlock<Complex> frameA ((size_t) spectrumFFT.getSize()), frameB ((size_t) spectrumFFT.getSize());
+    const int endSearch = roundToInt (0.05 * sampleRate);
+    const int maxEnds = 4;
+
+    for (const auto& candidate : candidates)
+    {
+        int numEnds = 0;
+        for (int64 end = regionEnd - window; end > regionEnd - window - endSearch && numEnds < maxEnds; --end)
+        {
+            if (! isRisingZeroCrossing (mono, end))
+                continue;
+            ++numEnds;
+
+            int64 bestStart = -1;
+            float bestMatch = -1.f;
+            const int64 target = end - candidate.lag;
+            for (int64 start = jmax (startFrame + window, target - window);
+                 start <= target + window && start < end - minLag / 2; ++start)
+            {
+                if (! isRisingZeroCrossing (mono, start))
+                    continue;
+                const float match = correlate (mono, start - window, end - window, window * 2);
+                if (match > bestMatch)
+                {
+                    bestMatch = match;
+                    bestStart = start;
+                }
+            }
+
+            if (bestStart < 0)
+                continue;
+
+            const float spectral = compareSpectra (spectrumFFT, mono, totalFrames, bestStart, end,
+                                                   frameA, frameB);
+            const float score = 0.7f * jmax (0.f, bestMatch) + 0.3f * spectral;
+            if (score > best.score)
+            {
+                best.start = bestStart;
+                best.end   = end;
+                best.score = score;
+            }
+        }
+    }
+
+    return best;
+}
+
+}
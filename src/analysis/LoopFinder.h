@@ -0,0 +1,46 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Finds loop points in the sustained part of a sample. Candidate loop
+    lengths come from the autocorrelation of the sustain, each candidate is
+    then placed on rising zero crossings and scored by how well the waveform
+    and spectrum at the loop start match those at the loop end. */
+class LoopFinder
+{
+public:
+    struct Options
+    {
+        double minLength    = 0.25;     // shortest loop in seconds
+        double searchStart  = 0.2;      // sustain region as a proportion of
+        double searchEnd    = 0.8;      // the trimmed sample
+        double matchWindow  = 0.005;    // seconds compared either side of a loop point
+        int maxCandidates   = 8;        // loop lengths to try
+        int spectrumOrder   = 11;       // frame size for the spectral comparison
+    };
+
+    struct Loop
+    {
+        int64 start     = -1;
+        int64 end       = -1;   // frame after the last one in the loop
+        float score     = 0.f;  // 0..1, 1 is seamless
+
+        bool isValid() const { return start >= 0 && end > start; }
+    };
+
+    /** Searches between startFrame and endFrame of the given audio */
+    static Loop find (const AudioSampleBuffer& audio, double sampleRate,
+                      int64 startFrame, int64 endFrame,
+                      const Options& options);
+
+    /** Searches with the default options */
+    static Loop find (const AudioSampleBuffer& audio, double sampleRate,
+                      int64 startFrame, int64 endFrame)
+    {
+        return find (audio, sampleRate, startFrame, endFrame, Options());
+    }
+};
+
+}
@@ -0,0 +1,161 @@
+#include "analysis/SampleAnalyzer.h"
+#include "ProjectWatcher.h"
+
+namespace vcp {
+
+class SampleAnalyzer::Job : public ThreadPoolJob
+{
+public:
+    Job (SampleAnalyzer& a, const Sample& sample)
+        : ThreadPoolJob (sample.getFile().getFileName()),
+          analyzer (a),
+          uuid (sample.getUuidString()),
+          file (sample.getFile()),
+          note (sample.getNote()),
+          startTime (sample.getStartTime()),
+          endTime (sample.getEndTime())
+    { }
+
+    JobStatus runJob() override
+    {
+        NamedValueSet values;
+        std::unique_ptr<AudioFormatReader> reader (analyzer.formats.createReaderFor (file));
+        if (reader != nullptr && reader->lengthInSamples > 0 && ! shouldExit())
+        {
+            Source source;
+            source.sampleRate = reader->sampleRate;
+            source.note = note;
+            source.file = file;
+            source.audio.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+            reader->read (&source.audio, 0, (int) reader->lengthInSamples, 0, true, true);
+            source.startFrame = jlimit ((int64) 0, reader->lengthInSamples,
+                                        static_cast<int64> (startTime * reader->sampleRate));
+            source.endFrame   = endTime > startTime
+                ? jlimit (source.startFrame, reader->lengthInSamples, static_cast<int64> (endTime * reader->sampleRate))
+                : reader->lengthInSamples;
+
+            for (const auto& analysis : analyzer.analyses)
+            {
+                if (shouldExit())
+                    break;
+                analysis (source, values);
+            }
+        }
+        else
+        {
+            DBG("[VCP] could not decode " << file.getFileName() << " for analysis");
+        }
+
+        analyzer.jobFinished (uuid, values);
+        return jobHasFinished;
+    }
+
+private:
+    SampleAnalyzer& analyzer;
+    const String uuid;
+    const File file;
+    const int note;
+    const double startTime;
+    const double endTime;
+};
+
+//=============================================================================
+SampleAnalyzer::SampleAnalyzer (AudioFormatManager& f)
+    : formats (f),
+      pool (jmax (1, SystemStats::getNumCpus() - 1))
+{ }
+
+SampleAnalyzer::~SampleAnalyzer()
+{
+    cancel();
+}
+
+void SampleAnalyzer::addAnalysis (Analysis analysis)
+{
+    jassert (! running);
+    analyses.add (analysis);
+}
+
+Result SampleAnalyzer::start (const Project& newProject)
+{
+    if (running)
+        return Result::fail ("analysis already in progress");
+
+    project = newProject;
+    numJobs = numDone = 0;
+    results.clearQuick();
+
+    for (int i = 0; i < project.getNumSamples(); ++i)
+    {
+        const auto sample = project.getSample (i);
+        if (! sample.getFile().existsAsFile())
+            continue;
+        if (shouldAnalyze && ! shouldAnalyze (sample))
+            continue;
+        pool.addJob (new Job (*this, sample), true);
+        ++numJobs;
+    }
+
+    if (numJobs <= 0)
+        return Result::fail ("no samples to analyze");
+
+    running = true;
+    return Result::ok();
+}
+
+void SampleAnalyzer::cancel()
+{
+    pool.removeAllJobs (true, 10 * 1000);
+    cancelPendingUpdate();
+    ScopedLock sl (lock);
+    results.clearQuick();
+    running = false;
+}
+
+double SampleAnalyzer::getProgress() const
+{
+    return numJobs > 0 ? static_cast<double> (numDone) / numJobs : 0.0;
+}
+
+void SampleAnalyzer::jobFinished (const String& uuid, const NamedValueSet& values)
+{
+    {
+        ScopedLock sl (lock);
+        results.add ({ uuid, values });
+    }
+    triggerAsyncUpdate();
+}
+
+void SampleAnalyzer::handleAsyncUpdate()
+{
+    Array<Analyzed> finished;
+    {
+        ScopedLock sl (lock);
+        finished.swapWith (results);
+    }
+
+    {
+        // listeners see the whole batch as one change
+        ProjectWatcher::Transaction transaction;
+        for (const auto& result : finished)
+        {
+            auto sample = project.findSample (result.uuid);
+            if (sample.isValid())
+                for (const auto& value : result.values)
+                    sample.setProperty (value.name, value.value);
+            ++numDone;
+        }
+    }
+
+    if (onProgress)
+        onProgress();
+
+    if (running && numDone >= numJobs)
+    {
+        running = false;
+        if (onFinished)
+            onFinished();
+    }
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include "Project.h"
+
+namespace vcp {
+
+/** Decodes every sample of a project on a pool of threads and runs a set of
+    analyses on each. Results are written to the samples' ValueTrees on the
+    message thread. */
+class SampleAnalyzer : private AsyncUpdater
+{
+public:
+    /** A decoded sample handed to each analysis */
+    struct Source
+    {
+        AudioSampleBuffer audio;
+        double sampleRate   = 0.0;
+        int64 startFrame    = 0;    // trimmed region
+        int64 endFrame      = 0;
+        int note            = 0;
+        File file;
+    };
+
+    /** Called on a pool thread, add properties to set on the sample to results */
+    using Analysis = std::function<void (const Source&, NamedValueSet& results)>;
+
+    explicit SampleAnalyzer (AudioFormatManager& formats);
+    ~SampleAnalyzer();
+
+    /** Adds an analysis to run, call before starting */
+    void addAnalysis (Analysis analysis);
+
+    /** Optionally limits which samples are analyzed */
+    std::function<bool (const Sample&)> shouldAnalyze;
+
+    /** Starts analyzing all samples of the project */
+    Result start (const Project& project);
+
+    /** Stops analyzing, results not yet applied are dropped */
+    void cancel();
+
+    bool isRunning() const { return running; }
+    double getProgress() const;
+
+    std::function<void()> onProgress;
+    std::function<void()> onFinished;
+
+private:
+    class Job;
+    AudioFormatManager& formats;
+    ThreadPool pool;
+    Array<Analysis> analyses;
+    Project project;
+    bool running = false;
+    int numJobs = 0;
+    int numDone = 0;
+
+    CriticalSection lock;
+    struct Analyzed { String uuid; NamedValueSet values; };
+    Array<Analyzed> results;
+
+    void jobFinished (const String& uuid, const NamedValueSet& values);
+    void handleAsyncUpdate() override;
+};
+
+}
@@ -0,0 +1,253 @@
+#include "analysis/FFT.h"
+#include "analysis/SampleStats.h"
+
+namespace vcp {
+
+namespace {
+
+const float minimumLevel = -120.f;
+
+float toDecibels (double gain)
+{
+    return Decibels::gainToDecibels (static_cast<float> (gain), minimumLevel);
+}
+
+double getSumOfSquares (const float* data, int numFrames)
+{
+    // four accumulators so the compiler can vectorize
+    double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+        for (int j = 0; j < 4; ++j)
+            sums[j] += data[i + j] * data[i + j];
+    for (; i < numFrames; ++i)
+        sums[0] += data[i] * data[i];
+    return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+/** A direct form I biquad with double precision state */
+struct Biquad
+{
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+
+    double process (double x)
+    {
+        const double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1; x1 = x;
+        y2 = y1; y1 = y;
+        return y;
+    }
+};
+
+/** The two K-weighting stages from ITU-R BS.1770 for any sample rate */
+void createKWeighting (double sampleRate, Biquad& shelf, Biquad& highPass)
+{
+    {
+        const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+        const double k  = std::tan (MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow (10.0, gain / 20.0);
+        const double vb = std::pow (vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k  = std::tan (MathConstants<double>::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+}
+
+void clampRange (const AudioSampleBuffer& audio, int64& start, int64& end)
+{
+    start = jlimit ((int64) 0, (int64) audio.getNumSamples(), start);
+    end   = jlimit (start, (int64) audio.getNumSamples(), end);
+}
+
+}
+
+float SampleStats::getPeak (const AudioSampleBuffer& audio, int64 start, int64 end)
+{
+    clampRange (audio, start, end);
+    float peak = 0.f;
+    for (int c = 0; c < audio.getNumChannels(); ++c)
+    {
+        const auto range = FloatVectorOperations::findMinAndMax (
+            audio.getReadPointer (c, (int) start), (int) (end - start));
+        peak = jmax (peak, std::abs (range.getStart()), std::abs (range.getEnd()));
+    }
+
+    return toDecibels (peak);
+}
+
+float SampleStats::getRMS (const AudioSampleBuffer& audio, int64 start, int64 end)
+{
+    clampRange (audio, start, end);
+    const int numFrames = (int) (end - start);
+    if (numFrames <= 0 || audio.getNumChannels() <= 0)
+        return minimumLevel;
+
+    double sum = 0.0;
+    for (int c = 0; c < audio.getNumChannels(); ++c)
+        sum += getSumOfSquares (audio.getReadPointer (c, (int) start), numFrames);
+    return toDecibels (std::sqrt (sum / (static_cast<double> (numFrames) * audio.getNumChannels())));
+}
+
+float SampleStats::getLoudness (const AudioSampleBuffer& audio, double sampleRate,
+                                int64 start, int64 end)
+{
+    clampRange (audio, start, end);
+    const int numFrames = (int) (end - start);
+    if (numFrames <= 0 || sampleRate <= 0.0)
+        return minimumLevel;
+
+    // mean square of the K-weighted signal in 100 ms steps
+    const int step = roundToInt (sampleRate * 0.1);
+    const int numSteps = jmax (1, numFrames / step);
+    HeapBlock<double> power ((size_t) numSteps, true);
+
+    for (int c = 0; c < audio.getNumChannels(); ++c)
+    {
+        Biquad shelf, highPass;
+        createKWeighting (sampleRate, shelf, highPass);
+        const auto* const data = audio.getReadPointer (c, (int) start);
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const double y = highPass.process (shelf.process (data[i]));
+            power [jmin (numSteps - 1, i / step)] += y * y;
+        }
+    }
+
+    // 400 ms blocks overlapping by 75%, a shorter sample is a single block
+    Array<double> blocks;
+    const int stepsPerBlock = jmin (4, numSteps);
+    for (int i = 0; i + stepsPerBlock <= numSteps; ++i)
+    {
+        double sum = 0.0;
+        for (int j = 0; j < stepsPerBlock; ++j)
+            sum += power [i + j];
+        blocks.add (sum / jmin (numFrames, step * stepsPerBlock));
+    }
+
+    auto toLoudness = [] (double meanSquare) {
+        return meanSquare > 0.0 ? -0.691 + 10.0 * std::log10 (meanSquare) : (double) minimumLevel;
+    };
+
+    auto getGatedMean = [&] (double threshold) {
+        double sum = 0.0;
+        int count = 0;
+        for (const auto block : blocks)
+        {
+            if (toLoudness (block) > threshold)
+            {
+                sum += block;
+                ++count;
+            }
+        }
+        return count > 0 ? sum / count : 0.0;
+    };
+
+    // absolute gate at -70 LUFS, then relative gate 10 LU below
+    const double relativeGate = toLoudness (getGatedMean (-70.0)) - 10.0;
+    return static_cast<float> (jmax ((double) minimumLevel, toLoudness (getGatedMean (jmax (-70.0, relativeGate)))));
+}
+
+float SampleStats::getNoiseFloor (const AudioSampleBuffer& audio, double sampleRate)
+{
+    const int window = jmax (1, roundToInt (sampleRate * 0.05));
+    const int numChannels = audio.getNumChannels();
+    double lowest = -1.0;
+
+    for (int i = 0; i + window <= audio.getNumSamples(); i += window)
+    {
+        double sum = 0.0;
+        for (int c = 0; c < numChannels; ++c)
+            sum += getSumOfSquares (audio.getReadPointer (c, i), window);
+        if (sum <= 0.0)
+            continue;
+        if (lowest < 0.0 || sum < lowest)
+            lowest = sum;
+    }
+
+    return lowest > 0.0 ? toDecibels (std::sqrt (lowest / (static_cast<double> (window) * numChannels)))
+                        : minimumLevel;
+}
+
+double SampleStats::getFundamental (const AudioSampleBuffer& audio, double sampleRate,
+                                    int64 start, int64 end)
+{
+    clampRange (audio, start, end);
+    const int minLag = jmax (2, roundToInt (sampleRate / 4000.0));
+    const int maxLag = roundToInt (sampleRate / 25.0);
+
+    // analyse the sustain, skipping the attack
+    const int64 length = end - start;
+    const int64 offset = start + length / 5;
+    const int numFrames = (int) jmin (length / 2, (int64) (1 << 15));
+    if (numFrames < maxLag * 2 || audio.getNumChannels() <= 0)
+        return 0.0;
+
+    using Complex = FFT::Complex;
+    FFT fft (FFT::getOrderFor (numFrames * 2));
+    HeapBlock<Complex> data ((size_t) fft.getSize(), true);
+    for (int c = 0; c < audio.getNumChannels(); ++c)
+    {
+        const auto* const input = audio.getReadPointer (c, (int) offset);
+        for (int i = 0; i < numFrames; ++i)
+            data[i] += input[i];
+    }
+
+    fft.perform (data.get(), false);
+    for (int i = 0; i < fft.getSize(); ++i)
+        data[i] = std::norm (data[i]);
+    fft.perform (data.get(), true);
+
+    const double energy = data[0].real();
+    if (energy <= 0.0)
+        return 0.0;
+
+    auto correlation = [&] (int lag) {
+        return data[lag].real() / energy * numFrames / static_cast<double> (numFrames - lag);
+    };
+
+    double highest = 0.0;
+    for (int lag = minLag; lag <= maxLag; ++lag)
+        highest = jmax (highest, correlation (lag));
+    if (highest < 0.5)
+        return 0.0;
+
+    // the first strong peak is the period, later ones are multiples of it
+    for (int lag = minLag; lag < maxLag; ++lag)
+    {
+        const double value = correlation (lag);
+        if (value < 0.9 * highest || value < correlation (lag - 1) || value < correlation (lag + 1))
+            continue;
+
+        const double before = correlation (lag - 1), after = correlation (lag + 1);
+        const double denominator = before - 2.0 * value + after;
+        const double shift = denominator != 0.0 ? 0.5 * (before - after) / denominator : 0.0;
+        return sampleRate / (lag + jlimit (-0.5, 0.5, shift));
+    }
+
+    return 0.0;
+}
+
+double SampleStats::getCents (double frequency, int note)
+{
+    if (frequency <= 0.0)
+        return 0.0;
+    const double cents = 1200.0 * std::log2 (frequency / 440.0) - 100.0 * (note - 69);
+    return cents - 1200.0 * std::round (cents / 1200.0);
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Level and pitch measurements of captured samples. Each works on the
+    frames from start to end of all channels in the buffer. Levels don't go
+    below -120 dB. */
+struct SampleStats
+{
+    /** Returns the absolute peak level in dBFS */
+    static float getPeak (const AudioSampleBuffer& audio, int64 start, int64 end);
+
+    /** Returns the RMS level of all channels in dBFS */
+    static float getRMS (const AudioSampleBuffer& audio, int64 start, int64 end);
+
+    /** Returns the integrated loudness in LUFS as defined by EBU R128,
+        i.e. K-weighted and gated */
+    static float getLoudness (const AudioSampleBuffer& audio, double sampleRate,
+                              int64 start, int64 end);
+
+    /** Returns the level of the quietest 50 ms of the whole buffer in dBFS,
+        digital silence is ignored */
+    static float getNoiseFloor (const AudioSampleBuffer& audio, double sampleRate);
+
+    /** Returns the fundamental frequency in Hz of the sustained part
+        between start and end, or zero if no clear pitch was found */
+    static double getFundamental (const AudioSampleBuffer& audio, double sampleRate,
+                                  int64 start, int64 end);
+
+    /** Returns the deviation in cents of a frequency from a MIDI note,
+        folded to +/- 600 cents so octave errors don't count */
+    static double getCents (double frequency, int note);
+};
+
+}
@@ -1,5 +1,6 @@
 
 #include "controllers/GuiController.h"
+#include "gui/DiagnosticsComponent.h"
 #include "gui/LookAndFeel.h"
 #include "gui/MainWindow.h"
 #include "Commands.h"
@@ -19,6 +20,7 @@ void GuiController::initialize()
 void GuiController::shutdown()
 {
     versicap.closePluginWindow();
+    diagnostics.reset();
 
     if (window != nullptr)
     {
@@ -61,6 +63,9 @@ void GuiController::getCommandInfo (CommandID commandID, ApplicationCommandInfo&
         case Commands::showLicenseManagement:
             result.setInfo ("Manage License...", "Manage your Versicap license", "Application", 0);
             break;
+        case Commands::showDiagnostics:
+            result.setInfo ("Engine Diagnostics", "Show audio engine timing and xruns", "Application", 0);
+            break;
     }
 }
 
@@ -78,6 +83,13 @@ bool GuiController::perform (const ApplicationCommandTarget::InvocationInfo& inf
             
         } break;
 
+        case Commands::showDiagnostics:
+        {
+            if (diagnostics == nullptr)
+                new DiagnosticsWindow (diagnostics, versicap);
+            diagnostics->toFront (true);
+        } break;
+
         default: handled = false;
             break;
     }
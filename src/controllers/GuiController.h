@@ -5,6 +5,7 @@
 namespace vcp {
 
 class ContentComponent;
+class DiagnosticsWindow;
 class LookAndFeel;
 class MainWindow;
 
@@ -30,6 +31,7 @@ private:
     std::unique_ptr<LookAndFeel> look;
     std::unique_ptr<MainWindow> window;
     std::unique_ptr<Component> unlock;
+    std::unique_ptr<DiagnosticsWindow> diagnostics;
     ValueTree displayedObject;
 
     ContentComponent* getContent();
@@ -284,6 +284,13 @@ void ProjectsController::getCommandInfo (CommandID commandID, ApplicationCommand
             result.addDefaultKeypress ('e', ModifierKeys::commandModifier);
             result.setInfo ("Eport Project", "Export all targets", "Project", 0);
             break;
+        case Commands::projectFindLoops:
+            result.setInfo ("Find Loop Points", "Find loop points for all samples", "Project", flags);
+            break;
+        case Commands::projectPreviewContainer:
+            result.setInfo ("Preview Container", "Audition an exported instrument container", "Project",
+                versicap.getAudioEngine().isPreviewingContainer() ? ApplicationCommandInfo::isTicked : 0);
+            break;
     }
 }
 
@@ -319,6 +326,33 @@ bool ProjectsController::perform (const ApplicationCommandTarget::InvocationInfo
                     "Versicap", result.getErrorMessage(), Versicap::getMainWindow());
         } break;
 
+        case Commands::projectFindLoops:
+        {
+            auto result = versicap.findLoopPoints();
+            if (result.failed())
+                NativeMessageBox::showMessageBoxAsync (AlertWindow::WarningIcon,
+                    "Versicap", result.getErrorMessage(), Versicap::getMainWindow());
+        } break;
+
+        case Commands::projectPreviewContainer:
+        {
+            auto& engine = versicap.getAudioEngine();
+            if (engine.isPreviewingContainer())
+            {
+                engine.setPreviewContainer (File());
+                break;
+            }
+
+            FileChooser chooser ("Preview Container", versicap.getProject().getDataPath(),
+                                 "*.vcpi", true, false, nullptr);
+            if (! chooser.browseForFileToOpen())
+                break;
+            auto result = engine.setPreviewContainer (chooser.getResult());
+            if (result.failed())
+                NativeMessageBox::showMessageBoxAsync (AlertWindow::WarningIcon,
+                    "Versicap", result.getErrorMessage(), Versicap::getMainWindow());
+        } break;
+
         default: handled = false;
             break;
     }
@@ -1,12 +1,14 @@
 
 #include "engine/AudioEngine.h"
 #include "engine/Render.h"
+#include "engine/RenderWorker.h"
 #include "PluginManager.h"
+#include "Utils.h"
 #include "IncludeKSP1.h"
 
 namespace vcp {
 
-class AudioEngine::SampleSoundSync : private ValueTree::Listener
+class AudioEngine::SampleSoundSync
 {
 public:
     SampleSoundSync (const Sample& sampleToMonitor,
@@ -15,47 +17,32 @@ public:
         : sample (sampleToMonitor),
           sound (soundToUpdate),
           soundLayerIdx (layerDataIndex)
-    {
-        data = sample.getValueTree();
-        data.addListener (this);
-    }
+    { }
 
     ~SampleSoundSync()
     {
-        data.removeListener (this);
         sound.reset();
     }
 
-private:
-    Sample sample;
-    ValueTree data;
-    KSP1::SamplerSoundPtr sound;
-    int soundLayerIdx;
-
-    void valueTreePropertyChanged (ValueTree& tree, const Identifier& prop) override
+    /** Applies the latest trim points if the sample changed, called with
+        the project's coalesced changes so dragging a marker updates the
+        sound once per tick */
+    void update (const ProjectWatcher::Delta& delta)
     {
         auto* const layerData = sound != nullptr ? sound->getLayer (soundLayerIdx) : nullptr;
-        if (! layerData || tree != data)
+        if (! layerData || ! delta.hasChanged (sample.getValueTree()))
             return;
-        
-        const var& value = tree.getProperty (prop);
-        // DBG(prop.toString() << " = " << value.toString());
 
-        if (prop == Tags::timeIn)
-        {
-            layerData->setStartTime ((double) value);
-        }
-        else if (prop == Tags::timeOut)
-        {
-            layerData->setEndTime ((double) value);
-        }
+        if (delta.hasChanged (Tags::timeIn))
+            layerData->setStartTime ((double) sample.getProperty (Tags::timeIn));
+        if (delta.hasChanged (Tags::timeOut))
+            layerData->setEndTime ((double) sample.getProperty (Tags::timeOut));
     }
 
-    void valueTreeChildAdded (ValueTree& parentTree, ValueTree& childWhichHasBeenAdded) override {}
-    void valueTreeChildRemoved (ValueTree& parentTree, ValueTree& childWhichHasBeenRemoved, int indexFromWhichChildWasRemoved) override {}
-    void valueTreeChildOrderChanged (ValueTree& parentTreeWhoseChildrenHaveMoved, int oldIndex, int newIndex) override {}
-    void valueTreeParentChanged (ValueTree& treeWhoseParentHasChanged) override {}
-    void valueTreeRedirected (ValueTree& treeWhichHasBeenChanged) override {}
+private:
+    Sample sample;
+    KSP1::SamplerSoundPtr sound;
+    int soundLayerIdx;
 };
 
 AudioEngine::AudioEngine (AudioFormatManager& formatManager,
@@ -65,13 +52,14 @@ AudioEngine::AudioEngine (AudioFormatManager& formatManager,
       plugins (pluginManager),
       sampleCache (cache)
 {
-    monitor = new Monitor();
+    monitor = new OutputMeter();
 
     sampler.reset (KSP1::SamplerSynth::create (sampleCache));
     
     render.reset (new Render (formatManager));
     render->onCancelled = [this]()
     {
+        closeRigOutputs();
         if (onRenderCancelled)
             onRenderCancelled();
         panic();
@@ -80,6 +68,8 @@ AudioEngine::AudioEngine (AudioFormatManager& formatManager,
     render->onStarted   = [this]() { if (onRenderStarted)   onRenderStarted(); };
     render->onStopped   = [this]()
     { 
+        closeRigOutputs();
+        DBG("[VCP] midi: " << midiScheduler.getStats().toString());
         if (onRenderStopped)
             onRenderStopped();
         panic();
@@ -89,23 +79,52 @@ AudioEngine::AudioEngine (AudioFormatManager& formatManager,
     {
         if (onRenderProgress)
         {
-            auto title = render->getNextProgressTitle();
-            auto progress = render->getProgress();
-            onRenderProgress (progress, title);
+            auto title = render->getProgressTitle();
+            const auto remaining = render->getTimeRemaining();
+            if (remaining >= 0.0)
+                title << " (" << Util::durationValue (remaining) << " remaining)";
+            onRenderProgress (render->getProgress(), title);
         }
     };
 
+    render->onFinalizeProgress = [this] (double progress, const String& title)
+    {
+        if (onRenderProgress)
+            onRenderProgress (progress, title);
+    };
+
+    workers.reset (new RenderWorkerPool (formatManager));
+    workers->onStarted   = [this]() { if (onRenderStarted)   onRenderStarted(); };
+    workers->onStopped   = [this]() { if (onRenderStopped)   onRenderStopped(); };
+    workers->onCancelled = [this]() { if (onRenderCancelled) onRenderCancelled(); };
+    workers->onProgress  = [this] (double progress, const String& title)
+    {
+        if (onRenderProgress)
+            onRenderProgress (progress, title);
+    };
+
     watcher.onChanged = std::bind (&AudioEngine::onProjectLoaded, this);
     watcher.onActiveSampleChanged = std::bind (&AudioEngine::onActiveSampleChanged, this);
+    watcher.onDelta = [this] (const ProjectWatcher::Delta& delta)
+    {
+        if (sampleSoundSync != nullptr)
+            sampleSoundSync->update (delta);
+    };
 }
 
 AudioEngine::~AudioEngine()
 {
     watcher.onChanged = nullptr;
     watcher.onActiveSampleChanged = nullptr;
+    watcher.onDelta = nullptr;
     
     render->onCancelled = render->onStarted = render->onStopped = nullptr;
+    render->onFinalizeProgress = nullptr;
     render.reset();
+
+    workers->onStarted = workers->onStopped = workers->onCancelled = nullptr;
+    workers->onProgress = nullptr;
+    workers.reset();
 }
 
 void AudioEngine::setProject (const Project& project)
@@ -224,12 +243,32 @@ void AudioEngine::clearAudioProcessor()
         deleter->releaseResources();
 }
 
-bool AudioEngine::isRendering() const { return render && render->isRendering(); }
-void AudioEngine::cancelRendering() { if (render) render->cancel(); }
-void AudioEngine::setRenderContext (const RenderContext& context) { if (render) render->setContext (context); }
+bool AudioEngine::isRendering() const
+{
+    return (render && (render->isRendering() || render->isFinalizing()))
+        || (workers && workers->isRendering());
+}
 
-Result AudioEngine::startRendering (const RenderContext& context)
+void AudioEngine::cancelRendering()
 {
+    if (render) render->cancel();
+    if (workers) workers->cancel();
+}
+
+void AudioEngine::setRenderContext (const RenderContext& context)
+{
+    if (! render)
+        return;
+    render->setContext (context);
+    prepareRenderBuffer (context);
+}
+
+Result AudioEngine::startRendering (const RenderContext& renderContext)
+{
+    RenderContext context (renderContext);
+    if (latencyProbe.isRunning())
+        return Result::fail ("Cannot render while measuring latency");
+
     int latency = 0;
 
     if (context.source == SourceType::AudioPlugin)
@@ -237,10 +276,27 @@ Result AudioEngine::startRendering (const RenderContext& context)
         if (processor == nullptr)
             return Result::fail ("No plugin selected to render");
         latency = processor->getLatencySamples();
+        context.sourceKey = getPluginSourceKey();
+
+        // each worker process loads its own copy of the plugin
+        auto* const instance = dynamic_cast<AudioPluginInstance*> (processor.get());
+        if (context.workers != 0 && instance != nullptr)
+        {
+            if (isRendering())
+                return Result::fail ("recording already in progress");
+            MemoryBlock state;
+            processor->getStateInformation (state);
+            const auto result = workers->start (context, instance->getPluginDescription(),
+                                                state, sampleRate);
+            renderedByWorkers = result.wasOk();
+            return result;
+        }
     }
     else if (context.source == SourceType::Hardware)
     {
-        latency = inputLatency + roundToInt (0.001 * sampleRate);
+        latency = context.measuredLatency >= 0.0 
+            ? roundToInt (context.measuredLatency * 0.001 * sampleRate)
+            : inputLatency + roundToInt (0.001 * sampleRate);
     }
     else
     {
@@ -248,12 +304,141 @@ Result AudioEngine::startRendering (const RenderContext& context)
         return Result::fail (String("Invalid source specified: ") + String (context.source));
     }
 
-    render->start (context, latency);
-    return Result::ok();
+    renderedByWorkers = false;
+    midiScheduler.resetStats();
+    openRigOutputs (context);
+    prepareRenderBuffer (context);
+    const auto result = render->start (context, latency);
+    if (result.failed())
+        closeRigOutputs();
+    return result;
+}
+
+String AudioEngine::getPluginSourceKey() const
+{
+    if (processor == nullptr)
+        return { };
+
+    String key;
+    if (auto* const instance = dynamic_cast<AudioPluginInstance*> (processor.get()))
+        key << instance->getPluginDescription().createIdentifierString();
+    else
+        key << processor->getName();
+
+    MemoryBlock state;
+    processor->getStateInformation (state);
+    key << ":" << SHA256 (state.getData(), state.getSize()).toHexString();
+    return key;
+}
+
+void AudioEngine::prepareRenderBuffer (const RenderContext& context)
+{
+    const int numChannels = jmax (1, context.channels * context.getNumRigs());
+    ScopedLock sl (render->getCallbackLock());
+    if (numChannels <= renderBufferChannels && renderBuffer.getNumSamples() >= bufferSize)
+        return;
+    renderBufferChannels = jmax (renderBufferChannels, numChannels);
+    renderBuffer.setSize (renderBufferChannels, jmax (1, bufferSize), false, true, true);
+}
+
+void AudioEngine::openRigOutputs (const RenderContext& context)
+{
+    OwnedArray<MidiOutput> newOutputs;
+    OwnedArray<MidiBuffer> newBuffers;
+    const auto devices = MidiOutput::getDevices();
+
+    for (int i = 0; i < context.getNumRigs(); ++i)
+    {
+        auto* const buffer = newBuffers.add (new MidiBuffer());
+        buffer->ensureSize (2048);
+
+        const String name = isPositiveAndBelow (i, context.rigs.size())
+            ? context.rigs.getReference(i).midiOutput : String();
+        
+        // rigs without a device, or using the default one, go to midiOut
+        if (name.isEmpty() || name == midiOutName)
+        {
+            newOutputs.add (nullptr);
+            continue;
+        }
+
+        auto* const out = newOutputs.add (MidiOutput::openDevice (devices.indexOf (name)));
+        if (out != nullptr)
+            DBG("[VCP] rig " << i << " midi out: " << out->getName());
+    }
+
+    {
+        ScopedLock sl (render->getCallbackLock());
+        rigOutputs.swapWith (newOutputs);
+        rigMidi.swapWith (newBuffers);
+    }
+
+    for (auto* const out : newOutputs)
+        midiScheduler.removeOutput (out);
+}
+
+void AudioEngine::closeRigOutputs()
+{
+    OwnedArray<MidiOutput> oldOutputs;
+    {
+        ScopedLock sl (render->getCallbackLock());
+        rigOutputs.swapWith (oldOutputs);
+    }
+
+    for (auto* const out : oldOutputs)
+        midiScheduler.removeOutput (out);
+}
+
+Result AudioEngine::startLatencyMeasurement (const LatencyProbe::Options& options,
+                                             const String& midiOutputName,
+                                             std::function<void(const Result&, double)> callback)
+{
+    if (isRendering())
+        return Result::fail ("Cannot measure latency while rendering");
+
+    std::unique_ptr<MidiOutput> newOutput;
+    if (options.mode == LatencyProbe::MidiNote && 
+        midiOutputName.isNotEmpty() && midiOutputName != midiOutName)
+    {
+        newOutput.reset (MidiOutput::openDevice (MidiOutput::getDevices().indexOf (midiOutputName)));
+        if (newOutput == nullptr)
+            return Result::fail (String ("Could not open MIDI output: ") + midiOutputName);
+    }
+
+    Result result = Result::ok();
+    {
+        ScopedLock sl (render->getCallbackLock());
+        latencyProbe.onFinished = [this, callback](const Result& r, int latencySamples)
+        {
+            closeProbeOutput();
+            const double millis = sampleRate > 0.0 ? 1000.0 * latencySamples / sampleRate : 0.0;
+            if (callback)
+                callback (r, millis);
+        };
+
+        result = latencyProbe.start (options);
+        if (result.wasOk())
+            probeOutput.swap (newOutput);
+    }
+
+    return result;
+}
+
+void AudioEngine::closeProbeOutput()
+{
+    std::unique_ptr<MidiOutput> deleter;
+    {
+        ScopedLock sl (render->getCallbackLock());
+        deleter.swap (probeOutput);
+    }
+
+    midiScheduler.removeOutput (deleter.get());
 }
 
 ValueTree AudioEngine::getRenderedSamples() const
 {
+    if (renderedByWorkers)
+        return workers->getSamples();
     return (render != nullptr) ? render->getSamples() : ValueTree();
 }
 
@@ -274,9 +459,7 @@ void AudioEngine::setDefaultMidiOutput (const String& name)
             deleter.swap (midiOut);
         }
         
-        if (deleter)
-            deleter->stopBackgroundThread();
-
+        midiScheduler.removeOutput (deleter.get());
         return;
     }
 
@@ -285,7 +468,6 @@ void AudioEngine::setDefaultMidiOutput (const String& name)
 
     if (newout)
     {
-        newout->startBackgroundThread();
         midiOutName = newout->getName();
         ScopedLock rsl (render->getCallbackLock());
         midiOut.swap (newout);
@@ -295,7 +477,7 @@ void AudioEngine::setDefaultMidiOutput (const String& name)
     if (newout)
     {
         DBG("[VCP] stopping: " << newout->getName());
-        newout->stopBackgroundThread();
+        midiScheduler.removeOutput (newout.get());
         newout.reset();
     }
 }
@@ -304,12 +486,34 @@ void AudioEngine::setPreviewActiveSample (bool previewing)
 {
     const auto project  = watcher.getProject();
     const auto sample   = project.getActiveSample();
+
+    if (containerPreview.hasContainer())
+    {
+        const auto layer = project.findSampleSet (sample.getSampleSetUuidString());
+        if (previewing)
+            containerPreview.noteOn (sample.getNote(), layer.isValid() ? (int) layer.getVelocity() : 127);
+        else
+            containerPreview.noteOff (sample.getNote());
+        return;
+    }
+
     MidiMessage message = previewing ? MidiMessage::noteOn  (1, sample.getNote(), (uint8) 127)
                                      : MidiMessage::noteOff (1, sample.getNote());
     message.setTimeStamp (1.0 + Time::getMillisecondCounterHiRes());
     samplerMidiCollector.addMessageToQueue (message);
 }
 
+Result AudioEngine::setPreviewContainer (const File& file)
+{
+    if (file == File())
+    {
+        containerPreview.clearContainer();
+        return Result::ok();
+    }
+
+    return containerPreview.setContainer (file);
+}
+
 void AudioEngine::updatePluginProperties()
 {
     if (! processor)
@@ -343,8 +547,6 @@ void AudioEngine::prepare (AudioProcessor& plugin)
 
 void AudioEngine::release (AudioProcessor& plugin)
 {
-    monitor->levelLeft.set (0.f);
-    monitor->levelRight.set (0.f);
     plugin.releaseResources();
 }
 
@@ -355,6 +557,9 @@ void AudioEngine::process (const float** input, int numInputs,
     ScopedNoDenormals denormals;
     const auto nbytes = sizeof (float) * static_cast<size_t> (nframes);
 
+    // before anything else so the callback time is measured accurately
+    midiScheduler.beginBlock (nframes);
+
     if (shouldProcess.get() != 1)
     {
         for (int c = 0; c < numOutputs; ++c)
@@ -362,6 +567,7 @@ void AudioEngine::process (const float** input, int numInputs,
         return;
     }
 
+    EngineStats::Cycle cycle (stats, nframes, sampleRate);
     messageCollector.removeNextBlockOfMessages (incomingMidi, nframes);
     samplerMidiCollector.removeNextBlockOfMessages (samplerMidi, nframes);
 
@@ -371,7 +577,11 @@ void AudioEngine::process (const float** input, int numInputs,
     const bool rendering    = render->isRendering();
     const auto& context     = render->getContext();
     const int source        = render->getSourceType();
-    renderBuffer.setSize (context.channels, nframes, false, false, true);
+    const int numRigs       = render->getNumRigs();
+    // sized by prepareRenderBuffer, shrinking it here doesn't allocate
+    jassert (context.channels * numRigs <= renderBufferChannels && nframes <= bufferSize);
+    renderBuffer.setSize (jmin (context.channels * numRigs, renderBufferChannels),
+                          nframes, false, false, true);
     pluginBuffer.setSize (pluginChannels, nframes, false, false, true);
     samplerAudio.setSize (2, nframes, false, false, true);
     
@@ -386,6 +596,8 @@ void AudioEngine::process (const float** input, int numInputs,
         }
     }
 
+    cycle.lap (EngineStats::midi);
+
     if (auto* const proc = processor.get())
     {
         // plugin will clear the buffer so make a copy;
@@ -394,11 +606,34 @@ void AudioEngine::process (const float** input, int numInputs,
         proc->processBlock (pluginBuffer, pluginMidi);
     }
 
-    if (auto* const out = midiOut.get())
+    cycle.lap (EngineStats::plugin);
+
+    if (rendering && source == SourceType::Hardware)
     {
-        if (! rendering || (rendering && source == SourceType::Hardware))
-            out->sendBlockOfMessages (renderMidi, Time::getMillisecondCounterHiRes() + 1.0,
-                                      sampleRate);
+        for (int r = 0; r < numRigs; ++r)
+        {
+            auto* const out = r < rigOutputs.size() && rigOutputs.getUnchecked (r) != nullptr
+                ? rigOutputs.getUnchecked (r) : midiOut.get();
+            if (out == nullptr)
+                continue;
+
+            if (r == 0)
+            {
+                midiScheduler.addEvents (out, renderMidi);
+            }
+            else if (r < rigMidi.size())
+            {
+                auto& buffer = *rigMidi.getUnchecked (r);
+                render->getNextMidiBlock (buffer, nframes, r);
+                midiScheduler.addEvents (out, buffer);
+                buffer.clear();
+            }
+        }
+    }
+    else if (auto* const out = midiOut.get())
+    {
+        if (! rendering)
+            midiScheduler.addEvents (out, renderMidi);
     }
     
     if (source == SourceType::AudioPlugin)
@@ -430,6 +665,22 @@ void AudioEngine::process (const float** input, int numInputs,
                 renderBuffer.copyFrom (c, 0, pluginBuffer, c, 0, nframes);
         }
     }
+    else if (source == SourceType::Hardware && context.rigs.size() > 0)
+    {
+        // each rig records from its own block of inputs
+        for (int r = 0; r < numRigs; ++r)
+        {
+            const int firstInput = context.rigs.getReference(r).inputChannel;
+            for (int c = 0; c < context.channels; ++c)
+            {
+                const int in = firstInput + c;
+                if (isPositiveAndBelow (in, numInputs))
+                    renderBuffer.copyFrom (r * context.channels + c, 0, input[in], nframes);
+                else
+                    renderBuffer.clear (r * context.channels + c, 0, nframes);
+            }
+        }
+    }
     else if (source == SourceType::Hardware)
     {
         if (numInputs == context.channels)
@@ -463,8 +714,11 @@ void AudioEngine::process (const float** input, int numInputs,
         renderBuffer.clear (0, nframes);
     }
     
+    cycle.lap (EngineStats::routing);
     render->writeAudioFrames (renderBuffer);
     render->renderCycleEnd();
+    cycle.setWriterFill (render->getWriterFill(), render->hasWriterOverflowed());
+    cycle.lap (EngineStats::writer);
 
     MidiBuffer::Iterator iter (samplerMidi);
     MidiMessage msg; int frame;
@@ -474,6 +728,8 @@ void AudioEngine::process (const float** input, int numInputs,
 
     samplerAudio.clear (0, nframes);
     sampler->renderNextBlock (samplerAudio, samplerMidi, 0, nframes);
+    containerPreview.render (samplerAudio, 0, nframes);
+    cycle.lap (EngineStats::sampler);
 
     for (int c = 0; c < numOutputs; ++c)
         memset (output [c], 0, nbytes);
@@ -488,26 +744,32 @@ void AudioEngine::process (const float** input, int numInputs,
         for (int c = jmin(numOutputs, context.channels); --c >= 0;)
             memcpy (output[c], renderBuffer.getReadPointer (c), nbytes);
     }
+
+    // monitor the other rigs on top of the first one
+    for (int r = 1; r < numRigs; ++r)
+        for (int c = jmin (numOutputs, context.channels); --c >= 0;)
+            FloatVectorOperations::add (output[c], renderBuffer.getReadPointer (r * context.channels + c), nframes);
     
     for (int c = jmin (numOutputs, samplerAudio.getNumChannels()); --c >= 0;)
         FloatVectorOperations::add (output[c], samplerAudio.getReadPointer (c), nframes);
 
-    const AudioSampleBuffer rmsBuf (output, numOutputs, nframes);
-    if (numOutputs == 1)
+    if (latencyProbe.isRunning())
     {
-        monitor->levelLeft.set (rmsBuf.getRMSLevel (0, 0, nframes));
-        monitor->levelRight.set (monitor->levelLeft.get());
-    }
-    else if (numOutputs > 1)
-    {
-        monitor->levelLeft.set (rmsBuf.getRMSLevel (0, 0, nframes));
-        monitor->levelRight.set (rmsBuf.getRMSLevel (1, 0, nframes));
+        // sent the same way as rendered notes so the measurement matches
+        latencyProbe.process (input, numInputs, output, numOutputs, probeMidi, nframes);
+        midiScheduler.addEvents (probeOutput != nullptr ? probeOutput.get() : midiOut.get(), probeMidi);
+        probeMidi.clear();
     }
+
+    cycle.lap (EngineStats::routing);
+
+    monitor->process (output, numOutputs, nframes);
     
     incomingMidi.clear();
     pluginMidi.clear();
     renderMidi.clear();
     samplerMidi.clear();
+    cycle.lap (EngineStats::metering);
 }
 
 void AudioEngine::prepare (double expectedSampleRate, int maxBufferSize,
@@ -537,8 +799,14 @@ void AudioEngine::prepare (double expectedSampleRate, int maxBufferSize,
 
     channels.calloc ((size_t) jmax (numInputChans, numOutputChans) + 2);
     render->prepare (sampleRate, bufferSize);
+    prepareRenderBuffer (render->getContext());
+    latencyProbe.prepare (sampleRate, bufferSize);
+    probeMidi.ensureSize (512);
+    midiScheduler.prepare (sampleRate, bufferSize);
 
     sampler->setCurrentPlaybackSampleRate (sampleRate);
+    containerPreview.prepare (sampleRate);
+    monitor->prepare (sampleRate);
     
     if (processor)
     {
@@ -567,6 +835,7 @@ void AudioEngine::release()
 
     render->cancel();
     render->release();
+    latencyProbe.release();
 
     if (processor)
     {
@@ -585,6 +854,7 @@ void AudioEngine::release()
     tempBuffer.setSize (1, 1);
     pluginBuffer.setSize (1, 1);
     renderBuffer.setSize (1, 1);
+    renderBufferChannels = 0;
     channels.free();
 }
 
@@ -1,6 +1,11 @@
 
 #pragma once
 
+#include "engine/ContainerPreview.h"
+#include "engine/EngineStats.h"
+#include "engine/LatencyProbe.h"
+#include "engine/MidiScheduler.h"
+#include "engine/OutputMeter.h"
 #include "ProjectWatcher.h"
 #include "Types.h"
 
@@ -13,6 +18,7 @@ namespace vcp {
 
 class Render;
 class RenderContext;
+class RenderWorkerPool;
 
 class AudioEngine
 {
@@ -22,19 +28,19 @@ public:
                  KSP1::SampleCache&);
     ~AudioEngine();
 
-    struct Monitor : public ReferenceCountedObject
-    {
-        Atomic<float> levelLeft;
-        Atomic<float> levelRight;
-    };
-
-    typedef ReferenceCountedObjectPtr<Monitor> MonitorPtr;
-
     //=========================================================================
     void setProject (const Project& project);
 
     //=========================================================================
-    MonitorPtr getMonitor() const { return monitor; }
+    /** Levels of the device outputs */
+    OutputMeter::Ptr getMonitor() const { return monitor; }
+
+    /** Timing of the audio callback, see EngineStats */
+    EngineStats& getStats() { return stats; }
+
+    /** Timing of MIDI sent to hardware */
+    MidiScheduler::Stats getMidiStats() const { return midiScheduler.getStats(); }
+    void resetMidiStats() { midiScheduler.resetStats(); }
 
     //=========================================================================
     void panic();
@@ -53,6 +59,15 @@ public:
     void setRenderContext (const RenderContext&);
     Result startRendering (const RenderContext& ctx);
     ValueTree getRenderedSamples() const;
+
+    //=========================================================================
+    /** Starts measuring the round trip latency of a hardware path. MIDI test
+        notes are sent to the named output or the default one if empty. The
+        callback receives the latency in milliseconds on the message thread */
+    Result startLatencyMeasurement (const LatencyProbe::Options& options,
+                                    const String& midiOutputName,
+                                    std::function<void(const Result&, double)> callback);
+    bool isMeasuringLatency() const { return latencyProbe.isRunning(); }
     
     //=========================================================================
     void addMidiMessage (const MidiMessage& msg);
@@ -62,6 +77,11 @@ public:
     //=========================================================================
     void setPreviewActiveSample (bool previewing);
 
+    /** Previews notes from an exported instrument container instead of the
+        project's samples. An empty file goes back to the samples */
+    Result setPreviewContainer (const File& file);
+    bool isPreviewingContainer() const { return containerPreview.hasContainer(); }
+
     //=========================================================================
     void prepare (double expectedSampleRate, int maxBufferSize,
                   int numInputs, int numOutputs);
@@ -77,7 +97,8 @@ public:
     std::function<void(double, const String&)> onRenderProgress;
 
 private:
-    MonitorPtr monitor;
+    OutputMeter::Ptr monitor;
+    EngineStats stats;
 
     //=========================================================================
     AudioFormatManager& formats;
@@ -89,6 +110,7 @@ private:
     AudioSampleBuffer samplerAudio;
     MidiBuffer samplerMidi;
     MidiMessageCollector samplerMidiCollector;
+    ContainerPreview containerPreview;
 
     //=========================================================================
     bool prepared = false;
@@ -105,6 +127,9 @@ private:
     //=========================================================================
     std::unique_ptr<Render> render;
     AudioSampleBuffer renderBuffer;
+    int renderBufferChannels = 0;
+    std::unique_ptr<RenderWorkerPool> workers;
+    bool renderedByWorkers = false;
 
     //=========================================================================
     int inputLatency  = 0;
@@ -123,6 +148,16 @@ private:
     //=========================================================================
     std::unique_ptr<MidiOutput> midiOut;
     String midiOutName;
+    OwnedArray<MidiOutput> rigOutputs;
+    OwnedArray<MidiBuffer> rigMidi;
+
+    //=========================================================================
+    LatencyProbe latencyProbe;
+    std::unique_ptr<MidiOutput> probeOutput;
+    MidiBuffer probeMidi;
+
+    // after the outputs so it stops before they are deleted
+    MidiScheduler midiScheduler;
 
     //=========================================================================
     MidiBuffer incomingMidi;
@@ -145,6 +180,15 @@ private:
 
     void addPanicMessages (MidiBuffer&);
 
+    /** Identifies the loaded plugin and its current state for render caching */
+    String getPluginSourceKey() const;
+
+    /** Grows renderBuffer for a context, the audio thread only shrinks it */
+    void prepareRenderBuffer (const RenderContext&);
+    void openRigOutputs (const RenderContext&);
+    void closeRigOutputs();
+    void closeProbeOutput();
+
     void onProjectLoaded();
     void onActiveSampleChanged();
 };
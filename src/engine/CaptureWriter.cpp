@@ -0,0 +1,95 @@
+
+#include "engine/CaptureWriter.h"
+
+namespace vcp {
+
+CaptureWriter::CaptureWriter (AudioFormatWriter* destination, double captureRate)
+    : AudioFormatWriter (nullptr, "Capture", captureRate,
+                         destination->getNumChannels(), 32),
+      writer (destination)
+{
+    usesFloatingPointData = true;
+
+    if (captureRate > 0.0 && std::abs (captureRate - writer->getSampleRate()) > 0.5)
+    {
+        resampler.reset (new Resampler());
+        resampler->prepare ((int) numChannels, captureRate, writer->getSampleRate());
+        buffer.setSize ((int) numChannels, resampler->getMaxOutputFrames (8192), false, true, false);
+    }
+
+    setDither (SampleConverter::NoDither);
+}
+
+void CaptureWriter::setDither (int dither)
+{
+    const int depth = writer->getBitsPerSample();
+    if (writer->isFloatingPoint() || (depth != 16 && depth != 24 && depth != 32))
+    {
+        converter.reset();
+        return;
+    }
+
+    converter.reset (new SampleConverter());
+    converter->prepare ((int) numChannels, depth, dither);
+    channels.calloc (numChannels + 1);   // null terminated for write()
+    convertedSize = 0;
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    if (resampler != nullptr)
+    {
+        for (;;)
+        {
+            const int produced = resampler->flush (buffer.getArrayOfWritePointers(), buffer.getNumSamples());
+            if (produced <= 0)
+                break;
+            writeToDestination (buffer.getArrayOfReadPointers(), produced);
+        }
+    }
+
+    writer.reset();
+}
+
+bool CaptureWriter::write (const int** samplesToWrite, int numSamples)
+{
+    if (written != nullptr)
+        written->fetch_add (numSamples, std::memory_order_relaxed);
+    const auto* const* const data = reinterpret_cast<const float* const*> (samplesToWrite);
+    
+    if (resampler == nullptr)
+        return writeToDestination (data, numSamples);
+    
+    const int required = resampler->getMaxOutputFrames (numSamples);
+    if (required > buffer.getNumSamples())
+        buffer.setSize ((int) numChannels, required, false, true, false);
+
+    const int produced = resampler->process (data, numSamples, buffer.getArrayOfWritePointers());
+    return produced <= 0 || writeToDestination (buffer.getArrayOfReadPointers(), produced);
+}
+
+bool CaptureWriter::writeToDestination (const float* const* data, int numFrames)
+{
+    if (trim != nullptr)
+        trim->process (data, (int) numChannels, numFrames);
+    if (converter == nullptr)
+        return writer->writeFromFloatArrays (data, (int) numChannels, numFrames);
+
+    if (numFrames > convertedSize)
+    {
+        converted.malloc ((size_t) (numFrames * (int) numChannels));
+        convertedSize = numFrames;
+        for (int c = 0; c < (int) numChannels; ++c)
+            channels[c] = converted + c * convertedSize;
+    }
+
+    converter->convert (data, channels, numFrames);
+    return writer->write (const_cast<const int**> (channels.get()), numFrames);
+}
+
+bool CaptureWriter::flush()
+{
+    return writer->flush();
+}
+
+}
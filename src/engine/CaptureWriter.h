@@ -0,0 +1,53 @@
+#pragma once
+
+#include "engine/Resampler.h"
+#include "engine/SampleConverter.h"
+#include "engine/TrimDetector.h"
+#include <atomic>
+
+namespace vcp {
+
+/** Sits between a ThreadedWriter and the file writer so captured audio can
+    be processed on the writer thread before it is encoded. Audio is
+    converted to the destination writer's sample rate when it differs from
+    the capture rate. */
+class CaptureWriter : public AudioFormatWriter
+{
+public:
+    CaptureWriter (AudioFormatWriter* destination, double captureRate);
+    ~CaptureWriter();
+
+    /** Returns true if audio is being resampled before writing */
+    bool isResampling() const { return resampler != nullptr; }
+
+    /** Feeds the written audio to a trim detector */
+    void setTrimDetector (std::shared_ptr<TrimDetector> detector) { trim = std::move (detector); }
+
+    /** Sets the dither used when the destination stores integers. Call
+        before writing any audio */
+    void setDither (int dither);
+
+    /** Adds the number of frames written to a counter, e.g. to see how far
+        the writer thread is behind */
+    void setWrittenCounter (std::shared_ptr<std::atomic<int64>> counter) { written = std::move (counter); }
+
+    /** @internal */
+    bool write (const int** samplesToWrite, int numSamples) override;
+    /** @internal */
+    bool flush() override;
+
+private:
+    std::unique_ptr<AudioFormatWriter> writer;
+    std::unique_ptr<Resampler> resampler;
+    AudioSampleBuffer buffer;
+    std::shared_ptr<TrimDetector> trim;
+    std::shared_ptr<std::atomic<int64>> written;
+    std::unique_ptr<SampleConverter> converter;
+    HeapBlock<int> converted;
+    HeapBlock<int*> channels;
+    int convertedSize = 0;
+
+    bool writeToDestination (const float* const* data, int numFrames);
+};
+
+}
@@ -0,0 +1,140 @@
+#include "engine/ContainerPreview.h"
+
+namespace vcp {
+
+void ContainerPreview::prepare (double newSampleRate)
+{
+    SpinLock::ScopedLockType sl (lock);
+    sampleRate  = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    releaseStep = static_cast<float> (1.0 / (0.05 * sampleRate));    // 50 ms fade
+    for (auto& voice : voices)
+        voice.active = false;
+}
+
+Result ContainerPreview::setContainer (const File& file)
+{
+    ContainerReaderPtr newReader = new ContainerReader();
+    const auto result = newReader->open (file);
+    if (result.failed())
+        return result;
+
+    {
+        SpinLock::ScopedLockType sl (lock);
+        for (auto& voice : voices)
+            voice.active = false;
+        reader.swapWith (newReader);
+    }
+
+    // the old container is unmapped here, outside the lock
+    newReader = nullptr;
+    return Result::ok();
+}
+
+void ContainerPreview::clearContainer()
+{
+    ContainerReaderPtr oldReader;
+    {
+        SpinLock::ScopedLockType sl (lock);
+        for (auto& voice : voices)
+            voice.active = false;
+        reader.swapWith (oldReader);
+    }
+}
+
+bool ContainerPreview::hasContainer() const
+{
+    SpinLock::ScopedLockType sl (lock);
+    return reader != nullptr;
+}
+
+void ContainerPreview::noteOn (int note, int velocity)
+{
+    SpinLock::ScopedLockType sl (lock);
+    if (reader == nullptr)
+        return;
+
+    const uint32* indexes = nullptr;
+    const int numRegions = reader->getRegionsFor (note, velocity, indexes);
+    for (int i = 0; i < numRegions; ++i)
+    {
+        const auto* const region = reader->getRegion ((int) indexes[i]);
+        Voice* free = nullptr;
+        for (auto& voice : voices)
+            if (! voice.active) { free = &voice; break; }
+        if (free == nullptr || region == nullptr)
+            break;
+
+        free->active    = true;
+        free->releasing = false;
+        free->note      = note;
+        free->region    = (int) indexes[i];
+        free->position  = 0.0;
+        free->increment = region->sampleRate / sampleRate;
+        free->gain      = static_cast<float> (velocity) / 127.f;
+        free->release   = 1.f;
+    }
+}
+
+void ContainerPreview::noteOff (int note)
+{
+    SpinLock::ScopedLockType sl (lock);
+    for (auto& voice : voices)
+        if (voice.active && voice.note == note)
+            voice.releasing = true;
+}
+
+void ContainerPreview::allNotesOff()
+{
+    SpinLock::ScopedLockType sl (lock);
+    for (auto& voice : voices)
+        voice.releasing = true;
+}
+
+void ContainerPreview::render (AudioSampleBuffer& buffer, int startSample, int numSamples)
+{
+    SpinLock::ScopedTryLockType sl (lock);
+    if (! sl.isLocked() || reader == nullptr)
+        return;
+
+    const int numOutputs = buffer.getNumChannels();
+    for (auto& voice : voices)
+    {
+        if (! voice.active)
+            continue;
+
+        const auto& region = *reader->getRegion (voice.region);
+        const int numChannels = (int) region.numChannels;
+        const int64 length = (int64) region.numFrames;
+        const bool looping = region.loopEnd > region.loopStart && ! voice.releasing;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (looping && voice.position >= (double) region.loopEnd)
+                voice.position -= (double) (region.loopEnd - region.loopStart);
+
+            const auto frame = static_cast<int64> (voice.position);
+            if (frame + 1 >= length || voice.release <= 0.f)
+            {
+                voice.active = false;
+                break;
+            }
+
+            // linear interpolation is enough for auditioning
+            const auto alpha = static_cast<float> (voice.position - (double) frame);
+            const float gain = voice.gain * voice.release;
+            for (int c = 0; c < numOutputs; ++c)
+            {
+                const int channel = jmin (c, numChannels - 1);
+                const float a = reader->getSample (region, channel, frame);
+                const float b = reader->getSample (region, channel, frame + 1);
+                buffer.addSample (c, startSample + i, gain * (a + alpha * (b - a)));
+            }
+
+            voice.position += voice.increment;
+            if (voice.releasing)
+                voice.release -= releaseStep;
+        }
+    }
+}
+
+}
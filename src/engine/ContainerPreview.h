@@ -0,0 +1,52 @@
+#pragma once
+
+#include "exporters/InstrumentContainer.h"
+
+namespace vcp {
+
+/** Plays notes straight from a memory mapped instrument container, so an
+    export can be auditioned without loading its samples. Notes are
+    triggered on the message thread and rendered on the audio thread */
+class ContainerPreview
+{
+public:
+    ContainerPreview() = default;
+    ~ContainerPreview() = default;
+
+    void prepare (double sampleRate);
+
+    /** Opens a container for previewing */
+    Result setContainer (const File& file);
+    void clearContainer();
+    bool hasContainer() const;
+
+    void noteOn (int note, int velocity);
+    void noteOff (int note);
+    void allNotesOff();
+
+    /** Adds playing notes to the buffer */
+    void render (AudioSampleBuffer& buffer, int startSample, int numSamples);
+
+private:
+    enum { maxVoices = 32 };
+
+    struct Voice
+    {
+        bool active         = false;
+        bool releasing      = false;
+        int note            = -1;
+        int region          = -1;
+        double position     = 0.0;
+        double increment    = 1.0;
+        float gain          = 1.f;
+        float release       = 1.f;
+    };
+
+    SpinLock lock;
+    ContainerReaderPtr reader;
+    Voice voices [maxVoices];
+    double sampleRate = 44100.0;
+    float releaseStep = 0.001f;
+};
+
+}
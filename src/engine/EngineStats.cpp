@@ -0,0 +1,260 @@
+#include "engine/EngineStats.h"
+
+namespace vcp {
+
+template<typename T, size_t N>
+static void clearCounters (std::atomic<T> (&counters)[N])
+{
+    for (auto& counter : counters)
+        counter.store (0, std::memory_order_relaxed);
+}
+
+template<typename T>
+static void storeMax (std::atomic<T>& value, T newValue)
+{
+    T current = value.load (std::memory_order_relaxed);
+    while (newValue > current && ! value.compare_exchange_weak (current, newValue, std::memory_order_relaxed)) {}
+}
+
+//=============================================================================
+EngineStats::EngineStats()
+    : ticksToMicros (1000000.0 / static_cast<double> (Time::getHighResolutionTicksPerSecond()))
+{
+    reset();
+}
+
+void EngineStats::Counters::add (int64 ticks, double toMicros)
+{
+    bins[getTimeBin (static_cast<double> (ticks) * toMicros)].fetch_add (1, std::memory_order_relaxed);
+    sumTicks.fetch_add (ticks, std::memory_order_relaxed);
+    storeMax (maxTicks, ticks);
+}
+
+int EngineStats::getTimeBin (double microseconds)
+{
+    if (microseconds <= 1.0)
+        return 0;
+    return jlimit (0, numTimeBins - 1, static_cast<int> (std::ceil (4.0 * std::log2 (microseconds))));
+}
+
+double EngineStats::getTimeBinEdge (int bin)
+{
+    return 0.001 * std::pow (2.0, static_cast<double> (bin) / 4.0);
+}
+
+String EngineStats::getStageName (int stage)
+{
+    switch (stage)
+    {
+        case midi:      return "MIDI";
+        case plugin:    return "Plugin";
+        case routing:   return "Routing";
+        case writer:    return "Writer";
+        case sampler:   return "Sampler";
+        case metering:  return "Metering";
+    }
+
+    return "Total";
+}
+
+//=============================================================================
+EngineStats::Cycle::Cycle (EngineStats& s, int frames, double rate)
+    : stats (s), numFrames (frames), sampleRate (rate),
+      start (Time::getHighResolutionTicks()), last (start)
+{
+    zeromem (stageTicks, sizeof (stageTicks));
+}
+
+void EngineStats::Cycle::lap (Stage stage)
+{
+    const auto now = Time::getHighResolutionTicks();
+    stageTicks[stage] += now - last;
+    last = now;
+}
+
+void EngineStats::Cycle::setWriterFill (float fill, bool overflowed)
+{
+    writerFill = fill;
+    writerOverflow = overflowed;
+}
+
+EngineStats::Cycle::~Cycle()
+{
+    if (numFrames <= 0 || sampleRate <= 0.0)
+        return;
+
+    const auto end = Time::getHighResolutionTicks();
+    const double toMicros = stats.ticksToMicros;
+    for (int i = 0; i < numStages; ++i)
+        stats.stages[i].add (stageTicks[i], toMicros);
+    stats.total.add (end - start, toMicros);
+
+    // the callback is late when the previous one started much more than a
+    // block ago, it ran over when it needed more time than a block lasts
+    const double deadline = 1000000.0 * numFrames / sampleRate;
+    const double elapsed  = static_cast<double> (end - start) * toMicros;
+    if (stats.lastCycleStart > 0
+        && static_cast<double> (start - stats.lastCycleStart) * toMicros > 2.0 * deadline)
+        stats.numXruns.fetch_add (1, std::memory_order_relaxed);
+    if (elapsed > deadline)
+        stats.numOverruns.fetch_add (1, std::memory_order_relaxed);
+    stats.lastCycleStart = start;
+
+    const int loadPercent = roundToInt (100.0 * elapsed / deadline);
+    stats.loadBins[jlimit (0, (int) numLoadBins - 1, loadPercent / 5)].fetch_add (1, std::memory_order_relaxed);
+    storeMax (stats.maxLoadPercent, loadPercent);
+
+    if (writerFill >= 0.f)
+        stats.fillBins[jlimit (0, (int) numFillBins - 1, roundToInt (writerFill * 10.f))].fetch_add (1, std::memory_order_relaxed);
+    if (writerOverflow)
+        stats.numWriterOverflows.fetch_add (1, std::memory_order_relaxed);
+
+    stats.lastBlockSize.store (numFrames, std::memory_order_relaxed);
+    stats.lastSampleRate.store (roundToInt (sampleRate), std::memory_order_relaxed);
+    stats.numCycles.fetch_add (1, std::memory_order_relaxed);
+}
+
+//=============================================================================
+int EngineStats::Histogram::getPercentileBin (double fraction) const
+{
+    if (total <= 0)
+        return 0;
+    const auto target = static_cast<int64> (std::ceil (jlimit (0.0, 1.0, fraction) * static_cast<double> (total)));
+    int64 sum = 0;
+    for (int i = 0; i < counts.size(); ++i)
+    {
+        sum += counts.getUnchecked (i);
+        if (sum >= jmax ((int64) 1, target))
+            return i;
+    }
+    return counts.size() - 1;
+}
+
+double EngineStats::StageInfo::getPercentile (double fraction) const
+{
+    return histogram.total > 0 ? getTimeBinEdge (histogram.getPercentileBin (fraction)) : 0.0;
+}
+
+template<size_t N>
+static void copyHistogram (const std::atomic<int64> (&bins)[N], EngineStats::Histogram& histogram)
+{
+    histogram.counts.clearQuick();
+    histogram.total = 0;
+    for (const auto& bin : bins)
+    {
+        const auto count = bin.load (std::memory_order_relaxed);
+        histogram.counts.add (count);
+        histogram.total += count;
+    }
+}
+
+EngineStats::Snapshot EngineStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.sampleRate         = static_cast<double> (lastSampleRate.load());
+    snapshot.blockSize          = lastBlockSize.load();
+    snapshot.numCycles          = numCycles.load();
+    snapshot.numXruns           = numXruns.load();
+    snapshot.numOverruns        = numOverruns.load();
+    snapshot.numWriterOverflows = numWriterOverflows.load();
+    snapshot.maxLoad            = 0.01 * maxLoadPercent.load();
+
+    auto copyStage = [this] (const Counters& counters, StageInfo& info)
+    {
+        copyHistogram (counters.bins, info.histogram);
+        const double toMillis = 0.001 * ticksToMicros;
+        if (info.histogram.total > 0)
+            info.meanMs = toMillis * static_cast<double> (counters.sumTicks.load()) / static_cast<double> (info.histogram.total);
+        info.maxMs = toMillis * static_cast<double> (counters.maxTicks.load());
+    };
+
+    for (int i = 0; i < numStages; ++i)
+        copyStage (stages[i], snapshot.stages[i]);
+    copyStage (total, snapshot.total);
+    copyHistogram (loadBins, snapshot.load);
+    copyHistogram (fillBins, snapshot.writerFill);
+    return snapshot;
+}
+
+void EngineStats::reset()
+{
+    auto clearStage = [] (Counters& counters)
+    {
+        clearCounters (counters.bins);
+        counters.sumTicks.store (0);
+        counters.maxTicks.store (0);
+    };
+
+    for (auto& counters : stages)
+        clearStage (counters);
+    clearStage (total);
+    clearCounters (loadBins);
+    clearCounters (fillBins);
+    numCycles.store (0);
+    numXruns.store (0);
+    numOverruns.store (0);
+    numWriterOverflows.store (0);
+    maxLoadPercent.store (0);
+}
+
+//=============================================================================
+static var histogramToVar (const EngineStats::Histogram& histogram)
+{
+    Array<var> counts;
+    for (const auto count : histogram.counts)
+        counts.add (count);
+    return counts;
+}
+
+static var stageToVar (const EngineStats::StageInfo& info)
+{
+    DynamicObject::Ptr obj = new DynamicObject();
+    obj->setProperty ("mean_ms", info.meanMs);
+    obj->setProperty ("p50_ms",  info.getPercentile (0.5));
+    obj->setProperty ("p99_ms",  info.getPercentile (0.99));
+    obj->setProperty ("max_ms",  info.maxMs);
+    obj->setProperty ("histogram", histogramToVar (info.histogram));
+    return obj.get();
+}
+
+var EngineStats::Snapshot::toVar() const
+{
+    DynamicObject::Ptr obj = new DynamicObject();
+    obj->setProperty ("sample_rate",        sampleRate);
+    obj->setProperty ("block_size",         blockSize);
+    obj->setProperty ("deadline_ms",        getDeadline());
+    obj->setProperty ("cycles",             numCycles);
+    obj->setProperty ("xruns",              numXruns);
+    obj->setProperty ("overruns",           numOverruns);
+    obj->setProperty ("writer_overflows",   numWriterOverflows);
+    obj->setProperty ("max_load",           maxLoad);
+
+    Array<var> edges;
+    for (int i = 0; i < numTimeBins; ++i)
+        edges.add (getTimeBinEdge (i));
+    obj->setProperty ("time_bin_edges_ms", edges);
+
+    DynamicObject::Ptr stageObj = new DynamicObject();
+    for (int i = 0; i < numStages; ++i)
+        stageObj->setProperty (getStageName (i).toLowerCase(), stageToVar (stages[i]));
+    stageObj->setProperty ("total", stageToVar (total));
+    obj->setProperty ("stages", stageObj.get());
+
+    obj->setProperty ("load_histogram", histogramToVar (load));
+    obj->setProperty ("writer_fill_histogram", histogramToVar (writerFill));
+    return obj.get();
+}
+
+String EngineStats::Snapshot::toJSON() const
+{
+    return JSON::toString (toVar());
+}
+
+Result EngineStats::writeToFile (const File& file) const
+{
+    if (! file.replaceWithText (getSnapshot().toJSON()))
+        return Result::fail (String ("could not write ") + file.getFileName());
+    return Result::ok();
+}
+
+}
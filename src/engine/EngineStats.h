@@ -0,0 +1,147 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <atomic>
+
+namespace vcp {
+
+/** Timing of the audio callback. The audio thread only touches atomic
+    counters, histograms are read on the message thread with getSnapshot() */
+class EngineStats
+{
+public:
+    enum Stage
+    {
+        midi = 0,
+        plugin,
+        routing,
+        writer,
+        sampler,
+        metering,
+        numStages
+    };
+
+    enum
+    {
+        numTimeBins = 96,   // quarter octaves from 1 us
+        numLoadBins = 42,   // 5% steps of the block deadline, the last collects anything above 200%
+        numFillBins = 11    // 10% steps of the writer FIFO
+    };
+
+    EngineStats();
+    ~EngineStats() = default;
+
+    /** Times one audio callback. Create it on the audio thread when the
+        callback starts, the laps are added to the stats when it goes out
+        of scope */
+    class Cycle
+    {
+    public:
+        Cycle (EngineStats& stats, int numFrames, double sampleRate);
+        ~Cycle();
+
+        /** Adds the time since the previous lap to a stage */
+        void lap (Stage stage);
+
+        /** Sets the fill level (0 - 1) of the fullest writer FIFO, and if
+            any write didn't fit */
+        void setWriterFill (float fill, bool overflowed);
+
+    private:
+        EngineStats& stats;
+        const int numFrames;
+        const double sampleRate;
+        const int64 start;
+        int64 last;
+        int64 stageTicks [numStages];
+        float writerFill = -1.f;
+        bool writerOverflow = false;
+        JUCE_DECLARE_NON_COPYABLE (Cycle)
+    };
+
+    struct Histogram
+    {
+        Array<int64> counts;
+        int64 total = 0;
+
+        /** Returns the bin holding the given fraction (0 - 1) of all counts */
+        int getPercentileBin (double fraction) const;
+    };
+
+    struct StageInfo
+    {
+        Histogram histogram;
+        double meanMs = 0.0;
+        double maxMs  = 0.0;
+
+        /** Returns the upper edge in milliseconds of the percentile's bin */
+        double getPercentile (double fraction) const;
+    };
+
+    struct Snapshot
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        int64 numCycles = 0;
+        int64 numXruns = 0;
+        int64 numOverruns = 0;
+        int64 numWriterOverflows = 0;
+        double maxLoad = 0.0;
+
+        StageInfo stages [numStages];
+        StageInfo total;
+        Histogram load;
+        Histogram writerFill;
+
+        /** Returns the time available for one block in milliseconds */
+        double getDeadline() const { return sampleRate > 0.0 ? 1000.0 * blockSize / sampleRate : 0.0; }
+
+        var toVar() const;
+        String toJSON() const;
+    };
+
+    /** Returns a copy of the counters, call on any thread but the audio thread */
+    Snapshot getSnapshot() const;
+
+    /** Clears the counters. The audio thread may still add to them while
+        this runs */
+    void reset();
+
+    /** Writes the current snapshot as JSON */
+    Result writeToFile (const File& file) const;
+
+    static String getStageName (int stage);
+
+    /** Returns the upper edge of a time bin in milliseconds */
+    static double getTimeBinEdge (int bin);
+    static int getTimeBin (double microseconds);
+
+private:
+    struct Counters
+    {
+        std::atomic<int64> bins [numTimeBins];
+        std::atomic<int64> sumTicks { 0 };
+        std::atomic<int64> maxTicks { 0 };
+        void add (int64 ticks, double ticksToMicros);
+    };
+
+    Counters stages [numStages];
+    Counters total;
+    std::atomic<int64> loadBins [numLoadBins];
+    std::atomic<int64> fillBins [numFillBins];
+    std::atomic<int64> numCycles { 0 };
+    std::atomic<int64> numXruns { 0 };
+    std::atomic<int64> numOverruns { 0 };
+    std::atomic<int64> numWriterOverflows { 0 };
+    std::atomic<int> maxLoadPercent { 0 };
+    std::atomic<int> lastBlockSize { 0 };
+    std::atomic<int> lastSampleRate { 0 };
+
+    // only used on the audio thread
+    int64 lastCycleStart = 0;
+    const double ticksToMicros;
+
+    JUCE_DECLARE_NON_COPYABLE (EngineStats)
+};
+
+}
@@ -0,0 +1,229 @@
+
+#include "analysis/FFT.h"
+#include "engine/LatencyProbe.h"
+
+namespace vcp {
+
+LatencyProbe::LatencyProbe() { }
+
+LatencyProbe::~LatencyProbe()
+{
+    cancelPendingUpdate();
+}
+
+void LatencyProbe::prepare (double newSampleRate, int newBlockSize)
+{
+    cancel();
+    sampleRate = newSampleRate;
+    blockSize  = newBlockSize;
+}
+
+void LatencyProbe::release()
+{
+    cancel();
+    sampleRate = 0.0;
+    blockSize  = 0;
+}
+
+Result LatencyProbe::start (const Options& newOptions)
+{
+    if (isRunning())
+        return Result::fail ("latency measurement already in progress");
+    if (sampleRate <= 0.0)
+        return Result::fail ("audio device is not running");
+
+    options = newOptions;
+    options.numInputs = jmax (1, options.numInputs);
+    
+    const int preRoll       = roundToInt (0.1 * sampleRate);
+    const int maxLatency    = roundToInt (sampleRate);
+    int length = preRoll + maxLatency;
+    
+    sequence.clearQuick();
+    if (options.mode == AudioLoopback)
+    {
+        createMaximumLengthSequence (12, sequence);
+        length += sequence.size();
+    }
+
+    capture.setSize (1, length, false, true, false);
+    capture.clear();
+    frame           = 0;
+    triggerFrame    = preRoll;
+    noteOffFrame    = preRoll + roundToInt (0.25 * sampleRate);
+    state.set (Running);
+    return Result::ok();
+}
+
+void LatencyProbe::cancel()
+{
+    state.set (Idle);
+    cancelPendingUpdate();
+}
+
+void LatencyProbe::process (const float** input, int numInputs,
+                            float** output, int numOutputs,
+                            MidiBuffer& midi, int nframes)
+{
+    if (state.get() != Running)
+        return;
+
+    const int total = capture.getNumSamples();
+    const int todo  = jmin (nframes, total - frame);
+    auto* const dest = capture.getWritePointer (0, frame);
+    FloatVectorOperations::clear (dest, todo);
+    for (int c = options.inputChannel; c < options.inputChannel + options.numInputs; ++c)
+        if (isPositiveAndBelow (c, numInputs))
+            FloatVectorOperations::add (dest, input[c], todo);
+
+    if (options.mode == MidiNote)
+    {
+        if (triggerFrame >= frame && triggerFrame < frame + todo)
+            midi.addEvent (MidiMessage::noteOn (options.midiChannel, options.note, (uint8) options.velocity),
+                           triggerFrame - frame);
+        if (noteOffFrame >= frame && noteOffFrame < frame + todo)
+            midi.addEvent (MidiMessage::noteOff (options.midiChannel, options.note),
+                           noteOffFrame - frame);
+    }
+    else if (isPositiveAndBelow (options.outputChannel, numOutputs))
+    {
+        const int begin = jmax (frame, triggerFrame);
+        const int end   = jmin (frame + todo, triggerFrame + sequence.size());
+        auto* const out = output [options.outputChannel];
+        for (int i = begin; i < end; ++i)
+            out [i - frame] += 0.25f * sequence.getUnchecked (i - triggerFrame);
+    }
+
+    frame += todo;
+    if (frame >= total)
+    {
+        state.set (Finished);
+        triggerAsyncUpdate();
+    }
+}
+
+void LatencyProbe::handleAsyncUpdate()
+{
+    if (state.get() != Finished)
+        return;
+
+    const auto* const data = capture.getReadPointer (0);
+    const int total = capture.getNumSamples();
+
+    if (options.mode == MidiNote)
+    {
+        float noise = 0.f;
+        for (int i = 0; i < triggerFrame; ++i)
+            noise = jmax (noise, std::abs (data[i]));
+        
+        // wait for the note to be 12dB over the pre-roll noise
+        const float threshold = jmax (noise * 4.f, Decibels::decibelsToGain (-60.f));
+        const int onset = findOnset (data, total, threshold, triggerFrame);
+        if (onset < 0)
+            return finish (Result::fail ("No signal was detected on the input"), 0);
+        return finish (Result::ok(), onset - triggerFrame);
+    }
+
+    const int offset = findOffset (data, total, sequence.getRawDataPointer(), sequence.size(),
+                                   triggerFrame, total - sequence.size());
+    if (offset < 0)
+        return finish (Result::fail ("The test signal was not detected on the input"), 0);
+    finish (Result::ok(), offset - triggerFrame);
+}
+
+void LatencyProbe::finish (const Result& result, int latency)
+{
+    DBG("[VCP] measured latency: " << latency << " " << result.getErrorMessage());
+    state.set (Idle);
+    if (onFinished)
+        onFinished (result, latency);
+}
+
+//=============================================================================
+void LatencyProbe::createMaximumLengthSequence (int order, Array<float>& sequence)
+{
+    // galois feedback masks for maximal length registers
+    static const uint32 masks[] = {
+        0x0, 0x0, 0x3, 0x6, 0xC, 0x14, 0x30, 0x60, 0xB8, 0x110, 0x240,
+        0x500, 0xE08, 0x1C80, 0x3802, 0x6000, 0xD008
+    };
+
+    order = jlimit (2, 16, order);
+    const int length = (1 << order) - 1;
+    const uint32 mask = masks [order];
+    uint32 reg = 1;
+
+    sequence.clearQuick();
+    sequence.ensureStorageAllocated (length);
+    for (int i = 0; i < length; ++i)
+    {
+        const bool bit = (reg & 1u) != 0;
+        sequence.add (bit ? 1.f : -1.f);
+        reg >>= 1;
+        if (bit)
+            reg ^= mask;
+    }
+}
+
+int LatencyProbe::findOffset (const float* signal, int signalLength,
+                              const float* reference, int referenceLength,
+                              int firstOffset, int lastOffset)
+{
+    if (lastOffset < 0 || lastOffset > signalLength - referenceLength)
+        lastOffset = signalLength - referenceLength;
+    firstOffset = jmax (0, firstOffset);
+    if (referenceLength <= 0 || lastOffset < firstOffset)
+        return -1;
+
+    double referenceEnergy = 0.0;
+    for (int i = 0; i < referenceLength; ++i)
+        referenceEnergy += reference[i] * reference[i];
+
+    // cross-correlation through the spectrum, padded so it doesn't wrap
+    using Complex = FFT::Complex;
+    FFT fft (FFT::getOrderFor (signalLength + referenceLength));
+    const int size = fft.getSize();
+    HeapBlock<Complex> spectrum ((size_t) size, true), referenceSpectrum ((size_t) size, true);
+    for (int i = 0; i < signalLength; ++i)
+        spectrum[i] = Complex (signal[i], 0.f);
+    for (int i = 0; i < referenceLength; ++i)
+        referenceSpectrum[i] = Complex (reference[i], 0.f);
+    fft.perform (spectrum, false);
+    fft.perform (referenceSpectrum, false);
+    for (int i = 0; i < size; ++i)
+        spectrum[i] *= std::conj (referenceSpectrum[i]);
+    fft.perform (spectrum, true);
+
+    int best = -1;
+    double bestValue = 0.0;
+    for (int offset = firstOffset; offset <= lastOffset; ++offset)
+    {
+        const double sum = spectrum[offset].real();
+        if (sum > bestValue)
+        {
+            bestValue = sum;
+            best = offset;
+        }
+    }
+
+    if (best < 0)
+        return -1;
+
+    double signalEnergy = 0.0;
+    for (int i = 0; i < referenceLength; ++i)
+        signalEnergy += signal[best + i] * signal[best + i];
+
+    // normalized correlation, a clean loopback is close to 1.0
+    const double score = bestValue / std::sqrt (jmax (1.0e-12, referenceEnergy * signalEnergy));
+    return score >= 0.3 ? best : -1;
+}
+
+int LatencyProbe::findOnset (const float* signal, int signalLength, float threshold, int start)
+{
+    for (int i = jmax (0, start); i < signalLength; ++i)
+        if (std::abs (signal[i]) > threshold)
+            return i;
+    return -1;
+}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Measures the round trip latency of a hardware capture path.
+
+    In MidiNote mode a test note is sent and the offset is taken from the
+    first input sample that rises above the measured noise floor. In
+    AudioLoopback mode a maximum length sequence is played on an output and
+    the offset is found by cross-correlating it with the captured input.
+ */
+class LatencyProbe : private AsyncUpdater
+{
+public:
+    enum Mode
+    {
+        MidiNote = 0,
+        AudioLoopback
+    };
+
+    struct Options
+    {
+        int mode            = MidiNote;
+        int midiChannel     = 1;
+        int note            = 60;
+        int velocity        = 127;
+        int inputChannel    = 0;
+        int numInputs       = 1;
+        int outputChannel   = 0;
+    };
+
+    LatencyProbe();
+    ~LatencyProbe();
+
+    //=========================================================================
+    void prepare (double newSampleRate, int newBlockSize);
+    void release();
+
+    //=========================================================================
+    /** Starts a measurement. Call from the message thread */
+    Result start (const Options& newOptions);
+    void cancel();
+    bool isRunning() const { return state.get() != Idle; }
+
+    //=========================================================================
+    /** Called in the audio thread. Test messages are added to midi and the
+        test signal is added to the output */
+    void process (const float** input, int numInputs,
+                  float** output, int numOutputs,
+                  MidiBuffer& midi, int nframes);
+
+    //=========================================================================
+    /** Called on the message thread with the result and latency in samples */
+    std::function<void(const Result&, int)> onFinished;
+
+    //=========================================================================
+    /** Fills the sequence with a +/-1 maximum length sequence of the given order */
+    static void createMaximumLengthSequence (int order, Array<float>& sequence);
+
+    /** Returns the offset into signal where reference correlates best, or -1
+        if no convincing match was found */
+    static int findOffset (const float* signal, int signalLength,
+                           const float* reference, int referenceLength,
+                           int firstOffset = 0, int lastOffset = -1);
+
+    /** Returns the index of the first sample louder than threshold, or -1 */
+    static int findOnset (const float* signal, int signalLength, float threshold, int start = 0);
+
+private:
+    enum State
+    {
+        Idle = 0,
+        Running,
+        Finished
+    };
+
+    Atomic<int> state { Idle };
+    Options options;
+    double sampleRate = 0.0;
+    int blockSize = 0;
+
+    Array<float> sequence;
+    AudioSampleBuffer capture;
+    int frame = 0;
+    int triggerFrame = 0;
+    int noteOffFrame = 0;
+
+    void handleAsyncUpdate() override;
+    void finish (const Result&, int);
+};
+
+}
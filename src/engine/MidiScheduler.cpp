@@ -0,0 +1,246 @@
+#include "engine/MidiScheduler.h"
+
+namespace vcp {
+
+//=============================================================================
+void MidiScheduler::Clock::reset (double newSampleRate, double bandwidthHz)
+{
+    jassert (newSampleRate > 0.0);
+    sampleRate      = newSampleRate;
+    bandwidth       = bandwidthHz;
+    nominalPeriod   = 1000.0 / sampleRate;
+    period          = nominalPeriod;
+    time            = 0.0;
+    position        = 0;
+    numUpdates      = 0;
+}
+
+void MidiScheduler::Clock::update (int64 frame, double millis)
+{
+    const int64 elapsed = frame - position;
+    const double predicted = time + static_cast<double> (elapsed) * period;
+    const double error = millis - predicted;
+
+    // the first block, or a gap after an xrun or a paused device, restarts the loop
+    if (numUpdates == 0 || elapsed <= 0 || std::abs (error) > 50.0)
+    {
+        time = millis;
+        position = frame;
+        numUpdates = 1;
+        return;
+    }
+
+    // second order DLL, the bandwidth is wider while locking on
+    const double hz = numUpdates < 64 ? bandwidth * 4.0 : bandwidth;
+    const double omega = MathConstants<double>::twoPi * hz * static_cast<double> (elapsed) / sampleRate;
+    time = predicted + MathConstants<double>::sqrt2 * omega * error;
+    period += omega * omega * error / static_cast<double> (elapsed);
+    position = frame;
+    ++numUpdates;
+}
+
+double MidiScheduler::Clock::getTime (int64 frame) const
+{
+    return time + static_cast<double> (frame - position) * period;
+}
+
+double MidiScheduler::Clock::getRatio() const
+{
+    return period > 0.0 ? nominalPeriod / period : 1.0;
+}
+
+//=============================================================================
+String MidiScheduler::Stats::toString() const
+{
+    String text;
+    text << "sent " << numSent << ", jitter mean " << String (meanJitter, 3)
+         << " ms, sd " << String (stdDevJitter, 3) << " ms, max " << String (maxJitter, 3)
+         << " ms, late " << numLate << ", dropped " << numDropped
+         << ", audio clock " << String ((clockRatio - 1.0) * 1e6, 1) << " ppm";
+    return text;
+}
+
+//=============================================================================
+MidiScheduler::MidiScheduler()
+    : Thread ("MIDI Scheduler")
+{
+    queue.calloc ((size_t) queueSize);
+    pending.ensureStorageAllocated (queueSize);
+    clock.reset (44100.0);
+    startThread (10);
+}
+
+MidiScheduler::~MidiScheduler()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (500);
+}
+
+void MidiScheduler::prepare (double sampleRate, int blockSize)
+{
+    clock.reset (sampleRate);
+    framePosition = blockStart = 0;
+
+    // one block ahead so events at the start of a late callback are still on time
+    leadMillis = 1.0 + 1000.0 * blockSize / sampleRate;
+}
+
+void MidiScheduler::beginBlock (int numFrames)
+{
+    clock.update (framePosition, Time::getMillisecondCounterHiRes());
+    clockRatio.store (clock.getRatio(), std::memory_order_relaxed);
+    blockStart = framePosition;
+    framePosition += numFrames;
+}
+
+void MidiScheduler::addEvents (MidiOutput* output, const MidiBuffer& buffer)
+{
+    if (output == nullptr || buffer.isEmpty())
+        return;
+
+    MidiBuffer::Iterator iter (buffer);
+    const uint8* data; int size, frame;
+    bool queued = false;
+    while (iter.getNextEvent (data, size, frame))
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+        if (size > (int) maxMessageSize || size1 + size2 <= 0)
+        {
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+            continue;
+        }
+
+        auto& event = queue [size1 > 0 ? start1 : start2];
+        event.output = output;
+        event.time   = clock.getTime (blockStart + frame) + leadMillis;
+        event.size   = size;
+        memcpy (event.data, data, (size_t) size);
+        fifo.finishedWrite (1);
+        queued = true;
+    }
+
+    // only signal when the dispatcher sleeps, it reads the FIFO before waiting
+    if (queued && waiting.load())
+        notify();
+}
+
+void MidiScheduler::removeOutput (MidiOutput* output)
+{
+    ScopedLock sl (dispatchLock);
+    readQueue();
+    for (int i = pending.size(); --i >= 0;)
+        if (pending.getReference(i).output == output)
+            pending.remove (i);
+}
+
+MidiScheduler::Stats MidiScheduler::getStats() const
+{
+    Stats stats;
+    stats.numSent    = numSent.load (std::memory_order_relaxed);
+    stats.numLate    = numLate.load (std::memory_order_relaxed);
+    stats.numDropped = numDropped.load (std::memory_order_relaxed);
+    stats.maxJitter  = 0.001 * static_cast<double> (maxMicros.load (std::memory_order_relaxed));
+    stats.clockRatio = clockRatio.load (std::memory_order_relaxed);
+
+    if (stats.numSent > 0)
+    {
+        const double count = static_cast<double> (stats.numSent);
+        const double mean = static_cast<double> (sumMicros.load (std::memory_order_relaxed)) / count;
+        const double meanSquares = static_cast<double> (sumSquaredMicros.load (std::memory_order_relaxed)) / count;
+        stats.meanJitter   = 0.001 * mean;
+        stats.stdDevJitter = 0.001 * std::sqrt (jmax (0.0, meanSquares - mean * mean));
+    }
+
+    return stats;
+}
+
+void MidiScheduler::resetStats()
+{
+    numSent.store (0);
+    numLate.store (0);
+    numDropped.store (0);
+    sumMicros.store (0);
+    sumSquaredMicros.store (0);
+    maxMicros.store (0);
+}
+
+void MidiScheduler::readQueue()
+{
+    const int numReady = fifo.getNumReady();
+    if (numReady <= 0)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    // rigs are queued one after another, so keep pending sorted by time
+    auto insert = [this] (const Event& event)
+    {
+        int index = pending.size();
+        while (index > 0 && pending.getReference (index - 1).time > event.time)
+            --index;
+        pending.insert (index, event);
+    };
+
+    for (int i = 0; i < size1; ++i)
+        insert (queue [start1 + i]);
+    for (int i = 0; i < size2; ++i)
+        insert (queue [start2 + i]);
+    fifo.finishedRead (size1 + size2);
+}
+
+void MidiScheduler::dispatch (const Event& event)
+{
+    const double now = Time::getMillisecondCounterHiRes();
+    event.output->sendMessageNow (MidiMessage (event.data, event.size));
+
+    const int64 micros = roundToInt (1000.0 * (now - event.time));
+    numSent.fetch_add (1, std::memory_order_relaxed);
+    sumMicros.fetch_add (micros, std::memory_order_relaxed);
+    sumSquaredMicros.fetch_add (micros * micros, std::memory_order_relaxed);
+    int64 highest = maxMicros.load (std::memory_order_relaxed);
+    while (micros > highest && ! maxMicros.compare_exchange_weak (highest, micros, std::memory_order_relaxed)) {}
+    if (micros > 1000)
+        numLate.fetch_add (1, std::memory_order_relaxed);
+}
+
+void MidiScheduler::run()
+{
+    while (! threadShouldExit())
+    {
+        int timeout = -1;
+
+        {
+            ScopedLock sl (dispatchLock);
+            readQueue();
+
+            // waits are no finer than a millisecond, so events due within
+            // half of one are sent now rather than late
+            int numDue = 0;
+            while (numDue < pending.size()
+                && pending.getReference (numDue).time <= Time::getMillisecondCounterHiRes() + 0.5)
+            {
+                dispatch (pending.getReference (numDue));
+                ++numDue;
+            }
+            pending.removeRange (0, numDue);
+
+            if (! pending.isEmpty())
+            {
+                const double untilNext = pending.getReference(0).time - Time::getMillisecondCounterHiRes();
+                timeout = jmax (1, static_cast<int> (untilNext) - 1);
+            }
+        }
+
+        // sleep until shortly before the next event, or for good when nothing
+        // is pending, addEvents() wakes us up for anything new
+        waiting.store (true);
+        if (fifo.getNumReady() <= 0)
+            wait (timeout);
+        waiting.store (false);
+    }
+}
+
+}
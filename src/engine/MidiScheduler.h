@@ -0,0 +1,126 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <atomic>
+
+namespace vcp {
+
+/** Sends MIDI to hardware outputs at times derived from the audio clock.
+    The audio thread stamps each event with the time its frame is heard,
+    using a delay locked loop fitted to the callback times, and queues it
+    in a lock free FIFO. A high priority thread sleeps until the next event
+    is due, or until events are queued, and keeps track of how close it got */
+class MidiScheduler : private Thread
+{
+public:
+    enum
+    {
+        queueSize = 4096,
+        maxMessageSize = 16
+    };
+
+    /** Maps audio frames to Time::getMillisecondCounterHiRes(). The loop
+        filters out callback jitter and follows drift between the audio
+        and system clocks */
+    class Clock
+    {
+    public:
+        Clock() = default;
+
+        /** Forgets the current estimate */
+        void reset (double sampleRate, double bandwidthHz = 1.0);
+
+        /** Adds the time a block starting at frame was observed */
+        void update (int64 frame, double millis);
+
+        /** Returns the estimated time of a frame */
+        double getTime (int64 frame) const;
+
+        /** Returns the estimated audio clock rate relative to the nominal
+            sample rate */
+        double getRatio() const;
+
+        bool isLocked() const { return numUpdates > 0; }
+
+    private:
+        double sampleRate = 44100.0;
+        double bandwidth = 1.0;
+        double nominalPeriod = 1000.0 / 44100.0;
+        double period = 1000.0 / 44100.0;
+        double time = 0.0;
+        int64 position = 0;
+        int64 numUpdates = 0;
+    };
+
+    struct Stats
+    {
+        int64 numSent = 0;
+        int64 numLate = 0;
+        int64 numDropped = 0;
+        double meanJitter = 0.0;    // ms, sent minus due
+        double stdDevJitter = 0.0;
+        double maxJitter = 0.0;
+        double clockRatio = 1.0;
+
+        String toString() const;
+    };
+
+    MidiScheduler();
+    ~MidiScheduler();
+
+    /** Resets the clock and sets how far ahead of the audio events are
+        sent. Call while the audio thread isn't processing */
+    void prepare (double sampleRate, int blockSize);
+
+    /** Starts a block, audio thread only. Call once per callback before
+        any events are added */
+    void beginBlock (int numFrames);
+
+    /** Queues a block of events, audio thread only. Frame positions are
+        relative to the block started last */
+    void addEvents (MidiOutput* output, const MidiBuffer& buffer);
+
+    /** Drops everything queued for an output. Call after the audio thread
+        stopped using it and before deleting it */
+    void removeOutput (MidiOutput* output);
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct Event
+    {
+        MidiOutput* output;
+        double time;
+        int size;
+        uint8 data [maxMessageSize];
+    };
+
+    HeapBlock<Event> queue;
+    AbstractFifo fifo { queueSize };
+    Array<Event> pending;
+    CriticalSection dispatchLock;
+    std::atomic<bool> waiting { false };
+
+    std::atomic<int64> numSent { 0 };
+    std::atomic<int64> numLate { 0 };
+    std::atomic<int64> numDropped { 0 };
+    std::atomic<int64> sumMicros { 0 };
+    std::atomic<int64> sumSquaredMicros { 0 };
+    std::atomic<int64> maxMicros { 0 };
+    std::atomic<double> clockRatio { 1.0 };
+
+    // audio thread only
+    Clock clock;
+    int64 framePosition = 0;
+    int64 blockStart = 0;
+    double leadMillis = 1.0;
+
+    void run() override;
+    void readQueue();
+    void dispatch (const Event&);
+
+    JUCE_DECLARE_NON_COPYABLE (MidiScheduler)
+};
+
+}
@@ -0,0 +1,154 @@
+#include "engine/OutputMeter.h"
+
+namespace vcp {
+
+OutputMeter::OutputMeter()
+{
+    ring.calloc ((size_t) ringSize);
+    zerostruct (current);
+    zeromem (sums, sizeof (sums));
+    resetPeaks();
+}
+
+void OutputMeter::prepare (double sampleRate)
+{
+    windowFrames = jmax (1, roundToInt (sampleRate / (double) windowsPerSecond));
+    windowPos = 0;
+    zerostruct (current);
+    zeromem (sums, sizeof (sums));
+}
+
+float OutputMeter::measure (const float* data, int numFrames, double& sumOfSquares, int& clips)
+{
+    const auto range = FloatVectorOperations::findMinAndMax (data, numFrames);
+    const float peak = jmax (range.getEnd(), -range.getStart());
+
+    // four lanes so the compiler can vectorize the sum
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        s0 += data[i] * data[i];
+        s1 += data[i + 1] * data[i + 1];
+        s2 += data[i + 2] * data[i + 2];
+        s3 += data[i + 3] * data[i + 3];
+    }
+    for (; i < numFrames; ++i)
+        s0 += data[i] * data[i];
+    sumOfSquares += static_cast<double> ((s0 + s1) + (s2 + s3));
+
+    if (peak >= 1.f)
+        for (int f = 0; f < numFrames; ++f)
+            if (std::abs (data[f]) >= 1.f)
+                ++clips;
+
+    return peak;
+}
+
+void OutputMeter::process (const float* const* channels, int numChans, int numFrames)
+{
+    numChans = jmin ((int) maxChannels, numChans);
+    numChannels.store (numChans, std::memory_order_relaxed);
+    current.numChannels = numChans;
+
+    // blocks are split where windows end, tiny blocks add up to one window
+    int offset = 0;
+    while (offset < numFrames)
+    {
+        const int count = jmin (numFrames - offset, windowFrames - windowPos);
+        for (int c = 0; c < numChans; ++c)
+        {
+            int clips = 0;
+            const float peak = measure (channels[c] + offset, count, sums[c], clips);
+            current.peak[c] = jmax (current.peak[c], peak);
+            if (clips > 0)
+                clipCounts[c].fetch_add (clips, std::memory_order_relaxed);
+        }
+
+        offset += count;
+        windowPos += count;
+        if (windowPos >= windowFrames)
+            finishWindow();
+    }
+}
+
+void OutputMeter::finishWindow()
+{
+    for (int c = 0; c < current.numChannels; ++c)
+    {
+        current.rms[c] = static_cast<float> (std::sqrt (sums[c] / (double) windowPos));
+        float hold = peakHold[c].load (std::memory_order_relaxed);
+        while (current.peak[c] > hold && ! peakHold[c].compare_exchange_weak (hold, current.peak[c], std::memory_order_relaxed)) {}
+    }
+
+    // when the reader falls behind the newest windows are dropped
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    if (size1 > 0)
+        ring[start1] = current;
+    else if (size2 > 0)
+        ring[start2] = current;
+    fifo.finishedWrite (size1 + size2);
+
+    const int numChans = current.numChannels;
+    zerostruct (current);
+    current.numChannels = numChans;
+    zeromem (sums, sizeof (sums));
+    windowPos = 0;
+}
+
+bool OutputMeter::read (Window& merged)
+{
+    const int numReady = fifo.getNumReady();
+    if (numReady <= 0)
+        return false;
+
+    zerostruct (merged);
+    double squares [maxChannels] = {};
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    auto merge = [&] (const Window& window)
+    {
+        merged.numChannels = jmax (merged.numChannels, window.numChannels);
+        for (int c = 0; c < window.numChannels; ++c)
+        {
+            merged.peak[c] = jmax (merged.peak[c], window.peak[c]);
+            squares[c] += static_cast<double> (window.rms[c]) * window.rms[c];
+        }
+    };
+
+    for (int i = 0; i < size1; ++i)
+        merge (ring[start1 + i]);
+    for (int i = 0; i < size2; ++i)
+        merge (ring[start2 + i]);
+    fifo.finishedRead (size1 + size2);
+
+    // windows have the same length, so the mean of squares is the RMS over all
+    const int numWindows = size1 + size2;
+    for (int c = 0; c < merged.numChannels; ++c)
+        merged.rms[c] = static_cast<float> (std::sqrt (squares[c] / (double) numWindows));
+    return numWindows > 0;
+}
+
+float OutputMeter::getPeakHold (int channel) const
+{
+    return isPositiveAndBelow (channel, (int) maxChannels)
+        ? peakHold[channel].load (std::memory_order_relaxed) : 0.f;
+}
+
+int OutputMeter::getNumClips (int channel) const
+{
+    return isPositiveAndBelow (channel, (int) maxChannels)
+        ? clipCounts[channel].load (std::memory_order_relaxed) : 0;
+}
+
+void OutputMeter::resetPeaks()
+{
+    for (auto& hold : peakHold)
+        hold.store (0.f, std::memory_order_relaxed);
+    for (auto& clips : clipCounts)
+        clips.store (0, std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "JuceHeader.h"
+#include <atomic>
+
+namespace vcp {
+
+/** Measures peak and RMS of every output channel on the audio thread. The
+    audio is measured in short windows which are queued in a lock free
+    ring, so a GUI polling at its own rate still sees every peak */
+class OutputMeter : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<OutputMeter>;
+
+    enum
+    {
+        maxChannels = 16,
+        ringSize    = 512,
+        windowsPerSecond = 200
+    };
+
+    struct Window
+    {
+        int numChannels = 0;
+        float peak [maxChannels];
+        float rms  [maxChannels];
+    };
+
+    OutputMeter();
+    ~OutputMeter() = default;
+
+    /** Sets the window length, call while the audio thread isn't processing */
+    void prepare (double sampleRate);
+
+    /** Measures a block, audio thread only */
+    void process (const float* const* channels, int numChannels, int numFrames);
+
+    /** Takes all queued windows and merges them into one, returns false if
+        nothing was queued. Call from a single reader thread */
+    bool read (Window& merged);
+
+    /** Returns the highest peak since the last reset */
+    float getPeakHold (int channel) const;
+
+    /** Returns the number of samples at or above full scale since the
+        last reset */
+    int getNumClips (int channel) const;
+
+    /** Returns the number of channels seen in the last block */
+    int getNumChannels() const { return numChannels.load (std::memory_order_relaxed); }
+
+    /** Clears peak hold and clip counters */
+    void resetPeaks();
+
+    /** Measures a channel, returns the peak and sum of squares and adds
+        samples at or above full scale to clips */
+    static float measure (const float* data, int numFrames, double& sumOfSquares, int& clips);
+
+private:
+    HeapBlock<Window> ring;
+    AbstractFifo fifo { ringSize };
+    std::atomic<float> peakHold [maxChannels];
+    std::atomic<int> clipCounts [maxChannels];
+    std::atomic<int> numChannels { 0 };
+
+    // audio thread only
+    int windowFrames = 1;
+    int windowPos = 0;
+    Window current;
+    double sums [maxChannels];
+
+    void finishWindow();
+
+    JUCE_DECLARE_NON_COPYABLE (OutputMeter)
+};
+
+}
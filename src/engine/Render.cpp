@@ -1,4 +1,5 @@
 
+#include "engine/CaptureWriter.h"
 #include "engine/Render.h"
 #include "Tags.h"
 
@@ -24,17 +25,419 @@ produce = 1114.557823129251701  = provide / ratio
 
 namespace vcp {
 
+struct SampleStartSorter
+{
+    static int compareElements (const SampleInfo* a, const SampleInfo* b)
+    {
+        return a->start < b->start ? -1 : (b->start < a->start ? 1 : 0);
+    }
+};
+
+//=============================================================================
+/** Closes writers as samples finish and, once rendering stops, moves the
+    capture directory into place. Runs on its own thread so large renders
+    don't block the message thread */
+class Render::Finalizer : public Thread,
+                          private AsyncUpdater
+{
+public:
+    Finalizer (Render& r)
+        : Thread ("vcpfinalize"),
+          render (r) { }
+
+    ~Finalizer()
+    {
+        stopThread (10 * 1000);
+        cancelPendingUpdate();
+    }
+
+    bool isBusy() const { return busy.get() != 0; }
+
+    /** Call on the message thread before rendering starts */
+    void prepare (int totalSamples, const File& journalFile)
+    {
+        jassert (! isBusy());
+        ScopedLock sl (lock);
+        journal.reset (new FileOutputStream (journalFile));
+        if (journal->failedToOpen())
+            journal.reset();
+        queue.calloc ((size_t) totalSamples + 1);
+        fifo.setTotalSize (totalSamples + 1);
+        fifo.reset();
+        manifest = ValueTree (Tags::samples);
+        numClosed.set (0);
+        numSamples = totalSamples;
+        if (! isThreadRunning())
+            startThread();
+    }
+
+    /** Called in the audio thread once the last frame of a sample was written */
+    void sampleFinished (int layer, int index)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+        if (size1 > 0)
+            queue[start1] = { layer, index };
+        else if (size2 > 0)
+            queue[start2] = { layer, index };
+        fifo.finishedWrite (size1 + size2);
+    }
+
+    /** Takes ownership of the render details and finishes up in the background */
+    void finish (OwnedArray<LayerRenderDetails>& details, const RenderContext& ctx, bool wasCancelled)
+    {
+        {
+            ScopedLock sl (lock);
+            finished.swapWith (details);
+            context = ctx;
+            cancelled = wasCancelled;
+        }
+
+        busy.set (1);
+        finishing.set (1);
+        notify();
+    }
+
+    void getProgress (double& value, String& title) const
+    {
+        ScopedLock sl (lock);
+        value = progressValue;
+        title = progressTitle;
+    }
+
+private:
+    struct Entry { int layer, index; };
+    Render& render;
+    CriticalSection lock;
+    HeapBlock<Entry> queue;
+    AbstractFifo fifo { 1 };
+    ValueTree manifest;
+    std::unique_ptr<FileOutputStream> journal;
+    Atomic<int> busy { 0 };
+    Atomic<int> finishing { 0 };
+    Atomic<int> numClosed { 0 };
+    int numSamples = 0;
+
+    OwnedArray<LayerRenderDetails> finished;
+    RenderContext context;
+    bool cancelled = false;
+
+    double progressValue = 0.0;
+    String progressTitle;
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            wait (50);
+            drain();
+            if (finishing.get() != 0)
+            {
+                finalize();
+                finishing.set (0);
+                triggerAsyncUpdate();
+            }
+        }
+    }
+
+    void drain()
+    {
+        if (fifo.getNumReady() <= 0)
+            return;
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+        for (int i = 0; i < size1; ++i)
+            close (queue [start1 + i]);
+        for (int i = 0; i < size2; ++i)
+            close (queue [start2 + i]);
+        fifo.finishedRead (size1 + size2);
+    }
+
+    void close (const Entry& entry)
+    {
+        std::unique_ptr<AudioFormatWriter::ThreadedWriter> writer;
+        std::shared_ptr<TrimDetector> trim;
+        ValueTree sample;
+        String line;
+
+        {
+            ScopedLock sl (render.getCallbackLock());
+            if (! isPositiveAndBelow (entry.layer, render.details.size()))
+                return;
+            auto* const detail = render.details.getUnchecked (entry.layer);
+            if (! isPositiveAndBelow (entry.index, detail->getNumSamples()))
+                return;
+            auto* const info = detail->getSample (entry.index);
+            if (info->writer == nullptr)
+                return;
+            writer.swap (info->writer);
+            trim = info->trim;
+            sample = createEntry (*info, render.context);
+            line = createJournalLine (*info, render.context);
+        }
+
+        // flushes the remaining audio and closes the file. The render can be
+        // released meanwhile, so only use what was taken from the sample info
+        writer.reset();
+        applyTrim (sample, trim.get());
+        ScopedLock sl (lock);
+        manifest.appendChild (sample, nullptr);
+        numClosed.set (numClosed.get() + 1);
+
+        // only journal files which are complete on disk, so an interrupted
+        // render can pick up from here
+        if (journal != nullptr)
+        {
+            journal->writeText (line, false, false, nullptr);
+            journal->flush();
+        }
+    }
+
+    String createJournalLine (const SampleInfo& info, const RenderContext& ctx) const
+    {
+        const double fileSampleRate = ctx.sampleRate > 0.0 ? ctx.sampleRate : render.sampleRate;
+        const auto frames = static_cast<int64> (std::round (
+            static_cast<double> (info.stop - info.start) * fileSampleRate / render.sampleRate));
+        String line = info.key;
+        line << "\t" << info.file.getFileName() << "\t" << String (frames) << "\n";
+        return line;
+    }
+
+    ValueTree createEntry (const SampleInfo& info, const RenderContext& ctx) const
+    {
+        const double fileSampleRate = ctx.sampleRate > 0.0 ? ctx.sampleRate : render.sampleRate;
+        const auto totalTime = static_cast<double> (info.stop - info.start) / render.sampleRate;
+        ValueTree sample (Tags::sample);
+        sample.setProperty (Tags::uuid, Uuid().toString(), nullptr)
+              .setProperty (Tags::set, info.layerId.toString(), nullptr)
+              .setProperty (Tags::rig, info.rigId, nullptr)
+              .setProperty (Tags::file, info.file.getFileName(), nullptr)
+              .setProperty (Tags::note, info.note, nullptr)
+              .setProperty (Tags::sampleRate, fileSampleRate, nullptr)
+              .setProperty (Tags::channels, ctx.channels, nullptr)
+              .setProperty (Tags::length, totalTime, nullptr)
+              .setProperty (Tags::timeIn, 0.0, nullptr)
+              .setProperty (Tags::timeOut, totalTime, nullptr);
+        return sample;
+    }
+
+    /** Sets the detected start and end, call once the writer was closed */
+    static void applyTrim (ValueTree& sample, const TrimDetector* trim)
+    {
+        const double rate = sample.getProperty (Tags::sampleRate);
+        if (trim == nullptr || ! trim->isEnabled() || trim->getLength() <= 0 || rate <= 0.0)
+            return;
+        sample.setProperty (Tags::timeIn, static_cast<double> (trim->getStartFrame()) / rate, nullptr)
+              .setProperty (Tags::timeOut, static_cast<double> (trim->getEndFrame()) / rate, nullptr)
+              .setProperty (Tags::trimmed, true, nullptr);
+    }
+
+    void setProgress (double value, const String& title)
+    {
+        {
+            ScopedLock sl (lock);
+            progressValue = value;
+            progressTitle = title;
+        }
+        render.finalizeProgress.triggerAsyncUpdate();
+    }
+
+    void finalize()
+    {
+        OwnedArray<LayerRenderDetails> details;
+        RenderContext ctx;
+        bool wasCancelled;
+        {
+            ScopedLock sl (lock);
+            details.swapWith (finished);
+            ctx = context;
+            wasCancelled = cancelled;
+        }
+
+        for (auto* const detail : details)
+        {
+            if (! wasCancelled)
+                for (auto* const info : detail->cached)
+                    manifest.appendChild (createEntry (*info, ctx), nullptr);
+
+            for (auto* const info : detail->samples)
+            {
+                if (info->writer == nullptr)
+                    continue;
+                info->writer.reset();
+                if (wasCancelled)
+                {
+                    // not journaled, a resumed render captures the note again
+                    info->file.deleteFile();
+                }
+                else
+                {
+                    auto sample = createEntry (*info, ctx);
+                    applyTrim (sample, info->trim.get());
+                    manifest.appendChild (sample, nullptr);
+                }
+                numClosed.set (numClosed.get() + 1);
+                if (! wasCancelled)
+                    setProgress (static_cast<double> (numClosed.get()) / jmax (1, numSamples),
+                                 "Closing files...");
+            }
+        }
+
+        const auto captureDir = ctx.getCaptureDir();
+        const auto samplesDir = ctx.getSamplesDir();
+
+        {
+            ScopedLock sl (lock);
+            journal.reset();
+        }
+
+        // journaled files stay in the capture directory, so the next start
+        // with the same settings picks up where this one was cancelled
+        if (wasCancelled)
+            return;
+
+        setProgress (1.0, "Moving samples...");
+        samplesDir.createDirectory();
+        for (auto* const detail : details)
+        {
+            Array<SampleInfo*> files (detail->samples.begin(), detail->samples.size());
+            // files resumed from an interrupted render are still in the capture directory
+            for (auto* const info : detail->cached)
+                if (info->file.getParentDirectory() == captureDir)
+                    files.add (info);
+
+            for (auto* const info : files)
+            {
+                // a rename is atomic on the same filesystem, copy otherwise
+                const auto target = samplesDir.getChildFile (info->file.getFileName());
+                if (! info->file.moveFileTo (target))
+                {
+                    DBG("[VCP] could not rename " << info->file.getFileName() << ", copying");
+                    info->file.copyFileTo (target);
+                    info->file.deleteFile();
+                }
+            }
+        }
+
+        captureDir.deleteRecursively();
+        removeUnusedFiles (samplesDir);
+        writeReport (details, ctx);
+    }
+
+    /** Writes wall time, speed, level and writer stalls of every rendered
+        note, e.g. to plan how many notes a machine can capture */
+    void writeReport (const OwnedArray<LayerRenderDetails>& details, const RenderContext& ctx)
+    {
+        const double rate = render.sampleRate;
+        Array<var> notes;
+        int64 firstTicks = 0, lastTicks = 0, totalFrames = 0;
+        int numCached = 0, totalStalls = 0;
+
+        for (auto* const detail : details)
+        {
+            numCached += detail->cached.size();
+            for (auto* const info : detail->samples)
+            {
+                if (info->startTicks == 0 || info->stopTicks <= info->startTicks)
+                    continue;
+
+                const auto frames = info->stop - info->start;
+                const double wall = Time::highResolutionTicksToSeconds (info->stopTicks - info->startTicks);
+                DynamicObject::Ptr note = new DynamicObject();
+                note->setProperty ("file",              info->file.getFileName());
+                note->setProperty ("layer",             info->layerId.toString());
+                note->setProperty ("rig",               info->rig);
+                note->setProperty ("note",              info->note);
+                note->setProperty ("frames",            frames);
+                note->setProperty ("wall_seconds",      wall);
+                note->setProperty ("realtime_factor",   wall > 0.0 ? frames / rate / wall : 0.0);
+                note->setProperty ("peak_db",           Decibels::gainToDecibels (info->peak, -120.f));
+                note->setProperty ("writer_stalls",     info->stalls);
+                notes.add (note.get());
+
+                firstTicks   = firstTicks == 0 ? info->startTicks : jmin (firstTicks, info->startTicks);
+                lastTicks    = jmax (lastTicks, info->stopTicks);
+                totalFrames += frames;
+                totalStalls += info->stalls;
+            }
+        }
+
+        const double wall = Time::highResolutionTicksToSeconds (lastTicks - firstTicks);
+        DynamicObject::Ptr report = new DynamicObject();
+        report->setProperty ("finished",        Time::getCurrentTime().toISO8601 (true));
+        report->setProperty ("source",          SourceType::getSlug (ctx.source));
+        report->setProperty ("sample_rate",     rate);
+        report->setProperty ("notes_rendered",  notes.size());
+        report->setProperty ("notes_cached",    numCached);
+        report->setProperty ("audio_seconds",   totalFrames / rate);
+        report->setProperty ("wall_seconds",    wall);
+        report->setProperty ("realtime_factor", wall > 0.0 ? totalFrames / rate / wall : 0.0);
+        report->setProperty ("writer_stalls",   totalStalls);
+        report->setProperty ("notes",           notes);
+
+        if (! Render::getReportFile (ctx).replaceWithText (JSON::toString (report.get())))
+            DBG("[VCP] could not write render report");
+    }
+
+    /** Removes files no longer referenced by the manifest */
+    void removeUnusedFiles (const File& samplesDir)
+    {
+        StringArray used;
+        for (int i = 0; i < manifest.getNumChildren(); ++i)
+            used.add (manifest.getChild(i).getProperty (Tags::file).toString());
+
+        for (DirectoryIterator iter (samplesDir, false, "*", File::findFiles); iter.next();)
+            if (! used.contains (iter.getFile().getFileName()))
+                iter.getFile().deleteFile();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        bool wasCancelled;
+        {
+            ScopedLock sl (lock);
+            wasCancelled = cancelled;
+        }
+
+        render.samples = wasCancelled ? ValueTree (Tags::samples) : manifest;
+        manifest = ValueTree();
+        busy.set (0);
+
+        if (wasCancelled)
+            render.cancelled.triggerAsyncUpdate();
+        else
+            render.stopped.triggerAsyncUpdate();
+    }
+};
+
+void Render::FinalizeProgress::handleAsyncUpdate()
+{
+    if (! render.onFinalizeProgress || render.finalizer == nullptr)
+        return;
+    double value = 0.0;
+    String title;
+    render.finalizer->getProgress (value, title);
+    render.onFinalizeProgress (value, title);
+}
+
+//=============================================================================
 Render::Render (AudioFormatManager& f)
     : formats (f), 
       thread ("vcprender"),
       started (*this),
       stopped (*this),
       cancelled (*this),
-      progress (*this)
-{ }
+      progress (*this),
+      finalizeProgress (*this)
+{
+    finalizer.reset (new Finalizer (*this));
+}
 
 Render::~Render()
 {
+    finalizer.reset();
+    for (auto* const encoder : encoders)
+        encoder->stopThread (2 * 1000);
     thread.stopThread (2 * 1000);
 }
 
@@ -42,6 +445,44 @@ void Render::reset()
 {
     frame = 0;
     layer = 0;
+    layerFrameOffset = 0;
+    nextProgressFrame = 0;
+    framesRendered.store (0);
+}
+
+double Render::getProgress() const
+{
+    const auto total = framesTotal.load();
+    return total > 0 ? jlimit (0.0, 1.0, static_cast<double> (framesRendered.load()) / static_cast<double> (total))
+                     : 0.0;
+}
+
+String Render::getProgressTitle() const
+{
+    // titles don't change while rendering
+    const int index = currentTitle.load();
+    return isRendering() && isPositiveAndBelow (index, titles.size()) ? titles[index] : String();
+}
+
+double Render::getTimeRemaining() const
+{
+    if (! isRendering() || sampleRate <= 0.0)
+        return -1.0;
+
+    const auto done      = framesRendered.load();
+    const auto remaining = jmax ((int64) 0, framesTotal.load() - done);
+    const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks.load());
+
+    // real time until enough was rendered to measure the actual rate
+    double rate = sampleRate;
+    if (done > static_cast<int64> (sampleRate) && elapsed > 0.0)
+        rate = static_cast<double> (done) / elapsed;
+    return static_cast<double> (remaining) / rate;
+}
+
+File Render::getReportFile (const RenderContext& ctx)
+{
+    return ctx.getCaptureDir().getSiblingFile ("render-report.json");
 }
 
 void Render::prepare (double newSampleRate, int newBufferSize)
@@ -61,12 +502,16 @@ void Render::prepare (double newSampleRate, int newBufferSize)
 
 void Render::renderCycleBegin()
 {
+    writerFill = -1.f;
+    writerOverflow = false;
+
     if (renderingRequest.get() != rendering.get())
     {
         rendering.set (renderingRequest.get());
         if (isRendering())
         {
             DBG("[VCP] rendering started");
+            startTicks.store (Time::getHighResolutionTicks());
             stopped.cancelPendingUpdate();
             started.cancelPendingUpdate();
             started.triggerAsyncUpdate();
@@ -82,7 +527,7 @@ void Render::renderCycleBegin()
     }
 }
 
-void Render::getNextMidiBlock (MidiBuffer& buffer, int nframes)
+void Render::getNextMidiBlock (MidiBuffer& buffer, int nframes, int rig)
 {
     
     if (! isRendering())
@@ -97,10 +542,15 @@ void Render::getNextMidiBlock (MidiBuffer& buffer, int nframes)
     }
 
     auto* const detail  = details.getUnchecked (layer);
-    const auto& midi    = detail->sequence;
+    if (! isPositiveAndBelow (rig, detail->sequences.size()))
+        return;
+
+    const auto& midi    = *detail->sequences.getUnchecked (rig);
     const int numEvents = midi.getNumEvents();
     const double start  = static_cast<double> (frame);
-    const int64 endFrame  = frame + nframes;
+    int64 endFrame      = frame + nframes;
+    if (detail->settleFrame >= 0 && ! detail->settled)
+        endFrame = jmin (endFrame, detail->settleFrame);
     const double end    = static_cast<double> (endFrame);
     bool layerChanged   = false;
     int i;
@@ -153,6 +603,28 @@ void Render::writeAudioFrames (AudioSampleBuffer& audio)
 
     const int nframes           = audio.getNumSamples();
     auto* const detail          = details.getUnchecked (layer);
+
+    // after a program change, hold the timeline until the source settled
+    if (detail->settleFrame >= 0 && ! detail->settled)
+    {
+        if (frame >= detail->settleFrame)
+        {
+            if (settle.process (audio))
+            {
+                detail->settled = true;
+                DBG("[VCP] program settled after " << settle.getElapsedTime() << " ms");
+            }
+            return;
+        }
+
+        if (frame + nframes >= detail->settleFrame)
+        {
+            frame = detail->settleFrame;
+            settle.reset();
+            return;
+        }
+    }
+
     const int numDetails        = detail->getNumSamples();
     const auto lastStopFrame    = detail->getHighestEndFrame();
     const int64 startFrame      = frame - writerDelay;
@@ -164,25 +636,34 @@ void Render::writeAudioFrames (AudioSampleBuffer& audio)
         if (render->start >= endFrame)
             break;
    
+        const int channelOffset = render->rig * context.channels;
+
         if (render->start >= startFrame && render->start < endFrame)
         {
-            progress.triggerAsyncUpdate();
+            if (render->rig == 0)
+            {
+                currentTitle.store (render->step, std::memory_order_relaxed);
+                progress.triggerAsyncUpdate();
+            }
+            render->startTicks = Time::getHighResolutionTicks();
             const int localFrame = render->start - startFrame;
             for (int c = 0; c < context.channels; ++c)
-                channels[c] = audio.getWritePointer (c, localFrame);
-            render->writer->write (channels.get(), endFrame - render->start);
+                channels[c] = audio.getWritePointer (channelOffset + c, localFrame);
+            write (*render, static_cast<int> (endFrame - render->start));
         }
         else if (render->stop >= startFrame && render->stop < endFrame)
         {
             for (int c = 0; c < context.channels; ++c)
-                channels[c] = audio.getWritePointer (c);
-            render->writer->write (channels.get(), render->stop - startFrame);
+                channels[c] = audio.getWritePointer (channelOffset + c);
+            write (*render, static_cast<int> (render->stop - startFrame));
+            render->stopTicks = Time::getHighResolutionTicks();
+            finalizer->sampleFinished (layer, i);
         }
         else if (startFrame >= render->start && startFrame < render->stop)
         {
             for (int c = 0; c < context.channels; ++c)
-                channels[c] = audio.getWritePointer (c);
-            render->writer->write (channels.get(), nframes);
+                channels[c] = audio.getWritePointer (channelOffset + c);
+            write (*render, nframes);
         }
 
         ++i;
@@ -191,6 +672,7 @@ void Render::writeAudioFrames (AudioSampleBuffer& audio)
     if (lastStopFrame >= startFrame && lastStopFrame < endFrame)
     {
         ++layer;
+        layerFrameOffset += lastStopFrame + writerDelay;
         frame = 0;
         event = 0;
     }
@@ -198,6 +680,39 @@ void Render::writeAudioFrames (AudioSampleBuffer& audio)
     {
         frame += nframes;
     }
+
+    // the title only changes when a note starts, the estimate keeps moving
+    framesRendered.store (layerFrameOffset + frame, std::memory_order_relaxed);
+    if (layerFrameOffset + frame >= nextProgressFrame)
+    {
+        nextProgressFrame = layerFrameOffset + frame + static_cast<int64> (sampleRate * 0.25);
+        progress.triggerAsyncUpdate();
+    }
+}
+
+void Render::write (SampleInfo& info, int numFrames)
+{
+    for (int c = 0; c < context.channels; ++c)
+    {
+        const auto range = FloatVectorOperations::findMinAndMax (channels[c], numFrames);
+        info.peak = jmax (info.peak, range.getEnd(), -range.getStart());
+    }
+
+    if (info.writer->write (channels.get(), numFrames))
+    {
+        info.queued += numFrames;
+    }
+    else
+    {
+        writerOverflow = true;
+        ++info.stalls;
+    }
+
+    if (info.fifoSize > 0 && info.encoded != nullptr)
+    {
+        const auto pending = info.queued - info.encoded->load (std::memory_order_relaxed);
+        writerFill = jmax (writerFill, static_cast<float> (pending) / static_cast<float> (info.fifoSize));
+    }
 }
 
 void Render::renderCycleEnd()
@@ -227,56 +742,15 @@ void Render::handleAsyncUpdate()
         ctx = context;
     }
 
-    const auto captureDir = ctx.getCaptureDir();
-    const auto projectDir = captureDir.getParentDirectory();
-    const auto samplesDir = projectDir.getChildFile ("samples");
-    const bool wasCancelled = shouldCancel.get() == 1;
-
-    if (! wasCancelled)
-    {
-        ValueTree manifest (Tags::samples);
-        
-        for (auto* detail : old)
-        {
-            for (auto* const info : detail->samples)
-            {
-                ValueTree sample (Tags::sample);
-                info->writer.reset();
-                auto totalTime = static_cast<double> (info->stop - info->start) / sampleRate;
-
-                sample.setProperty (Tags::uuid, Uuid().toString(), nullptr)
-                      .setProperty (Tags::set, info->layerId.toString(), nullptr)
-                      .setProperty (Tags::file, info->file.getFileName(), nullptr)
-                      .setProperty (Tags::note, info->note, nullptr)
-                      .setProperty (Tags::sampleRate, sampleRate, nullptr)
-                      .setProperty (Tags::length, totalTime, nullptr)
-                      .setProperty (Tags::timeIn, 0.0, nullptr)
-                      .setProperty (Tags::timeOut, totalTime, nullptr);
-                manifest.appendChild (sample, nullptr);
-            }
-        }
-        
-        if (samplesDir.exists())
-            samplesDir.deleteRecursively();
-        captureDir.copyDirectoryTo (samplesDir);
-        captureDir.deleteRecursively();
-        
-        samples = manifest;
-        stopped.triggerAsyncUpdate();
-    }
-    else
-    {
-        for (auto* detail : old)
-            for (auto* const info : detail->samples)
-                info->writer.reset();
-        captureDir.deleteRecursively();
-        samples = ValueTree (Tags::samples);
-        cancelled.triggerAsyncUpdate();
-    }
-
+    finalizer->finish (old, ctx, shouldCancel.get() == 1);
     shouldCancel.set (0);
 }
 
+bool Render::isFinalizing() const
+{
+    return finalizer != nullptr && finalizer->isBusy();
+}
+
 void Render::setContext (const RenderContext& newContext)
 {
     if (rendering.get() != 0 || renderingRequest.get() != 0)
@@ -285,14 +759,20 @@ void Render::setContext (const RenderContext& newContext)
     context = newContext;
 }
 
-Result Render::start (const RenderContext& newContext, int latencySamples)
+Result Render::start (const RenderContext& renderContext, int latencySamples)
 {
     if (isRendering())
         return Result::fail ("recording already in progress");
+    if (isFinalizing())
+        return Result::fail ("previous recording is still being saved");
 
     jassert (sampleRate > 0.0);
     jassert (blockSize > 0);
 
+    RenderContext newContext (renderContext);
+    StringPairArray cachedFiles;
+    findCachedFiles (newContext, cachedFiles);
+
     const auto extension = FormatType::getFileExtension (FormatType::fromSlug (newContext.format));
     auto* const audioFormat = formats.findFormatForFileExtension (extension);
     if (! audioFormat)
@@ -301,38 +781,80 @@ Result Render::start (const RenderContext& newContext, int latencySamples)
         return Result::fail ("could not create encoder for recording");
     }
 
+    // FLAC only takes 16 and 24 bit, catch it before the capture dir is cleared
+    if (! audioFormat->getPossibleBitDepths().contains (newContext.bitDepth))
+    {
+        String message = audioFormat->getFormatName();
+        message << " can't record at " << newContext.bitDepth << " bit";
+        return Result::fail (message);
+    }
+
+    // files are written at the context's rate, or the device rate if not set
+    const double fileSampleRate = newContext.sampleRate > 0.0 ? newContext.sampleRate : sampleRate;
+
     OwnedArray<LayerRenderDetails> newDetails;
     const File directory = newContext.getCaptureDir();
-    if (directory.exists())
+    if (resumeFromJournal (newContext, cachedFiles) <= 0 && directory.exists())
         directory.deleteRecursively();
     directory.createDirectory();
-    steps.clearQuick();
-    totalSteps = 0;
-    for (int i = 0; i < newContext.layers.size(); ++i)
+    prepareEncoders (FormatType::fromSlug (newContext.format));
+    const bool compressed = FormatType::fromSlug (newContext.format) == FormatType::FLAC;
+    int numWriters = 0;
+    StringArray newTitles;
+    int lastProgram = -1, lastChannel = -1;
+    for (const int i : newContext.getLayerOrder())
     {
         String layerName = "Layer "; layerName << int (i + 1);
+        const auto& layerInfo = newContext.layers.getReference (i);
+        const bool programLoaded = layerInfo.midiProgram == lastProgram
+                                && layerInfo.midiChannel == lastChannel;
         auto* details = newDetails.add (newContext.createLayerRenderDetails (
-                                        i, sampleRate, formats, thread));
+                                        i, sampleRate, formats, thread, programLoaded));
+        if (details->settleFrame >= 0)
+        {
+            lastProgram = layerInfo.midiProgram;
+            lastChannel = layerInfo.midiChannel;
+        }
+
+        for (auto* const sample : details->cached)
+            sample->file = File (cachedFiles [sample->key]);
+
         for (auto* const sample : details->samples)
         {
             const auto file = sample->file;
             std::unique_ptr<FileOutputStream> stream (file.createOutputStream());
-            String step = layerName;
-            step << " - " << MidiMessage::getMidiNoteName (sample->note, true, true, 4);
-            steps.add (step);
+            if (sample->rig == 0)
+            {
+                String title = layerName;
+                title << " - " << MidiMessage::getMidiNoteName (sample->note, true, true, 4);
+                sample->step = newTitles.size();
+                newTitles.add (title);
+            }
 
             if (stream)
             {
                 if (auto* const writer = audioFormat->createWriterFor (
                         stream.get(),
-                        sampleRate,
+                        fileSampleRate,
                         newContext.channels,
                         newContext.bitDepth,
                         StringPairArray(),
-                        0
+                        compressed ? 5 : 0
                     ))
                 {
-                    sample->writer.reset (new AudioFormatWriter::ThreadedWriter (writer, thread, 8192));
+                    auto* const capture = new CaptureWriter (writer, sampleRate);
+                    capture->setDither (newContext.dither);
+                    sample->encoded = std::make_shared<std::atomic<int64>> (0);
+                    capture->setWrittenCounter (sample->encoded);
+                    sample->fifoSize = compressed ? 32768 : 8192;
+                    if (newContext.trimThreshold < 0.f)
+                    {
+                        sample->trim = std::make_shared<TrimDetector>();
+                        sample->trim->prepare (newContext.trimThreshold, newContext.trimThreshold - 12.f);
+                        capture->setTrimDetector (sample->trim);
+                    }
+                    sample->writer.reset (new AudioFormatWriter::ThreadedWriter (capture,
+                        getWriterThread (numWriters++), sample->fifoSize));
                     stream.release();
                     DBG("[VCP] " << file.getFullPathName());
                 }
@@ -351,15 +873,57 @@ Result Render::start (const RenderContext& newContext, int latencySamples)
         }
     }
 
-    totalSteps = steps.size();
     samples = ValueTree (samplesType);
+    finalizer->prepare (numWriters, getJournalFile (newContext));
+
+    // rigs with a measured latency are captured relative to the quickest one
+    int baseDelay = latencySamples;
+    if (newContext.rigs.size() > 0)
+    {
+        Array<int> rigDelays;
+        for (const auto& rig : newContext.rigs)
+            rigDelays.add (rig.measuredLatency >= 0.0 
+                ? roundToInt (rig.measuredLatency * 0.001 * sampleRate) : latencySamples);
+        
+        baseDelay = rigDelays.getFirst();
+        for (const auto delay : rigDelays)
+            baseDelay = jmin (baseDelay, delay);
+
+        SampleStartSorter sorter;
+        for (auto* const details : newDetails)
+        {
+            for (auto* const sample : details->samples)
+            {
+                const int offset = rigDelays [sample->rig] - baseDelay;
+                sample->start += offset;
+                sample->stop  += offset;
+            }
+
+            details->samples.sort (sorter, true);
+        }
+    }
+
+    // hardware can mute for a while when loading a patch, plugins switch quicker
+    SettleDetector::Options settleOptions;
+    settleOptions.silentTime = newContext.source == SourceType::Hardware ? 1000.0 : 250.0;
+    settleOptions.timeout = jmax (settleOptions.minimumTime, newContext.programSettle);
+
+    // each layer runs until its last note stopped plus the writer delay
+    const int newWriterDelay = jmax (0, newContext.latency + baseDelay);
+    int64 newFramesTotal = 0;
+    for (auto* const detail : newDetails)
+        newFramesTotal += detail->getHighestEndFrame() + newWriterDelay;
 
     {
         ScopedLock sl (getCallbackLock());
+        settle.prepare (sampleRate, settleOptions);
         nlayers         = jmax (0, newContext.layers.size());
-        writerDelay     = jmax (0, newContext.latency + latencySamples);
+        writerDelay     = newWriterDelay;
         context         = newContext;
         details.swapWith (newDetails);
+        titles.swapWith (newTitles);
+        currentTitle.store (-1);
+        framesTotal.store (newFramesTotal);
     }
 
     if (shouldCancel.compareAndSetBool (0, 1))
@@ -377,6 +941,106 @@ Result Render::start (const RenderContext& newContext, int latencySamples)
     return Result::ok();
 }
 
+void Render::findCachedFiles (RenderContext& ctx, StringPairArray& files)
+{
+    ctx.cachedKeys.clearQuick();
+    if (ctx.sourceKey.isEmpty())
+        return;
+
+    // rendered files end with _<key>.<ext>
+    const auto extension = FormatType::getFileExtension (FormatType::fromSlug (ctx.format));
+    for (DirectoryIterator iter (ctx.getSamplesDir(), false, String ("*.") + extension); iter.next();)
+    {
+        const auto file = iter.getFile();
+        const auto key  = file.getFileNameWithoutExtension().fromLastOccurrenceOf ("_", false, false);
+        if (key.length() == 16 && key.containsOnly ("0123456789abcdef") && file.getSize() > 0)
+        {
+            ctx.cachedKeys.add (key);
+            files.set (key, file.getFullPathName());
+        }
+    }
+
+    DBG("[VCP] cached notes: " << ctx.cachedKeys.size());
+}
+
+File Render::getJournalFile (const RenderContext& ctx)
+{
+    return ctx.getCaptureDir().getChildFile ("render.journal");
+}
+
+int Render::resumeFromJournal (RenderContext& ctx, StringPairArray& files)
+{
+    const auto directory = ctx.getCaptureDir();
+    const auto journal = getJournalFile (ctx);
+    if (! journal.existsAsFile())
+        return 0;
+
+    // each line is <key> <tab> <file name> <tab> <frames>
+    StringArray lines, valid;
+    journal.readLines (lines);
+    Array<File> keep;
+    for (const auto& line : lines)
+    {
+        StringArray tokens;
+        tokens.addTokens (line, "\t", String());
+        if (tokens.size() != 3 || tokens[0].length() != 16)
+            continue;
+
+        const auto file = directory.getChildFile (tokens[1]);
+        if (file.getParentDirectory() != directory || ! file.existsAsFile())
+            continue;
+
+        std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+        if (reader == nullptr || std::abs (reader->lengthInSamples - tokens[2].getLargeIntValue()) > 2)
+        {
+            DBG("[VCP] discarding incomplete file: " << file.getFileName());
+            continue;
+        }
+
+        ctx.cachedKeys.addIfNotAlreadyThere (tokens[0]);
+        files.set (tokens[0], file.getFullPathName());
+        keep.add (file);
+        valid.add (line);
+    }
+
+    // writers append to existing files, so partial captures must go
+    for (DirectoryIterator iter (directory, false, "*", File::findFiles); iter.next();)
+        if (iter.getFile() != journal && ! keep.contains (iter.getFile()))
+            iter.getFile().deleteFile();
+
+    if (valid.isEmpty())
+    {
+        journal.deleteFile();
+        return 0;
+    }
+
+    valid.add (String());
+    journal.replaceWithText (valid.joinIntoString ("\n"));
+    DBG("[VCP] resuming render with " << valid.size() - 1 << " completed files");
+    return valid.size() - 1;
+}
+
+void Render::prepareEncoders (int format)
+{
+    const int numEncoders = format == FormatType::FLAC
+        ? jlimit (1, 4, SystemStats::getNumCpus() / 2) - 1 : 0;
+
+    while (encoders.size() < numEncoders)
+    {
+        auto* const encoder = encoders.add (new TimeSliceThread (
+            String ("vcpencode") + String (encoders.size() + 1)));
+        encoder->startThread();
+    }
+
+    numWriterThreads = 1 + numEncoders;
+}
+
+TimeSliceThread& Render::getWriterThread (int index)
+{
+    const int i = index % numWriterThreads;
+    return i == 0 ? thread : *encoders.getUnchecked (i - 1);
+}
+
 void Render::cancel()
 {
     shouldCancel.set (1);
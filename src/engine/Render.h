@@ -1,6 +1,7 @@
 #pragma once
 
 #include "engine/ChannelDelay.h"
+#include "engine/SettleDetector.h"
 #include "RenderContext.h"
 
 namespace vcp {
@@ -14,7 +15,7 @@ public:
     //=========================================================================
     void prepare (double newSampleRate, int newBlockSize);
     void renderCycleBegin();
-    void getNextMidiBlock (MidiBuffer& midi, int nframes);
+    void getNextMidiBlock (MidiBuffer& midi, int nframes, int rig = 0);
     void writeAudioFrames (AudioSampleBuffer& audio);
     void renderCycleEnd();
     void release();
@@ -26,6 +27,18 @@ public:
     //=========================================================================
     /** Returns true if currently rendering or rendering has been requested */
     bool isRendering() const { return renderingRequest.get() != 0 || rendering.get() != 0; }
+
+    /** Returns the fill level (0 - 1) of the fullest writer FIFO during
+        this cycle, or -1 if nothing was written. Audio thread only */
+    float getWriterFill() const { return writerFill; }
+
+    /** Returns true if a writer FIFO couldn't take all the audio during
+        this cycle. Audio thread only */
+    bool hasWriterOverflowed() const { return writerOverflow; }
+
+    /** Returns true while files from the last render are being closed and
+        moved into place */
+    bool isFinalizing() const;
     
     //=========================================================================
     /** Update the context.  The properties here may not be used for rendering
@@ -40,20 +53,32 @@ public:
         with getCallbackLock() */
     int getSourceType() const { return context.source; }
 
+    /** Returns the number of rigs being captured. Only use in audio thread
+        or lock with getCallbackLock() */
+    int getNumRigs() const { return context.getNumRigs(); }
+
     //=========================================================================
     /** Returns sample metadata after rendering has completed */
     ValueTree getSamples() const { return samples; }
 
-    double getProgress() const { return progressValue; }
-    String getNextProgressTitle()
-    {
-        if (steps.isEmpty())
-            return { };
-        progressValue = static_cast<double> (totalSteps - steps.size()) / static_cast<double> (totalSteps);
-        auto result = steps [0];
-        steps.remove (0);
-        return result;
-    }
+    /** Returns the fraction of scheduled frames rendered so far */
+    double getProgress() const;
+
+    /** Returns the name of the note currently being rendered */
+    String getProgressTitle() const;
+
+    /** Returns the estimated seconds left, based on the frames still
+        scheduled and the rate they were rendered at so far. Waiting for
+        programs to settle isn't included. Returns -1 if not rendering */
+    double getTimeRemaining() const;
+
+    /** Returns the JSON report written after a render completes */
+    static File getReportFile (const RenderContext& context);
+
+    //=========================================================================
+    /** Finds files in the samples directory which can be reused and sets
+        the context's cached keys */
+    static void findCachedFiles (RenderContext& context, StringPairArray& files);
 
     //=========================================================================
     CriticalSection& getCallbackLock() { return lock; }
@@ -66,11 +91,14 @@ public:
     std::function<void()> onStarted;
     std::function<void()> onCancelled;
     std::function<void()> onProgress;
+    std::function<void(double, const String&)> onFinalizeProgress;
 
 private:
     Identifier samplesType { "samples" };
     ValueTree samples;
     TimeSliceThread thread;
+    OwnedArray<TimeSliceThread> encoders;
+    int numWriterThreads = 1;
     AudioFormatManager& formats;
     
     CriticalSection lock;
@@ -84,6 +112,8 @@ private:
     Atomic<int> shouldCancel { 0 };
 
     int writerDelay = 0;
+    float writerFill = -1.f;
+    bool writerOverflow = false;
 
     int64 frame = 0;
     int event = 0;
@@ -92,9 +122,19 @@ private:
     
     HeapBlock<float*> channels;
     OwnedArray<LayerRenderDetails> details;
+    SettleDetector settle;
+
+    // progress, written on the audio thread
+    StringArray titles;
+    std::atomic<int> currentTitle { -1 };
+    std::atomic<int64> framesRendered { 0 };
+    std::atomic<int64> framesTotal { 0 };
+    std::atomic<int64> startTicks { 0 };
+    int64 layerFrameOffset = 0;
+    int64 nextProgressFrame = 0;
 
-    StringArray steps;
-    int totalSteps;
+    class Finalizer;
+    std::unique_ptr<Finalizer> finalizer;
 
     struct Started : public AsyncUpdater
     {
@@ -123,9 +163,31 @@ private:
         void handleAsyncUpdate()  { if (render.onProgress) render.onProgress(); }
         Render& render;
     } progress;
-    double progressValue = 0.0;
+
+    struct FinalizeProgress : public AsyncUpdater
+    {
+        FinalizeProgress (Render& r) : render (r) { }
+        void handleAsyncUpdate() override;
+        Render& render;
+    } finalizeProgress;
 
     void reset();
+
+    /** Hands the current channel pointers to a sample's writer */
+    void write (SampleInfo& info, int numFrames);
+
+    /** Returns the writer thread to use for the nth file. Compressed formats
+        are spread across a small pool of encoder threads */
+    TimeSliceThread& getWriterThread (int index);
+    void prepareEncoders (int format);
+
+    /** Returns the journal of completed files in the capture directory */
+    static File getJournalFile (const RenderContext& context);
+
+    /** Picks up files completed by an interrupted render. Entries are verified
+        against their expected length, anything else in the capture directory
+        is removed. Returns the number of files resumed */
+    int resumeFromJournal (RenderContext& context, StringPairArray& files);
 };
 
 }
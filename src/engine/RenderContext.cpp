@@ -48,10 +48,35 @@ ValueTree RenderContext::createValueTree() const
     return versicap;
 }
 
+String RenderContext::getRenderKey (const LayerInfo& layer, int note, int rig,
+                                   double fileSampleRate) const
+{
+    // without a source key the note can only be matched within one session
+    String text = sourceKey.isNotEmpty() ? sourceKey : String ("source:") + String (source);
+    text << "|" << note
+         << "|" << (int) layer.velocity
+         << "|" << layer.midiChannel
+         << "|" << layer.midiProgram
+         << "|" << layer.noteLength
+         << "|" << layer.tailLength
+         << "|" << roundToInt (fileSampleRate)
+         << "|" << channels
+         << "|" << bitDepth
+         << "|" << dither
+         << "|" << format;
+    if (isPositiveAndBelow (rig, rigs.size()))
+        text << "|" << rigs.getReference(rig).uuid
+             << "|" << rigs.getReference(rig).midiOutput
+             << "|" << rigs.getReference(rig).midiChannel;
+
+    return SHA256 (text.toUTF8()).toHexString().substring (0, 16);
+}
+
 LayerRenderDetails* RenderContext::createLayerRenderDetails (const int layerIdx,
                                                              const double sourceSampleRate,
                                                              AudioFormatManager& formats,
-                                                             TimeSliceThread& thread) const
+                                                             TimeSliceThread& thread,
+                                                             bool programLoaded) const
 {
     jassert (sourceSampleRate > 0.0);
     jassert (isPositiveAndBelow (layerIdx, layers.size()));
@@ -60,7 +85,10 @@ LayerRenderDetails* RenderContext::createLayerRenderDetails (const int layerIdx,
 
     std::unique_ptr<LayerRenderDetails> details;
     details.reset (new LayerRenderDetails());
-    auto& seq = details->sequence;
+
+    const int numRigs = getNumRigs();
+    for (int r = 0; r < numRigs; ++r)
+        details->sequences.add (new MidiMessageSequence());
 
     int key = keyStart;
     int64 frame = 0;
@@ -70,47 +98,124 @@ LayerRenderDetails* RenderContext::createLayerRenderDetails (const int layerIdx,
    
     const File directory (getCaptureDir());
     const auto extension = FormatType::getFileExtension (FormatType::fromSlug (format));
+    const double fileSampleRate = sampleRate > 0.0 ? sampleRate : sourceSampleRate;
 
-    if (isPositiveAndBelow (layer.midiProgram, 127))
+    auto getMidiChannel = [this, &layer] (int rig) -> int
     {
-        auto pgc = MidiMessage::programChange (layer.midiChannel, layer.midiProgram);
-        pgc.setTimeStamp (static_cast<double> (frame));
-        seq.addEvent (pgc);
-        frame += roundToInt (sourceSampleRate); // program delay
-    }
+        const int channel = isPositiveAndBelow (rig, rigs.size()) ? rigs.getReference(rig).midiChannel : 0;
+        return channel > 0 ? channel : layer.midiChannel;
+    };
+
+    bool programSent = programLoaded;
 
     while (key <= keyEnd)
     {
-        auto* const sample  = details->samples.add (new SampleInfo());
-        sample->layerId     = layer.uuid;
-        sample->index       = details->samples.size() - 1;
-        sample->note        = key;
-    
-        String identifier;
-        identifier << String(layerIdx).paddedLeft ('0', 3) << "_"
-                   << String(key).paddedLeft ('0', 3);
-        String fileName = identifier;
-        fileName << "." << extension;
-        sample->file = directory.getChildFile (fileName);
-
-        auto noteOn  = MidiMessage::noteOn (layer.midiChannel, key, layer.velocity);
-        noteOn.setTimeStamp (static_cast<double> (frame));
-        sample->start = frame;
-        frame += noteFrames;
+        StringArray keys;
+        bool isCached = cachedKeys.size() > 0;
+        for (int r = 0; r < numRigs; ++r)
+        {
+            keys.add (getRenderKey (layer, key, r, fileSampleRate));
+            isCached = isCached && cachedKeys.contains (keys[r]);
+        }
+
+        if (isCached)
+        {
+            for (int r = 0; r < numRigs; ++r)
+            {
+                auto* const sample  = details->cached.add (new SampleInfo());
+                sample->layerId     = layer.uuid;
+                sample->note        = key;
+                sample->rig         = r;
+                sample->key         = keys[r];
+                sample->stop        = noteFrames + tailFrames;
+                if (isPositiveAndBelow (r, rigs.size()))
+                    sample->rigId   = rigs.getReference(r).uuid;
+            }
+
+            key += keyStride;
+            continue;
+        }
+
+        if (! programSent && isPositiveAndBelow (layer.midiProgram, 127))
+        {
+            for (int r = 0; r < numRigs; ++r)
+            {
+                auto pgc = MidiMessage::programChange (getMidiChannel (r), layer.midiProgram);
+                pgc.setTimeStamp (static_cast<double> (frame));
+                details->sequences.getUnchecked(r)->addEvent (pgc);
+            }
+
+            // the render holds here until the source settled, see Render
+            frame += roundToInt (sourceSampleRate * 0.01);
+            details->settleFrame = frame;
+        }
+
+        programSent = true;
+        const int64 noteOnFrame  = frame;
+        const int64 noteOffFrame = frame + noteFrames;
+        frame = noteOffFrame + tailFrames;
+
+        for (int r = 0; r < numRigs; ++r)
+        {
+            auto* const sample  = details->samples.add (new SampleInfo());
+            sample->layerId     = layer.uuid;
+            sample->index       = details->samples.size() - 1;
+            sample->note        = key;
+            sample->rig         = r;
+            sample->key         = keys[r];
+            if (isPositiveAndBelow (r, rigs.size()))
+                sample->rigId   = rigs.getReference(r).uuid;
         
-        auto noteOff = MidiMessage::noteOff (layer.midiChannel, key);
-        noteOff.setTimeStamp (static_cast<double> (frame));
-        frame += tailFrames;
-        sample->stop = frame;
+            String identifier;
+            if (rigs.size() > 0)
+                identifier << "r" << String(r).paddedLeft ('0', 2) << "_";
+            identifier << String(layerIdx).paddedLeft ('0', 3) << "_"
+                       << String(key).paddedLeft ('0', 3);
+            if (sourceKey.isNotEmpty())
+                identifier << "_" << sample->key;
+            String fileName = identifier;
+            fileName << "." << extension;
+            sample->file = directory.getChildFile (fileName);
+
+            const int channel = getMidiChannel (r);
+            auto noteOn  = MidiMessage::noteOn (channel, key, layer.velocity);
+            noteOn.setTimeStamp (static_cast<double> (noteOnFrame));
+            auto noteOff = MidiMessage::noteOff (channel, key);
+            noteOff.setTimeStamp (static_cast<double> (noteOffFrame));
+
+            sample->start = noteOnFrame;
+            sample->stop  = frame;
+
+            auto* const seq = details->sequences.getUnchecked (r);
+            seq->addEvent (noteOn);
+            seq->addEvent (noteOff);
+        }
 
-        seq.addEvent (noteOn);
-        seq.addEvent (noteOff);
         key += keyStride;
     }
     
     return details.release();
 }
 
+Array<int> RenderContext::getLayerOrder() const
+{
+    Array<int> order;
+    for (int i = 0; i < layers.size(); ++i)
+    {
+        if (order.contains (i))
+            continue;
+        const auto& first = layers.getReference (i);
+        for (int j = i; j < layers.size(); ++j)
+        {
+            const auto& layer = layers.getReference (j);
+            if (layer.midiProgram == first.midiProgram && layer.midiChannel == first.midiChannel)
+                order.add (j);
+        }
+    }
+
+    return order;
+}
+
 void RenderContext::writeToFile (const File& file) const
 {
     const auto tree = createValueTree();
@@ -2,26 +2,56 @@
 
 #include "JuceHeader.h"
 #include "../Types.h"
+#include "engine/TrimDetector.h"
+#include <atomic>
 
 namespace vcp {
 
 struct SampleInfo
 {
     Uuid layerId;
+    String rigId;
     int index   = 0;
     int note    = 0;
+    int rig     = 0;
     
     int64 start = 0;
     int64 stop  = 0;
 
+    String key;
     File file;
     std::unique_ptr<AudioFormatWriter::ThreadedWriter> writer;
+    /** Runs on the writer thread, read once the writer is closed. Shared
+        with the writer, which can outlive this info */
+    std::shared_ptr<TrimDetector> trim;
+
+    /** Frames handed to the writer and frames it encoded so far, the
+        difference is waiting in the writer's FIFO of fifoSize frames. The
+        writer counts into a shared counter since it can outlive this info */
+    int64 queued = 0;
+    std::shared_ptr<std::atomic<int64>> encoded;
+    int fifoSize = 0;
+
+    /** Collected on the audio thread for the render report */
+    int step = -1;              // progress title, rig zero only
+    int64 startTicks = 0;
+    int64 stopTicks = 0;
+    float peak = 0.f;
+    int stalls = 0;
 };
 
 struct LayerRenderDetails
 {
-    MidiMessageSequence sequence;
+    /** One sequence per rig. Rig zero is used when recording plugins */
+    OwnedArray<MidiMessageSequence> sequences;
     OwnedArray<SampleInfo> samples;
+    /** Samples reused from an earlier render, these aren't scheduled */
+    OwnedArray<SampleInfo> cached;
+
+    /** Frame the render holds at after a program change until the source
+        has settled, -1 if the layer doesn't change programs */
+    int64 settleFrame = -1;
+    bool settled = false;
     
     int getNumSamples() const { return samples.size(); }
     SampleInfo* getSample (const int i) { return samples.getUnchecked (i); }
@@ -84,6 +114,16 @@ struct LayerInfo
     }
 };
 
+struct RigInfo
+{
+    String  uuid;
+    String  name;
+    String  midiOutput;
+    int     midiChannel     = 0;    // 0 = use the layer's channel
+    int     inputChannel    = 0;
+    double  measuredLatency = -1.0; // milliseconds, < 0 = not measured
+};
+
 struct RenderContext
 {
     int source                  = SourceType::Hardware;
@@ -97,6 +137,7 @@ struct RenderContext
     int tailLength              = 1000;
 
     Array<LayerInfo> layers;
+    Array<RigInfo> rigs;
 
     String instrumentName       = "Instrument";
     String outputPath           = String();
@@ -104,17 +145,49 @@ struct RenderContext
     int channels                = 2;
     int bitDepth                = 16;
     int latency                 = 0;
-    double sampleRate           = 44100.0;
+    double measuredLatency      = -1.0; // milliseconds, < 0 = not measured
+
+    /** Identifies the sound being rendered, e.g. a plugin and its state.
+        Notes are cached by content when this is set */
+    String sourceKey;
+    /** Keys of notes which already have a file in the samples directory,
+        or in the capture directory when resuming */
+    StringArray cachedKeys;
+
+    double sampleRate           = 0.0;  // file sample rate, 0 = device rate
+    double programSettle        = 3000.0; // longest wait after a program change in milliseconds
+    float trimThreshold         = 0.f;  // onset level in dB for trimming, 0 = don't trim
+    int dither                  = 0;    // SampleConverter::Dither used for integer files
+    int workers                 = 0;    // plugin render processes, 0 = render in process, -1 = automatic
 
     ValueTree createValueTree() const;
     void writeToFile (const File& file) const;
     void restoreFromFile (const File& file);
 
+    /** Returns the number of rigs captured in parallel. This is always at
+        least one, the implicit rig used when none are defined */
+    int getNumRigs() const { return jmax (1, rigs.size()); }
+
     File getCaptureDir() const;
+    File getSamplesDir() const { return getCaptureDir().getSiblingFile ("samples"); }
+
+    /** Returns the content key for a note. Two notes with the same key
+        render identical audio. Without a source key this only identifies
+        the note within a render, e.g. for resuming */
+    String getRenderKey (const LayerInfo& layer, int note, int rig,
+                         double fileSampleRate) const;
+
+    /** Creates the schedule for one layer. Set programLoaded when the
+        layer's program is already active, e.g. a previous layer used it */
     LayerRenderDetails* createLayerRenderDetails (const int layer, 
                                                   const double sourceSampleRate,
                                                   AudioFormatManager& formats,
-                                                  TimeSliceThread& thread) const;
+                                                  TimeSliceThread& thread,
+                                                  bool programLoaded = false) const;
+
+    /** Returns the order layers should render in. Layers sharing a program
+        and channel are grouped so the program only changes once */
+    Array<int> getLayerOrder() const;
 };
 
 }
@@ -0,0 +1,948 @@
+#include "engine/CaptureWriter.h"
+#include "engine/Render.h"
+#include "engine/RenderWorker.h"
+#include "engine/SettleDetector.h"
+#include "PluginManager.h"
+#include "Tags.h"
+
+#include <atomic>
+
+#define VCP_RENDER_WORKER_TIMEOUT       20000   // 20 Seconds
+#define VCP_RENDER_WORKER_BLOCK_SIZE    512
+#define VCP_RENDER_WORKER_RING_BLOCKS   64
+#define VCP_RENDER_WORKER_MAX_RESTARTS  8
+#define VCP_RENDER_WORKER_MAX_ATTEMPTS  2
+#define VCP_RENDER_WORKER_JOB_FACTOR    4       // times the note length a job may take
+#define VCP_RENDER_WORKER_JOB_MARGIN    10000   // plus 10 seconds
+
+namespace vcp {
+
+//=============================================================================
+struct SharedAudioRing::Header
+{
+    char magic[4];          // "VCPR"
+    uint32 version;
+    int32 numChannels;
+    int32 blockSize;
+    int32 numBlocks;
+    uint32 slotSize;
+    char reserved[40];
+
+    // reader and writer positions live on their own cache lines
+    std::atomic<uint32> writeIndex;
+    char pad1[60];
+    std::atomic<uint32> readIndex;
+    char pad2[60];
+};
+
+static_assert (sizeof (std::atomic<uint32>) == 4, "unexpected atomic size");
+
+Result SharedAudioRing::create (const File& file, int numChannels, int blockSize, int numBlocks)
+{
+    close();
+    jassert (numChannels > 0 && blockSize > 0 && numBlocks > 1);
+    const size_t newSlotSize = (sizeof (Block) + sizeof (float) * (size_t) (numChannels * blockSize) + 63) & ~(size_t) 63;
+    const size_t totalSize = sizeof (Header) + newSlotSize * (size_t) numBlocks;
+
+    file.deleteFile();
+    {
+        FileOutputStream out (file);
+        if (out.failedToOpen() || ! out.writeRepeatedByte (0, totalSize))
+            return Result::fail ("could not create render buffer");
+    }
+
+    auto result = mapFile (file);
+    if (result.failed())
+        return result;
+
+    new (&header->writeIndex) std::atomic<uint32> (0);
+    new (&header->readIndex) std::atomic<uint32> (0);
+    header->version     = 1;
+    header->numChannels = numChannels;
+    header->blockSize   = blockSize;
+    header->numBlocks   = numBlocks;
+    header->slotSize    = (uint32) newSlotSize;
+    memcpy (header->magic, "VCPR", 4);
+    slotSize = newSlotSize;
+    return Result::ok();
+}
+
+Result SharedAudioRing::open (const File& file)
+{
+    close();
+    auto result = mapFile (file);
+    if (result.failed())
+        return result;
+
+    if (memcmp (header->magic, "VCPR", 4) != 0 || header->version != 1)
+    {
+        close();
+        return Result::fail ("invalid render buffer");
+    }
+
+    slotSize = header->slotSize;
+    if (sizeof (Header) + slotSize * (size_t) header->numBlocks > map->getSize())
+    {
+        close();
+        return Result::fail ("render buffer is truncated");
+    }
+
+    return Result::ok();
+}
+
+Result SharedAudioRing::mapFile (const File& file)
+{
+    map.reset (new MemoryMappedFile (file, MemoryMappedFile::readWrite, false));
+    if (map->getData() == nullptr || map->getSize() < sizeof (Header))
+    {
+        map.reset();
+        return Result::fail ("could not map render buffer");
+    }
+
+    header = static_cast<Header*> (map->getData());
+    slots  = static_cast<char*> (map->getData()) + sizeof (Header);
+    return Result::ok();
+}
+
+void SharedAudioRing::close()
+{
+    header = nullptr;
+    slots = nullptr;
+    slotSize = 0;
+    map.reset();
+}
+
+char* SharedAudioRing::getSlot (uint32 index) const
+{
+    return slots + slotSize * (size_t) (index % (uint32) header->numBlocks);
+}
+
+bool SharedAudioRing::write (int job, const float* const* data, int numChannels, int numFrames, uint32 flags)
+{
+    jassert (isOpen() && numFrames <= header->blockSize);
+    const uint32 w = header->writeIndex.load (std::memory_order_relaxed);
+    const uint32 r = header->readIndex.load (std::memory_order_acquire);
+    if (w - r >= (uint32) header->numBlocks)
+        return false;
+
+    auto* const slot  = getSlot (w);
+    auto* const block = reinterpret_cast<Block*> (slot);
+    block->job       = job;
+    block->numFrames = numFrames;
+    block->flags     = flags;
+    block->reserved  = 0;
+
+    auto* const audio = reinterpret_cast<float*> (slot + sizeof (Block));
+    for (int c = 0; c < header->numChannels; ++c)
+    {
+        auto* const dest = audio + c * header->blockSize;
+        if (c < numChannels)
+            FloatVectorOperations::copy (dest, data[c], numFrames);
+        else
+            FloatVectorOperations::clear (dest, numFrames);
+    }
+
+    header->writeIndex.store (w + 1, std::memory_order_release);
+    return true;
+}
+
+const SharedAudioRing::Block* SharedAudioRing::read() const
+{
+    if (! isOpen())
+        return nullptr;
+    const uint32 r = header->readIndex.load (std::memory_order_relaxed);
+    const uint32 w = header->writeIndex.load (std::memory_order_acquire);
+    return r != w ? reinterpret_cast<const Block*> (getSlot (r)) : nullptr;
+}
+
+const float* SharedAudioRing::getChannel (const Block& block, int channel) const
+{
+    return reinterpret_cast<const float*> (reinterpret_cast<const char*> (&block) + sizeof (Block))
+        + channel * header->blockSize;
+}
+
+void SharedAudioRing::finishedRead()
+{
+    const uint32 r = header->readIndex.load (std::memory_order_relaxed);
+    header->readIndex.store (r + 1, std::memory_order_release);
+}
+
+//=============================================================================
+/* noop. prevent OS error dialogs from child process */
+static void renderWorkerCrashHandler (void*) { }
+
+/** Hosts the plugin in the worker process. Notes are rendered faster than
+    real time on a thread of its own so the connection stays responsive */
+class RenderWorkerSlave : public kv::ChildProcessSlave,
+                          private Thread
+{
+public:
+    RenderWorkerSlave() : Thread ("vcprenderworker") { }
+    ~RenderWorkerSlave() { stopThread (5000); }
+
+    void handleConnectionMade() override
+    {
+        SystemStats::setApplicationCrashHandler (renderWorkerCrashHandler);
+        plugins.reset (new PluginManager());
+        plugins->addDefaultFormats();
+        startThread();
+    }
+
+    void handleConnectionLost() override
+    {
+        exit (0);
+    }
+
+    void handleMessageFromMaster (const MemoryBlock& mb) override
+    {
+        const auto data (mb.toString());
+        const auto type (data.upToFirstOccurrenceOf (":", false, false));
+        const auto message (data.fromFirstOccurrenceOf (":", false, false));
+
+        if (type == "quit")
+        {
+            handleConnectionLost();
+            return;
+        }
+
+        {
+            ScopedLock sl (lock);
+            if (type == "setup")
+                setup = message;
+            else if (type == "render")
+                jobs.add (message);
+        }
+
+        notify();
+    }
+
+private:
+    CriticalSection lock;
+    String setup;
+    StringArray jobs;
+
+    std::unique_ptr<PluginManager> plugins;
+    std::unique_ptr<AudioPluginInstance> plugin;
+    SharedAudioRing ring;
+    AudioSampleBuffer buffer;
+    MidiBuffer midi;
+    SettleDetector settle;
+    HeapBlock<const float*> channels;
+    double sampleRate = 44100.0;
+    int blockSize = VCP_RENDER_WORKER_BLOCK_SIZE;
+    int numChannels = 2;
+    int latency = 0;
+    int lastProgram = -1;
+
+    void send (const String& message)
+    {
+        MemoryBlock mb (message.toRawUTF8(), message.getNumBytesAsUTF8());
+        sendMessageToMaster (mb);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            String newSetup;
+            StringArray newJobs;
+            {
+                ScopedLock sl (lock);
+                newSetup.swapWith (setup);
+                newJobs.swapWith (jobs);
+            }
+
+            if (newSetup.isNotEmpty())
+            {
+                const auto result = prepare (newSetup);
+                send (result.wasOk() ? String ("ready") : String ("error:") + result.getErrorMessage());
+            }
+
+            for (const auto& job : newJobs)
+            {
+                const auto id = job.upToFirstOccurrenceOf (",", false, false);
+                const auto result = render (job);
+                send (result.wasOk() ? String ("done:") + id : String ("error:") + result.getErrorMessage());
+            }
+
+            if (newSetup.isEmpty() && newJobs.isEmpty())
+                wait (-1);
+        }
+
+        plugin.reset();
+    }
+
+    Result prepare (const String& text)
+    {
+        std::unique_ptr<XmlElement> xml (XmlDocument::parse (text));
+        const auto* const pluginXml = xml != nullptr ? xml->getChildByName ("PLUGIN") : nullptr;
+        PluginDescription description;
+        if (pluginXml == nullptr || ! description.loadFromXml (*pluginXml))
+            return Result::fail ("invalid worker setup");
+
+        sampleRate  = xml->getDoubleAttribute ("sampleRate", 44100.0);
+        blockSize   = xml->getIntAttribute ("blockSize", VCP_RENDER_WORKER_BLOCK_SIZE);
+        numChannels = xml->getIntAttribute ("channels", 2);
+
+        String error;
+        plugin.reset (plugins->getAudioPluginFormats().createPluginInstance (
+            description, sampleRate, blockSize, error));
+        if (plugin == nullptr)
+            return Result::fail (error.isNotEmpty() ? error : String ("could not load plugin"));
+
+        MemoryBlock state;
+        if (state.fromBase64Encoding (xml->getStringAttribute ("state")) && state.getSize() > 0)
+            plugin->setStateInformation (state.getData(), (int) state.getSize());
+
+        plugin->setNonRealtime (true);
+        plugin->prepareToPlay (sampleRate, blockSize);
+        latency = plugin->getLatencySamples();
+        buffer.setSize (jmax (numChannels, plugin->getTotalNumInputChannels(),
+                              plugin->getTotalNumOutputChannels()), blockSize);
+        channels.calloc ((size_t) numChannels);
+        midi.ensureSize (512);
+
+        SettleDetector::Options options;
+        options.silentTime = 250.0;
+        options.timeout = jmax (options.minimumTime, xml->getDoubleAttribute ("settle", options.timeout));
+        settle.prepare (sampleRate, options);
+        lastProgram = -1;
+
+        return ring.open (File (xml->getStringAttribute ("ring")));
+    }
+
+    void process()
+    {
+        buffer.clear();
+        plugin->processBlock (buffer, midi);
+        midi.clear();
+    }
+
+    /** Renders one note, the job is id,note,velocity,channel,program,noteFrames,tailFrames */
+    Result render (const String& job)
+    {
+        StringArray tokens;
+        tokens.addTokens (job, ",", String());
+        if (plugin == nullptr || ! ring.isOpen() || tokens.size() != 7)
+            return Result::fail ("invalid render job");
+
+        const int id            = tokens[0].getIntValue();
+        const int note          = tokens[1].getIntValue();
+        const int velocity      = tokens[2].getIntValue();
+        const int channel       = jlimit (1, 16, tokens[3].getIntValue());
+        const int program       = tokens[4].getIntValue();
+        const int64 noteFrames  = tokens[5].getLargeIntValue();
+        const int64 total       = noteFrames + tokens[6].getLargeIntValue();
+        if (total <= 0)
+            return Result::fail ("empty render job");
+
+        // wait for the program to load without capturing anything
+        if (isPositiveAndBelow (program, 127) && program != lastProgram)
+        {
+            midi.addEvent (MidiMessage::programChange (channel, program), 0);
+            settle.reset();
+            do { process(); } while (! settle.process (buffer) && ! threadShouldExit());
+            lastProgram = program;
+        }
+
+        // the note starts with the first block, the first frames of output
+        // only hold the plugin's latency and are dropped
+        const int64 last = latency + total;
+        for (int64 frame = 0; frame < last; frame += blockSize)
+        {
+            if (frame == 0)
+                midi.addEvent (MidiMessage::noteOn (channel, note, (uint8) velocity), 0);
+            if (noteFrames >= frame && noteFrames < frame + blockSize)
+                midi.addEvent (MidiMessage::noteOff (channel, note), (int) (noteFrames - frame));
+            process();
+
+            const int64 begin = jmax ((int64) latency, frame);
+            const int64 end   = jmin (last, frame + blockSize);
+            if (end <= begin)
+                continue;
+
+            for (int c = 0; c < numChannels; ++c)
+                channels[c] = buffer.getReadPointer (c, (int) (begin - frame));
+            const uint32 flags = end >= last ? SharedAudioRing::LastBlock : 0;
+            while (! ring.write (id, channels, numChannels, (int) (end - begin), flags))
+            {
+                if (threadShouldExit())
+                    return Result::fail ("render cancelled");
+                Thread::sleep (1);
+            }
+        }
+
+        return Result::ok();
+    }
+};
+
+kv::ChildProcessSlave* RenderWorkerPool::createSlave()
+{
+    return new RenderWorkerSlave();
+}
+
+//=============================================================================
+class RenderWorkerPool::Worker : public kv::ChildProcessMaster
+{
+public:
+    Worker (int workerIndex) : index (workerIndex) { }
+    ~Worker() { }
+
+    const int index;
+    SharedAudioRing ring;
+    int job = -1;
+    double deadline = 0.0;
+    int restarts = 0;
+    bool ready = false;
+    bool failed = false;
+    Atomic<int> lost { 0 };
+
+    File getRingFile() const
+    {
+        String name ("vcprw_");
+        name << Process::getCurrentProcessId() << "_" << index << ".ring";
+        return File::getSpecialLocation (File::tempDirectory).getChildFile (name);
+    }
+
+    Result launch (const XmlElement& setup, int numChannels)
+    {
+        {
+            ScopedLock sl (lock);
+            messages.clearQuick();
+        }
+
+        job = -1;
+        ready = false;
+        lost.set (0);
+
+        auto result = ring.create (getRingFile(), numChannels, VCP_RENDER_WORKER_BLOCK_SIZE,
+                                   VCP_RENDER_WORKER_RING_BLOCKS);
+        if (result.failed())
+            return result;
+
+        if (! launchSlaveProcess (File::getSpecialLocation (File::invokedExecutableFile),
+                                  VCP_RENDER_WORKER_PROCESS_ID, VCP_RENDER_WORKER_TIMEOUT, 0))
+            return Result::fail ("could not launch render worker");
+
+        XmlElement xml (setup);
+        xml.setAttribute ("ring", getRingFile().getFullPathName());
+        return send (String ("setup:") + xml.createDocument (String(), true, false))
+            ? Result::ok() : Result::fail ("could not set up render worker");
+    }
+
+    bool send (const String& message)
+    {
+        MemoryBlock mb (message.toRawUTF8(), message.getNumBytesAsUTF8());
+        return sendMessageToSlave (mb);
+    }
+
+    StringArray takeMessages()
+    {
+        StringArray result;
+        ScopedLock sl (lock);
+        result.swapWith (messages);
+        return result;
+    }
+
+    void handleMessageFromSlave (const MemoryBlock& mb) override
+    {
+        ScopedLock sl (lock);
+        messages.add (mb.toString());
+    }
+
+    void handleConnectionLost() override
+    {
+        // most likely the plugin crashed
+        lost.set (1);
+    }
+
+    void shutdown()
+    {
+        if (lost.get() == 0)
+            send ("quit");
+        ring.close();
+        getRingFile().deleteFile();
+    }
+
+private:
+    CriticalSection lock;
+    StringArray messages;
+};
+
+//=============================================================================
+/** Hands notes to the workers, writes what they stream back and restarts
+    workers which went away */
+class RenderWorkerPool::Supervisor : public Thread,
+                                     private AsyncUpdater
+{
+public:
+    Supervisor (RenderWorkerPool& p, const RenderContext& ctx, double rate)
+        : Thread ("vcprenderworkers"),
+          pool (p), context (ctx), sampleRate (rate),
+          encoder ("vcprenderworkersenc") { }
+
+    ~Supervisor()
+    {
+        stopThread (10 * 1000);
+        cancelPendingUpdate();
+    }
+
+    Result prepare (const PluginDescription& plugin, const MemoryBlock& state, int numWorkers)
+    {
+        const auto extension = FormatType::getFileExtension (FormatType::fromSlug (context.format));
+        audioFormat = pool.formats.findFormatForFileExtension (extension);
+        if (audioFormat == nullptr)
+            return Result::fail ("could not create encoder for recording");
+
+        StringPairArray cachedFiles;
+        Render::findCachedFiles (context, cachedFiles);
+        manifest = ValueTree (Tags::samples);
+
+        const auto captureDir = context.getCaptureDir();
+        if (captureDir.exists())
+            captureDir.deleteRecursively();
+        captureDir.createDirectory();
+
+        // plugins render on rig zero only
+        for (const int i : context.getLayerOrder())
+        {
+            const auto& layer = context.layers.getReference (i);
+            const int channel = context.rigs.size() > 0 && context.rigs.getReference(0).midiChannel > 0
+                ? context.rigs.getReference(0).midiChannel : layer.midiChannel;
+            std::unique_ptr<LayerRenderDetails> details (context.createLayerRenderDetails (
+                i, sampleRate, pool.formats, encoder));
+
+            for (auto* const info : details->cached)
+                if (info->rig == 0)
+                    manifest.appendChild (createEntry (*info, File (cachedFiles [info->key]), -1, -1), nullptr);
+
+            while (details->samples.size() > 0)
+            {
+                std::unique_ptr<SampleInfo> info (details->samples.removeAndReturn (0));
+                if (info->rig != 0)
+                    continue;
+                auto* const job     = jobs.add (new Job());
+                job->info.reset (info.release());
+                job->velocity       = layer.velocity;
+                job->channel        = channel;
+                job->program        = layer.midiProgram;
+                job->noteFrames     = static_cast<int64> (sampleRate * ((double) layer.noteLength / 1000.0));
+                job->tailFrames     = static_cast<int64> (sampleRate * ((double) layer.tailLength / 1000.0));
+                job->title          << "Layer " << (i + 1) << " - "
+                                    << MidiMessage::getMidiNoteName (job->info->note, true, true, 4);
+            }
+        }
+
+        for (int i = 0; i < jobs.size(); ++i)
+            queue.add (i);
+
+        setup.reset (new XmlElement ("setup"));
+        setup->setAttribute ("sampleRate", sampleRate);
+        setup->setAttribute ("blockSize", VCP_RENDER_WORKER_BLOCK_SIZE);
+        setup->setAttribute ("channels", context.channels);
+        setup->setAttribute ("settle", context.programSettle);
+        setup->setAttribute ("state", state.toBase64Encoding());
+        setup->addChildElement (plugin.createXml());
+
+        numWorkers = jlimit (1, jmax (1, jobs.size()), numWorkers);
+        for (int i = 0; i < numWorkers; ++i)
+            workers.add (new Worker (i));
+
+        return Result::ok();
+    }
+
+    void getProgress (double& value, String& title) const
+    {
+        ScopedLock sl (lock);
+        value = progressValue;
+        title = progressTitle;
+    }
+
+private:
+    struct Job
+    {
+        std::unique_ptr<SampleInfo> info;
+        int velocity        = 127;
+        int channel         = 1;
+        int program         = -1;
+        int64 noteFrames    = 0;
+        int64 tailFrames    = 0;
+        int attempts        = 0;
+        String title;
+        std::unique_ptr<CaptureWriter> writer;
+    };
+
+    RenderWorkerPool& pool;
+    RenderContext context;
+    const double sampleRate;
+    TimeSliceThread encoder;
+    AudioFormat* audioFormat = nullptr;
+    std::unique_ptr<XmlElement> setup;
+    OwnedArray<Worker> workers;
+    OwnedArray<Job> jobs;
+    Array<int> queue;
+    HeapBlock<const float*> channels;
+    ValueTree manifest;
+    int numFinished = 0;
+
+    CriticalSection lock;
+    double progressValue = 0.0;
+    String progressTitle;
+    Atomic<int> startedFlag { 0 };
+    Atomic<int> finishedFlag { 0 };
+    bool cancelled = false;
+
+    void run() override
+    {
+        channels.calloc ((size_t) context.channels);
+        for (auto* const worker : workers)
+            launch (*worker);
+
+        startedFlag.set (1);
+        triggerAsyncUpdate();
+
+        while (! threadShouldExit() && numFinished < jobs.size())
+        {
+            bool idle = true, alive = false;
+            for (auto* const worker : workers)
+            {
+                idle = service (*worker) && idle;
+                alive = alive || ! worker->failed;
+            }
+
+            if (! alive)
+            {
+                DBG("[VCP] no render workers left");
+                break;
+            }
+
+            if (idle)
+                wait (2);
+        }
+
+        cancelled = threadShouldExit() || numFinished < jobs.size();
+        for (auto* const worker : workers)
+            worker->shutdown();
+        workers.clear (true);
+        for (auto* const job : jobs)
+            discard (*job);
+
+        finish();
+        finishedFlag.set (1);
+        triggerAsyncUpdate();
+    }
+
+    void launch (Worker& worker)
+    {
+        const auto result = worker.launch (*setup, context.channels);
+        if (result.failed())
+        {
+            DBG("[VCP] " << result.getErrorMessage());
+            worker.failed = true;
+        }
+    }
+
+    /** Returns true if nothing happened */
+    bool service (Worker& worker)
+    {
+        if (worker.failed)
+            return true;
+
+        bool idle = true;
+
+        // the last block of a note completes it
+        while (const auto* block = worker.ring.read())
+        {
+            idle = false;
+            write (worker, *block);
+            worker.ring.finishedRead();
+        }
+
+        for (const auto& message : worker.takeMessages())
+        {
+            idle = false;
+            const auto type (message.upToFirstOccurrenceOf (":", false, false));
+            if (type == "ready")
+            {
+                worker.ready = true;
+            }
+            else if (type == "error")
+            {
+                DBG("[VCP] render worker " << worker.index << ": "
+                    << message.fromFirstOccurrenceOf (":", false, false));
+                if (! worker.ready)
+                    worker.failed = true; // the plugin can't be loaded
+                else if (worker.job >= 0)
+                    requeue (worker);
+            }
+        }
+
+        // a plugin hanging in processBlock doesn't drop the connection
+        if (worker.job >= 0 && worker.lost.get() == 0
+            && Time::getMillisecondCounterHiRes() > worker.deadline)
+        {
+            DBG("[VCP] render worker " << worker.index << " stopped responding");
+            worker.killSlaveProcess();
+            worker.lost.set (1);
+        }
+
+        if (worker.lost.get() != 0 && ! worker.failed)
+        {
+            idle = false;
+            if (worker.job >= 0)
+                requeue (worker);
+            if (++worker.restarts > VCP_RENDER_WORKER_MAX_RESTARTS)
+                worker.failed = true;
+            else
+                launch (worker);
+        }
+        else if (worker.ready && worker.job < 0 && ! queue.isEmpty())
+        {
+            idle = false;
+            const int index = queue.removeAndReturn (0);
+            const auto& job = *jobs.getUnchecked (index);
+            String message ("render:");
+            message << index << "," << job.info->note << "," << job.velocity << ","
+                    << job.channel << "," << job.program << ","
+                    << job.noteFrames << "," << job.tailFrames;
+            worker.job = index;
+            worker.deadline = Time::getMillisecondCounterHiRes() + context.programSettle
+                + VCP_RENDER_WORKER_JOB_MARGIN + VCP_RENDER_WORKER_JOB_FACTOR * 1000.0
+                    * static_cast<double> (job.noteFrames + job.tailFrames) / sampleRate;
+            setProgress (job.title);
+            if (! worker.send (message))
+                worker.lost.set (1);
+        }
+
+        return idle;
+    }
+
+    void write (Worker& worker, const SharedAudioRing::Block& block)
+    {
+        if (block.job != worker.job || ! isPositiveAndBelow (block.job, jobs.size()))
+            return;
+
+        auto& job = *jobs.getUnchecked (block.job);
+        if (job.writer == nullptr && ! open (job))
+        {
+            worker.job = -1;
+            ++numFinished;
+            return;
+        }
+
+        for (int c = 0; c < context.channels; ++c)
+            channels[c] = worker.ring.getChannel (block, c);
+        job.writer->writeFromFloatArrays (channels, context.channels, block.numFrames);
+
+        if ((block.flags & SharedAudioRing::LastBlock) != 0)
+        {
+            complete (job);
+            worker.job = -1;
+            ++numFinished;
+        }
+    }
+
+    bool open (Job& job)
+    {
+        auto& info = *job.info;
+        info.file.deleteFile();
+        std::unique_ptr<FileOutputStream> stream (info.file.createOutputStream());
+        if (stream == nullptr || stream->failedToOpen())
+            return false;
+
+        const bool compressed = FormatType::fromSlug (context.format) == FormatType::FLAC;
+        auto* const writer = audioFormat->createWriterFor (stream.get(), sampleRate,
+            (unsigned int) context.channels, context.bitDepth, StringPairArray(), compressed ? 5 : 0);
+        if (writer == nullptr)
+            return false;
+        stream.release();
+
+        job.writer.reset (new CaptureWriter (writer, sampleRate));
+        job.writer->setDither (context.dither);
+        if (context.trimThreshold < 0.f)
+        {
+            info.trim = std::make_shared<TrimDetector>();
+            info.trim->prepare (context.trimThreshold, context.trimThreshold - 12.f);
+            job.writer->setTrimDetector (info.trim);
+        }
+
+        return true;
+    }
+
+    /** Closes the file and moves it next to the other samples */
+    void complete (Job& job)
+    {
+        job.writer.reset();
+        auto& info = *job.info;
+        const auto target = context.getSamplesDir().getChildFile (info.file.getFileName());
+        context.getSamplesDir().createDirectory();
+        if (! info.file.moveFileTo (target))
+        {
+            info.file.copyFileTo (target);
+            info.file.deleteFile();
+        }
+
+        int64 trimStart = -1, trimEnd = -1;
+        if (info.trim != nullptr && info.trim->isEnabled() && info.trim->getLength() > 0)
+        {
+            trimStart = info.trim->getStartFrame();
+            trimEnd   = info.trim->getEndFrame();
+        }
+
+        manifest.appendChild (createEntry (info, target, trimStart, trimEnd), nullptr);
+    }
+
+    /** Drops a partly written note */
+    void discard (Job& job)
+    {
+        if (job.writer == nullptr)
+            return;
+        job.writer.reset();
+        job.info->file.deleteFile();
+    }
+
+    void requeue (Worker& worker)
+    {
+        auto& job = *jobs.getUnchecked (worker.job);
+        discard (job);
+        if (++job.attempts < VCP_RENDER_WORKER_MAX_ATTEMPTS)
+        {
+            queue.insert (0, worker.job);
+            ++pool.numRequeued;
+            DBG("[VCP] requeued " << job.title);
+        }
+        else
+        {
+            ++numFinished;
+            DBG("[VCP] giving up on " << job.title);
+        }
+
+        worker.job = -1;
+    }
+
+    ValueTree createEntry (const SampleInfo& info, const File& file, int64 trimStart, int64 trimEnd) const
+    {
+        const auto totalTime = static_cast<double> (info.stop - info.start) / sampleRate;
+        ValueTree sample (Tags::sample);
+        sample.setProperty (Tags::uuid, Uuid().toString(), nullptr)
+              .setProperty (Tags::set, info.layerId.toString(), nullptr)
+              .setProperty (Tags::rig, info.rigId, nullptr)
+              .setProperty (Tags::file, file.getFileName(), nullptr)
+              .setProperty (Tags::note, info.note, nullptr)
+              .setProperty (Tags::sampleRate, sampleRate, nullptr)
+              .setProperty (Tags::channels, context.channels, nullptr)
+              .setProperty (Tags::length, totalTime, nullptr)
+              .setProperty (Tags::timeIn, 0.0, nullptr)
+              .setProperty (Tags::timeOut, totalTime, nullptr);
+        if (trimStart >= 0 && trimEnd > trimStart)
+            sample.setProperty (Tags::timeIn, static_cast<double> (trimStart) / sampleRate, nullptr)
+                  .setProperty (Tags::timeOut, static_cast<double> (trimEnd) / sampleRate, nullptr)
+                  .setProperty (Tags::trimmed, true, nullptr);
+        return sample;
+    }
+
+    void finish()
+    {
+        const auto captureDir = context.getCaptureDir();
+        captureDir.deleteRecursively();
+        if (cancelled)
+            return;
+
+        // same as Render, files no longer referenced are removed
+        StringArray used;
+        for (int i = 0; i < manifest.getNumChildren(); ++i)
+            used.add (manifest.getChild(i).getProperty (Tags::file).toString());
+        for (DirectoryIterator iter (context.getSamplesDir(), false, "*", File::findFiles); iter.next();)
+            if (! used.contains (iter.getFile().getFileName()))
+                iter.getFile().deleteFile();
+    }
+
+    void setProgress (const String& title)
+    {
+        {
+            ScopedLock sl (lock);
+            progressValue = static_cast<double> (numFinished) / static_cast<double> (jmax (1, jobs.size()));
+            progressTitle = title;
+        }
+        triggerAsyncUpdate();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        if (startedFlag.compareAndSetBool (0, 1) && pool.onStarted)
+            pool.onStarted();
+
+        if (finishedFlag.compareAndSetBool (0, 1))
+        {
+            pool.finished (cancelled ? ValueTree (Tags::samples) : manifest, cancelled);
+            return;
+        }
+
+        double value;
+        String title;
+        getProgress (value, title);
+        if (pool.onProgress)
+            pool.onProgress (value, title);
+    }
+};
+
+//=============================================================================
+RenderWorkerPool::RenderWorkerPool (AudioFormatManager& f)
+    : formats (f) { }
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    supervisor.reset();
+}
+
+Result RenderWorkerPool::start (const RenderContext& context, const PluginDescription& plugin,
+                                const MemoryBlock& state, double fallbackRate)
+{
+    if (isRendering())
+        return Result::fail ("recording already in progress");
+
+    const double rate = context.sampleRate > 0.0 ? context.sampleRate : fallbackRate;
+    if (rate <= 0.0)
+        return Result::fail ("no sample rate for rendering");
+
+    const int numWorkers = context.workers > 0 ? context.workers
+        : jmax (1, SystemStats::getNumCpus() - 1);
+
+    supervisor.reset();
+    std::unique_ptr<Supervisor> newSupervisor (new Supervisor (*this, context, rate));
+    const auto result = newSupervisor->prepare (plugin, state, numWorkers);
+    if (result.failed())
+        return result;
+
+    samples = ValueTree();
+    numRequeued.set (0);
+    rendering.set (1);
+    supervisor.swap (newSupervisor);
+    supervisor->startThread();
+    return Result::ok();
+}
+
+void RenderWorkerPool::cancel()
+{
+    if (supervisor != nullptr)
+        supervisor->signalThreadShouldExit();
+}
+
+void RenderWorkerPool::finished (const ValueTree& manifest, bool wasCancelled)
+{
+    samples = manifest;
+    rendering.set (0);
+    DBG("[VCP] render workers finished, " << numRequeued.get() << " note(s) requeued");
+
+    if (wasCancelled)
+    {
+        if (onCancelled)
+            onCancelled();
+    }
+    else if (onStopped)
+    {
+        onStopped();
+    }
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "engine/RenderContext.h"
+
+#define VCP_RENDER_WORKER_PROCESS_ID "vcprw"
+
+namespace vcp {
+
+//=============================================================================
+/** Single producer, single consumer queue of audio blocks in a memory mapped
+    file. A render worker process fills it and the master reads the blocks
+    in place */
+class SharedAudioRing
+{
+public:
+    enum Flags
+    {
+        LastBlock = 1 << 0
+    };
+
+    struct Block
+    {
+        int32 job;
+        int32 numFrames;
+        uint32 flags;
+        int32 reserved;
+    };
+
+    SharedAudioRing() = default;
+    ~SharedAudioRing() = default;
+
+    /** Creates the file and maps it, used by the reading side */
+    Result create (const File& file, int numChannels, int blockSize, int numBlocks);
+
+    /** Maps a ring created by the other side */
+    Result open (const File& file);
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+    int getNumChannels() const  { return header != nullptr ? header->numChannels : 0; }
+    int getBlockSize() const    { return header != nullptr ? header->blockSize : 0; }
+
+    /** Copies a block into the ring. Returns false when it is full */
+    bool write (int job, const float* const* data, int numChannels, int numFrames, uint32 flags);
+
+    /** Returns the oldest block or nullptr when empty. Channel data follows
+        the block, see getChannel(). Call finishedRead() once done */
+    const Block* read() const;
+    const float* getChannel (const Block& block, int channel) const;
+    void finishedRead();
+
+private:
+    struct Header;
+    std::unique_ptr<MemoryMappedFile> map;
+    Header* header = nullptr;
+    char* slots = nullptr;
+    size_t slotSize = 0;
+
+    Result mapFile (const File& file);
+    char* getSlot (uint32 index) const;
+};
+
+//=============================================================================
+/** Renders notes of an audio plugin in worker processes. Each worker hosts
+    its own plugin instance and streams rendered audio back through a
+    SharedAudioRing. A crashed worker is restarted and only the note it was
+    rendering gets queued again */
+class RenderWorkerPool
+{
+public:
+    RenderWorkerPool (AudioFormatManager& formats);
+    ~RenderWorkerPool();
+
+    /** Starts rendering all layers of the context with the given plugin.
+        The audio is rendered at the context's rate or the fallback rate
+        when not set */
+    Result start (const RenderContext& context, const PluginDescription& plugin,
+                  const MemoryBlock& state, double fallbackRate);
+    void cancel();
+
+    bool isRendering() const { return rendering.get() != 0; }
+
+    /** Returns sample metadata after rendering has completed */
+    ValueTree getSamples() const { return samples; }
+
+    /** Returns the number of notes restarted after a worker crashed */
+    int getNumRequeued() const { return numRequeued.get(); }
+
+    /** Creates the slave side of a worker, see VCP_RENDER_WORKER_PROCESS_ID */
+    static kv::ChildProcessSlave* createSlave();
+
+    std::function<void()> onStarted;
+    std::function<void()> onStopped;
+    std::function<void()> onCancelled;
+    std::function<void(double, const String&)> onProgress;
+
+private:
+    class Worker;
+    class Supervisor;
+    AudioFormatManager& formats;
+    std::unique_ptr<Supervisor> supervisor;
+    Atomic<int> rendering { 0 };
+    Atomic<int> numRequeued { 0 };
+    ValueTree samples;
+
+    void finished (const ValueTree& manifest, bool wasCancelled);
+
+    JUCE_DECLARE_NON_COPYABLE (RenderWorkerPool)
+};
+
+}
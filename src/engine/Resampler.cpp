@@ -0,0 +1,160 @@
+
+#include "engine/Resampler.h"
+
+namespace vcp {
+
+static double besselI0 (double x)
+{
+    double sum = 1.0, term = 1.0;
+    const double halfX = 0.5 * x;
+    for (int k = 1; k < 50; ++k)
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1.0e-12)
+            break;
+    }
+    return sum;
+}
+
+void Resampler::prepare (int newNumChannels, double newSourceRate, double newTargetRate,
+                         int zeroCrossings)
+{
+    jassert (newNumChannels > 0 && newSourceRate > 0.0 && newTargetRate > 0.0);
+    numChannels = jmax (1, newNumChannels);
+    sourceRate  = newSourceRate;
+    targetRate  = newTargetRate;
+    step        = sourceRate / targetRate;
+
+    // band limit to just under the lower of the two nyquist frequencies
+    cutoff      = 0.95 * jmin (1.0, targetRate / sourceRate);
+    halfWidth   = static_cast<int> (std::ceil (jmax (4, zeroCrossings) / cutoff));
+    tableSize   = halfWidth * tableResolution + 2;
+    table.allocate ((size_t) tableSize, true);
+    weights.allocate ((size_t) (2 * halfWidth), true);
+
+    const double beta = 9.0;
+    const double norm = 1.0 / besselI0 (beta);
+    for (int i = 0; i < tableSize; ++i)
+    {
+        const double distance = static_cast<double> (i) / tableResolution;
+        const double x = distance / halfWidth;
+        if (x >= 1.0)
+            break;
+        const double arg = MathConstants<double>::pi * cutoff * distance;
+        const double sinc = distance == 0.0 ? 1.0 : std::sin (arg) / arg;
+        const double window = besselI0 (beta * std::sqrt (1.0 - x * x)) * norm;
+        table[i] = static_cast<float> (cutoff * sinc * window);
+    }
+
+    pending.setSize (numChannels, 4 * halfWidth + 8192, false, true, false);
+    reset();
+}
+
+void Resampler::reset()
+{
+    pending.clear();
+    numPending  = halfWidth;
+    position    = static_cast<double> (halfWidth);
+    totalIn     = 0;
+    totalOut    = 0;
+}
+
+int Resampler::getMaxOutputFrames (int numInputFrames) const
+{
+    return static_cast<int> (std::ceil (numInputFrames / step)) + 2;
+}
+
+int Resampler::process (const float* const* input, int numFrames, float* const* output)
+{
+    append (input, numFrames);
+    totalIn += numFrames;
+    const int produced = produce (output, getMaxOutputFrames (numFrames), 0);
+    totalOut += produced;
+    return produced;
+}
+
+int Resampler::flush (float* const* output, int maxFrames)
+{
+    const auto expected = static_cast<int64> (std::ceil (totalIn / step));
+    const int remaining = static_cast<int> (jmin ((int64) maxFrames, jmax ((int64) 0, expected - totalOut)));
+    if (remaining <= 0)
+        return 0;
+
+    append (nullptr, 2 * halfWidth + static_cast<int> (std::ceil (remaining * step)));
+    const int produced = produce (output, remaining, 0);
+    totalOut += produced;
+    return produced;
+}
+
+void Resampler::append (const float* const* input, int numFrames)
+{
+    if (numPending + numFrames > pending.getNumSamples())
+        pending.setSize (numChannels, numPending + numFrames + 4096, true, true, false);
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        if (input != nullptr)
+            pending.copyFrom (c, numPending, input[c], numFrames);
+        else
+            pending.clear (c, numPending, numFrames);
+    }
+
+    numPending += numFrames;
+}
+
+float Resampler::kernel (double distance) const
+{
+    const double index = std::abs (distance) * tableResolution;
+    const int i = static_cast<int> (index);
+    if (i >= tableSize - 1)
+        return 0.f;
+    const float alpha = static_cast<float> (index - i);
+    return table[i] + alpha * (table[i + 1] - table[i]);
+}
+
+int Resampler::produce (float* const* output, int maxFrames, int offset)
+{
+    const int width = 2 * halfWidth;
+    int n = 0;
+
+    while (n < maxFrames)
+    {
+        const int centre = static_cast<int> (position);
+        if (centre + halfWidth >= numPending)
+            break;
+
+        const int first = centre - halfWidth + 1;
+        for (int k = 0; k < width; ++k)
+            weights[k] = kernel (position - (first + k));
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            const float* const src = pending.getReadPointer (c, first);
+            float sum = 0.f;
+            for (int k = 0; k < width; ++k)
+                sum += src[k] * weights[k];
+            output[c][offset + n] = sum;
+        }
+
+        ++n;
+        position += step;
+    }
+
+    // drop input that no longer contributes to the next output
+    const int consumed = static_cast<int> (position) - halfWidth + 1;
+    if (consumed > 0)
+    {
+        const int keep = numPending - consumed;
+        for (int c = 0; c < numChannels; ++c)
+            if (keep > 0)
+                memmove (pending.getWritePointer (c), pending.getReadPointer (c, consumed),
+                         sizeof (float) * (size_t) keep);
+        numPending = jmax (0, keep);
+        position -= consumed;
+    }
+
+    return n;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** A streaming windowed-sinc sample rate converter. State is kept between
+    calls to process so audio can be fed in blocks of any size. */
+class Resampler
+{
+public:
+    Resampler() = default;
+    ~Resampler() = default;
+
+    /** Prepares for conversion. zeroCrossings sets the quality, the kernel
+        spans this many zero crossings either side of each output sample */
+    void prepare (int numChannels, double sourceRate, double targetRate,
+                  int zeroCrossings = 32);
+
+    /** Clears stored history, keeping the current settings */
+    void reset();
+
+    /** Returns the maximum number of output frames process can produce from
+        the given number of input frames */
+    int getMaxOutputFrames (int numInputFrames) const;
+
+    /** Converts numFrames of input and writes the result to output, which
+        should have room for getMaxOutputFrames (numFrames). Returns the
+        number of frames written */
+    int process (const float* const* input, int numFrames, float* const* output);
+
+    /** Drains the remaining output once all input has been given. Returns
+        the number of frames written */
+    int flush (float* const* output, int maxFrames);
+
+    double getSourceRate() const { return sourceRate; }
+    double getTargetRate() const { return targetRate; }
+
+private:
+    int numChannels = 0;
+    double sourceRate = 0.0;
+    double targetRate = 0.0;
+    double step = 1.0;          // input frames per output frame
+    double cutoff = 1.0;
+    int halfWidth = 0;          // kernel half width in input frames
+    int tableResolution = 512;
+    HeapBlock<float> table;
+    int tableSize = 0;
+    HeapBlock<float> weights;
+
+    AudioSampleBuffer pending;
+    int numPending = 0;
+    double position = 0.0;
+    int64 totalIn = 0;
+    int64 totalOut = 0;
+
+    void append (const float* const* input, int numFrames);
+    int produce (float* const* output, int maxFrames, int offset);
+    float kernel (double distance) const;
+};
+
+}
@@ -0,0 +1,149 @@
+#include "engine/SampleConverter.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+namespace vcp {
+
+namespace {
+
+inline uint32 nextRandom (uint32& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/** Uniform in [0, 1) from the top bits of a random value */
+inline float toUnitFloat (uint32 value)
+{
+    return static_cast<float> (value >> 8) * (1.f / 16777216.f);
+}
+
+}
+
+void SampleConverter::prepare (int newNumChannels, int newBitDepth, int newDither)
+{
+    jassert (newBitDepth == 16 || newBitDepth == 24 || newBitDepth == 32);
+    numChannels = newNumChannels;
+    bitDepth    = newBitDepth;
+    dither      = bitDepth < 32 ? newDither : NoDither;
+    scale       = static_cast<float> (1 << (bitDepth - 1));
+    if (bitDepth == 32)
+        scale = 2147483648.f;
+
+    seeds.malloc ((size_t) numChannels * 4);
+    for (int i = 0; i < numChannels * 4; ++i)
+        seeds[i] = 0x9e3779b9u * static_cast<uint32> (i + 1);
+    errors.calloc ((size_t) numChannels * 2);
+}
+
+void SampleConverter::convert (const float* const* input, int* const* output,
+                               int numFrames, float gain)
+{
+    for (int c = 0; c < numChannels; ++c)
+        convertChannel (c, input[c], output[c], numFrames, gain);
+}
+
+void SampleConverter::convertChannel (int channel, const float* input, int* output,
+                                      int numFrames, float gain)
+{
+    const float factor  = gain * scale;
+    const float lowest  = -scale;
+    const float highest = bitDepth == 32 ? 2147483520.f : scale - 1.f;
+    const int shift     = 32 - bitDepth;
+    auto* const lanes   = seeds.get() + channel * 4;
+    int i = 0;
+
+    if (dither == ShapedDither)
+    {
+        // error feedback is sequential, e[n] filtered by (1 - z^-1)^2
+        float& e1 = errors [channel * 2];
+        float& e2 = errors [channel * 2 + 1];
+        for (; i < numFrames; ++i)
+        {
+            const float tpdf  = toUnitFloat (nextRandom (lanes[0])) - toUnitFloat (nextRandom (lanes[1]));
+            const float value = input[i] * factor - (2.f * e1 - e2);
+            const float quantized = jlimit (lowest, highest, std::nearbyint (value + tpdf));
+            e2 = e1;
+            e1 = quantized - value;
+            output[i] = static_cast<int> (quantized) * (1 << shift);
+        }
+
+        return;
+    }
+
+   #if JUCE_INTEL
+    const __m128 vfactor  = _mm_set1_ps (factor);
+    const __m128 vlowest  = _mm_set1_ps (lowest);
+    const __m128 vhighest = _mm_set1_ps (highest);
+    const __m128 vunit    = _mm_set1_ps (1.f / 16777216.f);
+    __m128i state = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (lanes));
+
+    auto random = [&state]() -> __m128
+    {
+        state = _mm_xor_si128 (state, _mm_slli_epi32 (state, 13));
+        state = _mm_xor_si128 (state, _mm_srli_epi32 (state, 17));
+        state = _mm_xor_si128 (state, _mm_slli_epi32 (state, 5));
+        return _mm_cvtepi32_ps (_mm_srli_epi32 (state, 8));
+    };
+
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        __m128 value = _mm_mul_ps (_mm_loadu_ps (input + i), vfactor);
+        if (dither == TriangularDither)
+        {
+            const __m128 a = random(), b = random();
+            value = _mm_add_ps (value, _mm_mul_ps (_mm_sub_ps (a, b), vunit));
+        }
+
+        value = _mm_min_ps (_mm_max_ps (value, vlowest), vhighest);
+        __m128i result = _mm_cvtps_epi32 (value);
+        if (shift > 0)
+            result = _mm_slli_epi32 (result, shift);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (output + i), result);
+    }
+
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (lanes), state);
+   #endif
+
+    for (; i < numFrames; ++i)
+    {
+        float value = input[i] * factor;
+        if (dither == TriangularDither)
+            value += toUnitFloat (nextRandom (lanes[0])) - toUnitFloat (nextRandom (lanes[1]));
+        value = jlimit (lowest, highest, value);
+        output[i] = static_cast<int> (std::nearbyint (value)) * (1 << shift);
+    }
+}
+
+void SampleConverter::convertInterleaved (const float* const* input, void* output,
+                                          int numFrames, float gain)
+{
+    if (scratch.get() == nullptr || numFrames > scratchSize)
+    {
+        scratch.malloc ((size_t) numFrames);
+        scratchSize = numFrames;
+    }
+
+    const int bytes = bitDepth / 8;
+    const int shift = 32 - bitDepth;
+    auto* const dest = static_cast<uint8*> (output);
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        convertChannel (c, input[c], scratch, numFrames, gain);
+        auto* out = dest + c * bytes;
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto value = static_cast<uint32> (scratch[i] >> shift);
+            for (int b = 0; b < bytes; ++b)
+                out[b] = static_cast<uint8> (value >> (8 * b));
+            out += numChannels * bytes;
+        }
+    }
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Converts float audio to integer samples for file writers. Quantization
+    to the target bit depth happens here, optionally with TPDF dither and
+    noise shaping, so the writer's own conversion only drops zero bits.
+    The inner loops use SSE2 on Intel with a scalar fallback elsewhere. */
+class SampleConverter
+{
+public:
+    enum Dither
+    {
+        NoDither = 0,
+        TriangularDither,       // TPDF, +/- 1 LSB
+        ShapedDither            // TPDF with second order error feedback
+    };
+
+    SampleConverter() = default;
+    ~SampleConverter() = default;
+
+    /** Prepares for conversion, bitDepth can be 16, 24 or 32 */
+    void prepare (int numChannels, int bitDepth, int dither);
+
+    int getBitDepth() const { return bitDepth; }
+
+    /** Converts non-interleaved floats to left justified 32 bit integers as
+        expected by AudioFormatWriter::write. Gain is applied in the same
+        pass */
+    void convert (const float* const* input, int* const* output,
+                  int numFrames, float gain = 1.f);
+
+    /** Converts and interleaves into packed little endian integers of the
+        prepared bit depth, e.g. 3 bytes per sample for 24 bits */
+    void convertInterleaved (const float* const* input, void* output,
+                             int numFrames, float gain = 1.f);
+
+private:
+    int numChannels = 0;
+    int bitDepth    = 16;
+    int dither      = NoDither;
+    float scale     = 32768.f;
+    HeapBlock<uint32> seeds;    // four per channel, one per lane
+    HeapBlock<float> errors;    // two per channel for noise shaping
+    HeapBlock<int> scratch;
+    int scratchSize = 0;
+
+    void convertChannel (int channel, const float* input, int* output,
+                         int numFrames, float gain);
+};
+
+}
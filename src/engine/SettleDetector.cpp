@@ -0,0 +1,81 @@
+#include "engine/SettleDetector.h"
+
+namespace vcp {
+
+void SettleDetector::prepare (double newSampleRate, const Options& newOptions)
+{
+    jassert (newSampleRate > 0.0);
+    options         = newOptions;
+    sampleRate      = newSampleRate;
+    minimumFrames   = static_cast<int64> (sampleRate * options.minimumTime * 0.001);
+    silentFrames    = static_cast<int64> (sampleRate * options.silentTime * 0.001);
+    timeoutFrames   = static_cast<int64> (sampleRate * options.timeout * 0.001);
+    windowFrames    = jmax (1, roundToInt (sampleRate * options.windowLength * 0.001));
+    reset();
+}
+
+void SettleDetector::reset()
+{
+    elapsed     = 0;
+    windowPos   = 0;
+    windowSum   = 0.0;
+    lastLevel   = -200.f;
+    numStable   = 0;
+    silent      = true;
+    settled     = false;
+}
+
+double SettleDetector::getElapsedTime() const
+{
+    return 1000.0 * static_cast<double> (elapsed) / sampleRate;
+}
+
+bool SettleDetector::process (const AudioSampleBuffer& audio)
+{
+    if (settled)
+        return true;
+
+    const int numChannels = audio.getNumChannels();
+    const int numFrames   = audio.getNumSamples();
+
+    for (int i = 0; i < numFrames;)
+    {
+        const int todo = jmin (numFrames - i, windowFrames - windowPos);
+        for (int c = 0; c < numChannels; ++c)
+        {
+            const auto* const data = audio.getReadPointer (c, i);
+            for (int f = 0; f < todo; ++f)
+                windowSum += static_cast<double> (data[f]) * data[f];
+        }
+
+        i += todo;
+        windowPos += todo;
+        if (windowPos >= windowFrames)
+            finishWindow (numChannels);
+    }
+
+    elapsed += numFrames;
+    const int64 needed = silent ? jmax (minimumFrames, silentFrames) : minimumFrames;
+    if ((elapsed >= needed && numStable >= options.stableWindows) || elapsed >= timeoutFrames)
+        settled = true;
+
+    return settled;
+}
+
+void SettleDetector::finishWindow (int numChannels)
+{
+    const double meanSquare = windowSum / static_cast<double> (windowFrames * jmax (1, numChannels));
+    const float level = Decibels::gainToDecibels (static_cast<float> (std::sqrt (meanSquare)), -200.f);
+
+    silent = level < options.silence;
+    if (silent || std::abs (level - lastLevel) <= options.tolerance)
+        ++numStable;
+    else
+        numStable = 0;
+
+    lastLevel = level;
+    windowPos = 0;
+    windowSum = 0.0;
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Watches the output of a source after a program change and decides when
+    it has settled, i.e. when its level is steady or silent. Nothing plays
+    while waiting, so silence only counts once the source had the silent
+    time to load its patch. Safe to use on the audio thread. */
+class SettleDetector
+{
+public:
+    struct Options
+    {
+        double minimumTime  = 50.0;     // milliseconds to wait at least
+        double silentTime   = 1000.0;   // milliseconds to wait at least while silent
+        double timeout      = 3000.0;   // milliseconds to wait at most
+        double windowLength = 20.0;     // milliseconds per level measurement
+        int stableWindows   = 5;        // consecutive steady windows needed
+        float silence       = -70.f;    // dB, anything below counts as steady
+        float tolerance     = 1.f;      // dB change between steady windows
+    };
+
+    SettleDetector() = default;
+    ~SettleDetector() = default;
+
+    void prepare (double sampleRate, const Options& options);
+
+    /** Starts a new measurement */
+    void reset();
+
+    /** Feeds a block of audio. Returns true once the source has settled or
+        the timeout passed */
+    bool process (const AudioSampleBuffer& audio);
+
+    bool isSettled() const { return settled; }
+
+    /** Returns the time waited so far in milliseconds */
+    double getElapsedTime() const;
+
+private:
+    Options options;
+    double sampleRate = 44100.0;
+    int64 minimumFrames = 0;
+    int64 silentFrames = 0;
+    int64 timeoutFrames = 0;
+    int windowFrames = 0;
+
+    int64 elapsed = 0;
+    int windowPos = 0;
+    double windowSum = 0.0;
+    float lastLevel = -200.f;
+    int numStable = 0;
+    bool silent = true;
+    bool settled = false;
+
+    void finishWindow (int numChannels);
+};
+
+}
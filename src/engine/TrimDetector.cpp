@@ -0,0 +1,71 @@
+#include "engine/TrimDetector.h"
+
+namespace vcp {
+
+void TrimDetector::prepare (float onsetThreshold, float silenceThreshold)
+{
+    onsetGain   = Decibels::decibelsToGain (onsetThreshold);
+    silenceGain = Decibels::decibelsToGain (jmin (onsetThreshold, silenceThreshold));
+    length      = 0;
+    onset       = -1;
+    lastZero    = 0;
+    lastAudible = -1;
+    endZero     = -1;
+    lastValue   = 0.f;
+    enabled     = true;
+}
+
+void TrimDetector::process (const float* const* data, int numChannels, int numFrames)
+{
+    if (! enabled || numChannels <= 0)
+        return;
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        // zero crossings are taken from the mix, peaks from any channel
+        float sum = 0.f, peak = 0.f;
+        for (int c = 0; c < numChannels; ++c)
+        {
+            sum += data[c][i];
+            peak = jmax (peak, std::abs (data[c][i]));
+        }
+
+        const int64 frame = length + i;
+        const bool crossed = (sum >= 0.f) != (lastValue >= 0.f) || sum == 0.f;
+        lastValue = sum;
+
+        if (onset < 0)
+        {
+            if (crossed)
+                lastZero = frame;
+            if (peak >= onsetGain)
+                onset = frame;
+        }
+
+        if (peak >= silenceGain)
+        {
+            lastAudible = frame;
+            endZero = -1;
+        }
+        else if (crossed && endZero < 0 && lastAudible >= 0)
+        {
+            endZero = frame;
+        }
+    }
+
+    length += numFrames;
+}
+
+int64 TrimDetector::getStartFrame() const
+{
+    return onset >= 0 ? jmin (lastZero, onset) : 0;
+}
+
+int64 TrimDetector::getEndFrame() const
+{
+    if (onset < 0 || lastAudible < 0)
+        return length;
+    return endZero >= 0 ? jmin (length, endZero + 1) : length;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Finds where a captured note starts and where it has decayed to silence
+    while the audio streams through. Start and end are moved to the nearest
+    zero crossing, the start to the one just before the onset, the end to
+    the first one after the last audible frame. */
+class TrimDetector
+{
+public:
+    TrimDetector() = default;
+    ~TrimDetector() = default;
+
+    /** Prepares for a new capture. Audio above onsetThreshold (dB) marks the
+        start, the end is where it last rose above silenceThreshold (dB) */
+    void prepare (float onsetThreshold, float silenceThreshold);
+
+    /** Returns true if prepare was called */
+    bool isEnabled() const { return enabled; }
+
+    /** Feeds the next block of audio */
+    void process (const float* const* data, int numChannels, int numFrames);
+
+    /** Returns the first frame to keep */
+    int64 getStartFrame() const;
+
+    /** Returns the frame after the last one to keep */
+    int64 getEndFrame() const;
+
+    /** Returns the total number of frames seen */
+    int64 getLength() const { return length; }
+
+private:
+    bool enabled = false;
+    float onsetGain = 0.f;
+    float silenceGain = 0.f;
+
+    int64 length = 0;
+    int64 onset = -1;
+    int64 lastZero = 0;
+    int64 lastAudible = -1;
+    int64 endZero = -1;
+    float lastValue = 0.f;
+};
+
+}
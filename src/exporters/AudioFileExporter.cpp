@@ -5,6 +5,47 @@
 
 namespace vcp {
 
+/** Loudest analyzed level of a group of samples, used to normalize */
+struct NormalizeLevel
+{
+    NormalizeLevel (bool useLoudness) : loudness (useLoudness) {}
+
+    /** True if the analysis belongs to the file as it is on disk now */
+    static bool isAnalyzed (const Sample& sample)
+    {
+        return sample.hasProperty (Tags::analyzed)
+            && (int64) sample.getProperty (Tags::analyzed, 0)
+                == sample.getFile().getLastModificationTime().toMilliseconds();
+    }
+
+    void add (const Sample& sample)
+    {
+        if (! isAnalyzed (sample))
+        {
+            ++numStale;
+            return;
+        }
+
+        level = jmax (level, (float) sample.getProperty (loudness ? Tags::loudness : Tags::peak));
+        peak  = jmax (peak,  (float) sample.getProperty (Tags::peak));
+        ++count;
+    }
+
+    /** Returns the gain in dB bringing the level to target, peaks are
+        never pushed above full scale. Without a current analysis of every
+        sample the peak isn't known, so nothing is changed */
+    float getGain (float target) const
+    {
+        return count > 0 && numStale == 0 ? jmin (target - level, -peak) : 0.f;
+    }
+
+    const bool loudness;
+    float level = -200.f;
+    float peak  = -200.f;
+    int count   = 0;
+    int numStale = 0;
+};
+
 class AudioFileExporterType : public ExporterType
 {
 public:
@@ -87,23 +128,50 @@ public:
         }
         props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::bitDepth),
             "Bit Depth", choices, values));        
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::dither),
+            "Dither", { "Off", "TPDF", "TPDF + Shaping" }, { 0, 1, 2 }));
+
+        //=====================================================================
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::normalize),
+            "Normalize", { "Off", "Per Sample", "Per Layer", "Instrument" },
+                         { "none", "sample", "layer", "instrument" }));
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::normalizeMode),
+            "Normalize To", { "Peak", "Loudness" }, { "peak", "loudness" }));
+        props.add (new SliderPropertyComponent (expref.getPropertyAsValue (Tags::normalizeTarget),
+            "Target (dB/LUFS)", -40.0, 0.0, 0.1));
     }
 
     void getTasks (const Project& project, const Exporter& exporter,
                    OwnedArray<ExportTask>& tasks) const override
     {
         OwnedArray<Sample> samples;
+        const LoopType loopType (LoopType::fromSlug (exporter.getProperty (Tags::loop).toString()));
+
+        // gains come from the analysis done after rendering
+        const String normalize = exporter.getProperty (Tags::normalize, "none").toString();
+        const bool useLoudness = exporter.getProperty (Tags::normalizeMode, "peak").toString() == "loudness";
+        const float target     = (float) exporter.getProperty (Tags::normalizeTarget, -1.0);
+        NormalizeLevel instrument (useLoudness);
+        if (normalize == "instrument")
+            for (int i = 0; i < project.getNumSamples(); ++i)
+                instrument.add (project.getSample (i));
+
         for (int layerIdx = 0; layerIdx < project.getNumSampleSets(); ++layerIdx)
         {
             const auto layer = project.getSampleSet (layerIdx);
             layer.getSamples (samples);
+
+            NormalizeLevel group (useLoudness);
+            if (normalize == "layer")
+                for (auto* const sample : samples)
+                    group.add (*sample);
             
             for (auto* const sample : samples)
             {
                 String filename = sample->getFileName();
                 filename << getFileExtension();
 
-                tasks.add (new AudioFileWriterTask (
+                auto* const task = tasks.add (new AudioFileWriterTask (
                     sample->getFile(),
                     exporter.getPath().getChildFile (filename),
                     exporter.getProperty (Tags::sampleRate, 44100.0),
@@ -112,6 +180,29 @@ public:
                     exporter.getProperty (Tags::quality, 0),
                     sample->getStartTime(),
                     sample->getEndTime()));
+                task->setDither (exporter.getProperty (Tags::dither, 0));
+                if (sample->hasLoop())
+                    task->setLoop (loopType, sample->getLoopStart(), sample->getLoopEnd());
+
+                // without analysis there is no level to normalize from
+                if (normalize != "none" && ! NormalizeLevel::isAnalyzed (*sample))
+                {
+                    DBG("[VCP] " << sample->getFileName() << " wasn't analyzed, exporting without normalizing");
+                }
+                else if (normalize == "sample")
+                {
+                    NormalizeLevel single (useLoudness);
+                    single.add (*sample);
+                    task->setGain (single.getGain (target));
+                }
+                else if (normalize == "layer")
+                {
+                    task->setGain (group.getGain (target));
+                }
+                else if (normalize == "instrument")
+                {
+                    task->setGain (instrument.getGain (target));
+                }
             }
 
             samples.clearQuick (true);
@@ -121,6 +212,9 @@ public:
     void getLoopTypes (Array<LoopType>& types) const override
     {
         types.add (LoopType::None);
+        // loops are written to the smpl chunk
+        if (type == FormatType::WAVE)
+            types.addArray ({ LoopType::Forwards, LoopType::Alternating, LoopType::Reverse });
     }
 
     void setMissingProperties (ValueTree data) const override
@@ -133,6 +227,14 @@ public:
             data.setProperty (Tags::quality, getDefaultQuality(), nullptr);
         if (! data.hasProperty (Tags::bitDepth))
             data.setProperty (Tags::bitDepth, getDefaultBitDepth(), nullptr);
+        if (! data.hasProperty (Tags::dither))
+            data.setProperty (Tags::dither, 0, nullptr);
+        if (! data.hasProperty (Tags::normalize))
+            data.setProperty (Tags::normalize, "none", nullptr);
+        if (! data.hasProperty (Tags::normalizeMode))
+            data.setProperty (Tags::normalizeMode, "peak", nullptr);
+        if (! data.hasProperty (Tags::normalizeTarget))
+            data.setProperty (Tags::normalizeTarget, -1.0, nullptr);
     }
 
     String getFileExtension() const
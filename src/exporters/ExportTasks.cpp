@@ -35,7 +35,7 @@ Result AudioFileWriterTask::prepare (Versicap& versicap)
             writer.reset (format->createWriterFor (stream.get(),
                 sampleRate,
                 static_cast<unsigned int> (reader->numChannels),
-                bitDepth, { },
+                bitDepth, createMetadata(),
                 quality)
             );
         }
@@ -87,16 +87,158 @@ Result AudioFileWriterTask::perform()
     jassert (totalSamples > 0);
     totalSamples = roundToIntAccurate ((double) totalSamples / ratio);
     jassert (totalSamples > 0);
-    if (writer->writeFromAudioSource (resample, totalSamples, blockSize))
+
+    // integer formats are quantized here so gain and dither share one pass
+    const int numChannels = (int) writer->getNumChannels();
+    const int depth = writer->getBitsPerSample();
+    std::unique_ptr<SampleConverter> converter;
+    HeapBlock<int> converted;
+    HeapBlock<int*> channelData;
+    if (! writer->isFloatingPoint() && (depth == 16 || depth == 24 || depth == 32) &&
+        numChannels <= (int) reader->numChannels)
+    {
+        converter.reset (new SampleConverter());
+        converter->prepare (numChannels, depth, dither);
+        converted.malloc ((size_t) (numChannels * blockSize));
+        channelData.calloc ((size_t) numChannels + 1);
+        for (int c = 0; c < numChannels; ++c)
+            channelData[c] = converted + c * blockSize;
+    }
+
+    // resample, apply gain and encode in one pass
+    AudioSampleBuffer buffer ((int) reader->numChannels, blockSize);
+    const float gainFactor = Decibels::decibelsToGain (gain, -200.f);
+    for (int done = 0; done < totalSamples;)
+    {
+        const int numFrames = jmin (blockSize, totalSamples - done);
+        AudioSourceChannelInfo info (&buffer, 0, numFrames);
+        resample.getNextAudioBlock (info);
+
+        bool written = false;
+        if (converter != nullptr)
+        {
+            converter->convert (buffer.getArrayOfReadPointers(), channelData, numFrames, gainFactor);
+            written = writer->write (const_cast<const int**> (channelData.get()), numFrames);
+        }
+        else
+        {
+            if (gainFactor != 1.f)
+                buffer.applyGain (0, numFrames, gainFactor);
+            written = writer->writeFromAudioSampleBuffer (buffer, 0, numFrames);
+        }
+
+        if (! written)
+            return Result::fail ("could not write process sample");
+        done += numFrames;
+    }
+
+    writer.reset();
+    return tempFile->overwriteTargetFileWithTemporary()
+        ? Result::ok() : Result::fail ("could not write sample");
+}
+
+StringPairArray AudioFileWriterTask::createMetadata() const
+{
+    StringPairArray metadata;
+    if (loopType == LoopType::None || loopEnd <= loopStart ||
+        ! target.hasFileExtension (FormatType::getFileExtension (FormatType::WAVE)))
+        return metadata;
+
+    // loop points relative to the exported region in the target's rate
+    const int64 start = roundToIntAccurate ((loopStart - jmax (0.0, startTime)) * sampleRate);
+    const int64 end   = roundToIntAccurate ((loopEnd - jmax (0.0, startTime)) * sampleRate);
+    const int64 total = roundToIntAccurate ((endTime - jmax (0.0, startTime)) * sampleRate);
+    if (start < 0 || end <= start || (endTime > startTime && end > total))
+        return metadata;
+
+    // smpl chunk loop types: 0 = forwards, 1 = alternating, 2 = reverse
+    int type = 0;
+    if (loopType == LoopType::Alternating)  type = 1;
+    else if (loopType == LoopType::Reverse) type = 2;
+
+    metadata.set ("NumSampleLoops",   "1");
+    metadata.set ("Loop0Identifier",  "0");
+    metadata.set ("Loop0Type",        String (type));
+    metadata.set ("Loop0Start",       String (start));
+    metadata.set ("Loop0End",         String (end - 1));
+    metadata.set ("Loop0Fraction",    "0");
+    metadata.set ("Loop0PlayCount",   "0");
+    return metadata;
+}
+
+String AudioFileWriterTask::getFingerprint() const
+{
+    String text;
+    text << source.getFullPathName()
+         << "|" << source.getSize()
+         << "|" << source.getLastModificationTime().toMilliseconds()
+         << "|" << startTime << "|" << endTime
+         << "|" << sampleRate << "|" << channels
+         << "|" << bitDepth << "|" << quality
+         << "|" << loopType.getSlug() << "|" << loopStart << "|" << loopEnd
+         << "|" << gain << "|" << dither;
+    return SHA256 (text.toUTF8()).toHexString();
+}
+
+//=============================================================================
+ExportManifestTask::ExportManifestTask (const File& dir, const String& exporterId)
+    : directory (dir),
+      manifestFile (dir.getChildFile (String (".versicap-") + exporterId + ".xml")),
+      current (Tags::exporter)
+{
+    std::unique_ptr<XmlElement> xml (XmlDocument::parse (manifestFile));
+    if (xml != nullptr)
+        previous = ValueTree::fromXml (*xml);
+    if (! previous.hasType (Tags::exporter))
+        previous = ValueTree (Tags::exporter);
+}
+
+void ExportManifestTask::filter (OwnedArray<ExportTask>& tasks)
+{
+    for (int i = tasks.size(); --i >= 0;)
+    {
+        auto* const task = tasks.getUnchecked (i);
+        const auto output = task->getOutputFile();
+        const auto fingerprint = task->getFingerprint();
+        if (output == File() || fingerprint.isEmpty())
+            continue;
+
+        ValueTree entry (Tags::file);
+        entry.setProperty (Tags::name, output.getRelativePathFrom (directory), nullptr)
+             .setProperty (Tags::fingerprint, fingerprint, nullptr);
+        current.addChild (entry, 0, nullptr);
+
+        const auto old = previous.getChildWithProperty (Tags::name, entry.getProperty (Tags::name));
+        if (output.existsAsFile() && old.isValid() && 
+            old.getProperty (Tags::fingerprint).toString() == fingerprint)
+        {
+            tasks.remove (i);
+            ++numSkipped;
+        }
+    }
+
+    DBG("[VCP] unchanged exports skipped: " << numSkipped);
+}
+
+Result ExportManifestTask::perform()
+{
+    // remove outputs from earlier exports which aren't produced anymore
+    for (int i = 0; i < previous.getNumChildren(); ++i)
     {
-        writer.reset();
-        return tempFile->overwriteTargetFileWithTemporary()
-            ? Result::ok() : Result::fail ("could not write sample");
+        const auto name = previous.getChild(i).getProperty (Tags::name).toString();
+        if (name.isNotEmpty() && ! current.getChildWithProperty (Tags::name, name).isValid())
+            directory.getChildFile (name).deleteFile();
     }
 
-    return Result::fail ("could not write process sample");
+    std::unique_ptr<XmlElement> xml (current.createXml());
+    if (xml == nullptr || ! xml->writeToFile (manifestFile, String()))
+        return Result::fail ("could not write export manifest");
+    
+    previous = current.createCopy();
+    return Result::ok();
 }
 
+//=============================================================================
 void Project::getExportTasks (OwnedArray<ExportTask>& tasks) const
 {
     for (int i = 0; i < getNumExporters(); ++i)
@@ -104,12 +246,27 @@ void Project::getExportTasks (OwnedArray<ExportTask>& tasks) const
         auto exporter = getExporter (i);
         auto type = exporter.getTypeObject();
         jassert (exporter.isValid());
-        jassert (type);
         if (type == nullptr)
-            continue;
+            continue; // the exporter's plugin isn't installed
 
         tasks.add (new CreatePathTask (exporter.getPath()));
-        type->getTasks (*this, exporter, tasks);
+
+        OwnedArray<ExportTask> exporterTasks;
+        type->getTasks (*this, exporter, exporterTasks);
+        
+        std::unique_ptr<ExportManifestTask> manifest;
+        if (exporter.getPath() != File())
+        {
+            manifest.reset (new ExportManifestTask (exporter.getPath(), 
+                exporter.getProperty (Tags::uuid).toString()));
+            manifest->filter (exporterTasks);
+        }
+
+        for (auto* const task : exporterTasks)
+            tasks.add (task);
+        exporterTasks.clearQuick (false);
+        if (manifest)
+            tasks.add (manifest.release());
     }
 }
 
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include "engine/SampleConverter.h"
 #include "exporters/Exporter.h"
 
 namespace vcp {
@@ -66,9 +67,27 @@ public:
 
     ~AudioFileWriterTask() { }
 
+    /** Sets a gain in decibels applied while writing */
+    void setGain (float gainDecibels) { gain = gainDecibels; }
+
+    /** Sets the SampleConverter::Dither used for integer formats */
+    void setDither (int newDither) { dither = newDither; }
+
+    /** Writes loop points to formats which support them. Times are in
+        seconds of the source file */
+    void setLoop (const LoopType& type, double startSeconds, double endSeconds)
+    {
+        loopType  = type;
+        loopStart = startSeconds;
+        loopEnd   = endSeconds;
+    }
+
     Result prepare (Versicap&) override;
     Result perform() override;
     String getProgressName() const override { return target.getFileName(); }
+    bool canRunInParallel() const override { return true; }
+    String getFingerprint() const override;
+    File getOutputFile() const override { return target; }
 
 private:
     const File source;
@@ -80,9 +99,40 @@ private:
     const int quality;
     const double startTime;
     const double endTime;
+    LoopType loopType;
+    double loopStart = 0.0;
+    double loopEnd = 0.0;
+    float gain = 0.f;
+    int dither = SampleConverter::NoDither;
+
+    StringPairArray createMetadata() const;
 
     std::unique_ptr<AudioFormatReader> reader;
     std::unique_ptr<AudioFormatWriter> writer;
 };
 
+/** Keeps a manifest of fingerprints for an exporter's outputs. Tasks with
+    unchanged outputs are dropped before exporting and, once the export
+    completes, outputs which are no longer produced are removed */
+class ExportManifestTask : public ExportTask
+{
+public:
+    ExportManifestTask (const File& directory, const String& exporterId);
+
+    /** Removes unchanged tasks from the array. Call before preparing */
+    void filter (OwnedArray<ExportTask>& tasks);
+
+    Result perform() override;
+    String getProgressName() const override { return manifestFile.getFileName(); }
+
+    int getNumSkipped() const { return numSkipped; }
+
+private:
+    const File directory;
+    const File manifestFile;
+    ValueTree previous;
+    ValueTree current;
+    int numSkipped = 0;
+};
+
 }
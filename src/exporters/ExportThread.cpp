@@ -4,8 +4,28 @@
 
 namespace vcp {
 
+class ExportThread::Job : public ThreadPoolJob
+{
+public:
+    Job (ExportThread& t, ExportTask& tk)
+        : ThreadPoolJob (tk.getProgressName()),
+          thread (t), task (tk) { }
+
+    JobStatus runJob() override
+    {
+        if (! shouldExit() && thread.numFailed.get() == 0)
+            thread.perform (task);
+        return jobHasFinished;
+    }
+
+private:
+    ExportThread& thread;
+    ExportTask& task;
+};
+
 ExportThread::ExportThread()
     : Thread ("vcpexport"),
+      pool (jmax (1, SystemStats::getNumCpus() - 1)),
       started (*this), finished (*this),
       progressNotify (*this)
 {
@@ -58,9 +78,36 @@ void ExportThread::cancel()
 {
     signalThreadShouldExit();
     notify();
+    pool.removeAllJobs (true, 5000);
     stopThread (5000);
 }
 
+void ExportThread::perform (ExportTask& task)
+{
+    {
+        ScopedLock sl (lock);
+        progressTitle = task.getProgressName();
+        progressNotify.triggerAsyncUpdate();
+    }
+
+    const auto result = task.perform();
+
+    // pool jobs finish in any order, so count what is done
+    const int numDone = ++numPerformed;
+    {
+        ScopedLock sl (lock);
+        progress = jmin (1.0, static_cast<double> (numDone) / static_cast<double> (tasks.size()));
+        progressNotify.triggerAsyncUpdate();
+    }
+
+    if (! result.wasOk())
+    {
+        DBG("[VCP] " << result.getErrorMessage());
+        // trigger error and cancel
+        ++numFailed;
+    }
+}
+
 void ExportThread::run()
 {
     while (! threadShouldExit())
@@ -81,28 +128,30 @@ void ExportThread::run()
         if (threadShouldExit())
             break;
 
-        for (int i = 0; i < tasks.size(); ++i)
+        numPerformed.set (0);
+        numFailed.set (0);
+
+        for (int i = 0; i < tasks.size();)
         {
+            if (threadShouldExit() || numFailed.get() > 0)
+                break;
+
             auto* const task = tasks.getUnchecked (i);
-        
+            if (! task->canRunInParallel())
             {
-                ScopedLock sl (lock);
-                progress = static_cast<double> (i + 1) / static_cast<double> (tasks.size());
-                progressTitle = task->getProgressName();
-                progressNotify.triggerAsyncUpdate();
+                perform (*task);
+                ++i;
+                continue;
             }
-        
-            const auto result = task->perform();
 
-            if (threadShouldExit())
-                break;
+            // independent tasks in a row are spread over the pool
+            for (; i < tasks.size() && tasks.getUnchecked(i)->canRunInParallel(); ++i)
+                pool.addJob (new Job (*this, *tasks.getUnchecked (i)), true);
 
-            if (! result.wasOk())
-            {
-                DBG("[VCP] " << result.getErrorMessage());
-                // trigger error and cancel
-                break;
-            }
+            while (pool.getNumJobs() > 0 && ! threadShouldExit())
+                wait (50);
+            if (threadShouldExit())
+                pool.removeAllJobs (true, 5000);
         }
 
         Thread::sleep (500);
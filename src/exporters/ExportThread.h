@@ -48,7 +48,13 @@ private:
     String progressTitle;
 
     OwnedArray<ExportTask> tasks;
+    class Job;
+    ThreadPool pool;
+    Atomic<int> numPerformed { 0 };
+    Atomic<int> numFailed { 0 };
+
     void run() override;
+    void perform (ExportTask&);
 
     struct Started : public AsyncUpdater
     {
@@ -1,5 +1,6 @@
 
 #include "exporters/Exporter.h"
+#include "BundleManager.h"
 #include "Versicap.h"
 
 namespace vcp {
@@ -23,6 +24,16 @@ void ExporterType::createAllTypes (Versicap& versicap, ExporterTypeArray& types)
     types.add (createAiffExporterType (versicap.getAudioFormats()));
     types.add (createFlacExporterType (versicap.getAudioFormats()));
     types.add (createOggExporterType (versicap.getAudioFormats()));
+    types.add (createSfzExporterType());
+    types.add (createSf2ExporterType());
+    types.add (createContainerExporterType());
+   #if VCP_PYTHON
+    types.add (createPythonExporterType());
+   #endif
+
+    for (const auto& desc : versicap.getBundleManager().getDescriptions())
+        if (desc.isProcessor)
+            types.add (createPluginExporterType (desc.identifier, desc.name, desc.fileExtension));
 }
 
 }
@@ -39,6 +39,14 @@ private:
     static ExporterType* createAiffExporterType (AudioFormatManager&);
     static ExporterType* createFlacExporterType (AudioFormatManager&);
     static ExporterType* createOggExporterType (AudioFormatManager&);
+    static ExporterType* createSfzExporterType();
+    static ExporterType* createSf2ExporterType();
+    static ExporterType* createContainerExporterType();
+   #if VCP_PYTHON
+    static ExporterType* createPythonExporterType();
+   #endif
+    static ExporterType* createPluginExporterType (const String& identifier, const String& name,
+                                                   const String& fileExtension);
 };
 
 class ExportTask
@@ -51,6 +59,15 @@ public:
     virtual Result prepare (Versicap&) { return Result::ok(); }
     virtual Result perform() { return Result::ok(); }
     virtual String getProgressName() const { return {}; }
+
+    /** Consecutive tasks returning true are performed on a pool of threads,
+        they must not depend on each other's output */
+    virtual bool canRunInParallel() const { return false; }
+
+    /** Returns a hash of everything that affects the output. Tasks with a
+        fingerprint and output file are skipped when neither has changed */
+    virtual String getFingerprint() const { return {}; }
+    virtual File getOutputFile() const { return {}; }
 };
 
 class Exporter : public kv::ObjectModel
@@ -0,0 +1,347 @@
+#include "exporters/InstrumentContainer.h"
+
+namespace vcp {
+
+using namespace ContainerFormat;
+
+namespace {
+
+void copyName (char* dest, size_t size, const String& name)
+{
+    zeromem (dest, size);
+    name.copyToUTF8 (dest, size);
+    dest[size - 1] = 0;
+}
+
+}
+
+//=============================================================================
+ContainerWriter::ContainerWriter (OutputStream& out, const Array<RegionInfo>& regionsToWrite,
+                                  int enc, bool shouldInterleave, int ditherType)
+    : output (out),
+      infos (regionsToWrite),
+      encoding (enc == Float32 ? Float32 : Int16),
+      interleaved (shouldInterleave),
+      dither (ditherType)
+{ }
+
+bool ContainerWriter::fillTo (uint64 position)
+{
+    const auto now = static_cast<uint64> (output.getPosition());
+    if (now > position)
+        return output.setPosition (static_cast<int64> (position));
+    return now == position || output.writeRepeatedByte (0, (size_t) (position - now));
+}
+
+Result ContainerWriter::begin (const String& instrumentName)
+{
+    if (output.getPosition() != 0)
+        return Result::fail ("container must be written to an empty stream");
+
+    // lookup lists, regions later in the list stack on top of earlier ones
+    cells.clearQuick();
+    list.clearQuick();
+    for (int note = 0; note < 128; ++note)
+    {
+        for (int velocity = 0; velocity < 128; ++velocity)
+        {
+            Cell cell { static_cast<uint32> (list.size()), 0 };
+            for (int i = 0; i < infos.size(); ++i)
+            {
+                const auto& info = infos.getReference (i);
+                if (note >= info.lowKey && note <= info.highKey &&
+                    velocity >= info.lowVelocity && velocity <= info.highVelocity)
+                {
+                    list.add (static_cast<uint32> (i));
+                    ++cell.count;
+                }
+            }
+            cells.add (cell);
+        }
+    }
+
+    Header header;
+    zerostruct (header);
+    memcpy (header.magic, "VCPI", 4);
+    header.version          = version;
+    header.pageSize         = pageSize;
+    header.encoding         = static_cast<uint32> (encoding);
+    header.flags            = interleaved ? Interleaved : 0;
+    header.numRegions       = static_cast<uint32> (infos.size());
+    header.regionsOffset    = pageSize;
+    header.cellsOffset      = header.regionsOffset + sizeof (Region) * (uint64) infos.size();
+    header.listOffset       = header.cellsOffset + sizeof (Cell) * (uint64) numCells;
+    header.listSize         = static_cast<uint64> (list.size());
+    copyName (header.name, sizeof (header.name), instrumentName);
+
+    uint64 offset = alignToPage (header.listOffset + sizeof (uint32) * header.listSize);
+    regions.clearQuick();
+    for (const auto& info : infos)
+    {
+        Region region;
+        zerostruct (region);
+        region.dataOffset   = offset;
+        region.numFrames    = static_cast<uint64> (jmax ((int64) 0, info.numFrames));
+        region.numChannels  = static_cast<uint32> (jmax (1, info.numChannels));
+        region.sampleRate   = info.sampleRate;
+        region.note         = static_cast<uint8> (jlimit (0, 127, info.note));
+        region.lowKey       = static_cast<uint8> (jlimit (0, 127, info.lowKey));
+        region.highKey      = static_cast<uint8> (jlimit (0, 127, info.highKey));
+        region.lowVelocity  = static_cast<uint8> (jlimit (0, 127, info.lowVelocity));
+        region.highVelocity = static_cast<uint8> (jlimit (0, 127, info.highVelocity));
+        const bool looped   = info.loopStart >= 0 && info.loopEnd > info.loopStart &&
+                              info.loopEnd <= (int64) region.numFrames;
+        region.loopStart    = looped ? info.loopStart : -1;
+        region.loopEnd      = looped ? info.loopEnd : -1;
+        copyName (region.name, sizeof (region.name), info.name);
+        regions.add (region);
+
+        offset = alignToPage (offset + region.numFrames * region.numChannels * (uint64) getBytesPerSample());
+    }
+    header.fileSize = offset;
+
+    bool ok = output.write (&header, sizeof (Header)) && fillTo (header.regionsOffset);
+    ok = ok && (regions.isEmpty() || output.write (regions.getRawDataPointer(), sizeof (Region) * (size_t) regions.size()));
+    ok = ok && output.write (cells.getRawDataPointer(), sizeof (Cell) * (size_t) cells.size());
+    ok = ok && (list.isEmpty() || output.write (list.getRawDataPointer(), sizeof (uint32) * (size_t) list.size()));
+    current = -1;
+    return ok ? Result::ok() : Result::fail ("could not write container header");
+}
+
+Result ContainerWriter::beginRegion()
+{
+    if (inRegion)
+        return Result::fail ("previous container region wasn't finished");
+    if (! isPositiveAndBelow (current + 1, regions.size()))
+        return Result::fail ("no more container regions to write");
+
+    ++current;
+    const auto& region = regions.getReference (current);
+    if (! fillTo (region.dataOffset))
+        return Result::fail ("could not write container region");
+
+    converter.prepare ((int) region.numChannels, 16, dither);
+    channels.calloc ((size_t) region.numChannels + 1);
+    blockSize = 0;
+    written = 0;
+    inRegion = true;
+    return Result::ok();
+}
+
+bool ContainerWriter::writeFrames (const float* const* data, int numFrames)
+{
+    jassert (inRegion);
+    const auto& region = regions.getReference (current);
+    const int numChannels = (int) region.numChannels;
+    const int bytes = getBytesPerSample();
+    numFrames = (int) jmin ((int64) numFrames, (int64) region.numFrames - written);
+    if (numFrames <= 0)
+        return true;
+
+    if (numFrames > blockSize)
+    {
+        blockSize = numFrames;
+        block.malloc ((size_t) (blockSize * numChannels * bytes));
+        converted.malloc ((size_t) (blockSize * numChannels));
+        for (int c = 0; c < numChannels; ++c)
+            channels[c] = converted + c * blockSize;
+    }
+
+    if (encoding == Int16)
+        converter.convert (data, channels, numFrames);
+
+    auto getValue = [&] (int channel, int frame, char* dest)
+    {
+        if (encoding == Int16)
+        {
+            const auto value = static_cast<int16> (channels[channel][frame] >> 16);
+            memcpy (dest, &value, sizeof (int16));
+        }
+        else
+        {
+            memcpy (dest, data[channel] + frame, sizeof (float));
+        }
+    };
+
+    bool ok = true;
+    if (interleaved)
+    {
+        char* dest = block;
+        for (int i = 0; i < numFrames; ++i)
+            for (int c = 0; c < numChannels; ++c, dest += bytes)
+                getValue (c, i, dest);
+        ok = output.write (block, (size_t) (numFrames * numChannels * bytes));
+    }
+    else
+    {
+        // one block per channel, positioned within the region
+        for (int c = 0; c < numChannels && ok; ++c)
+        {
+            char* dest = block;
+            for (int i = 0; i < numFrames; ++i, dest += bytes)
+                getValue (c, i, dest);
+            const auto position = region.dataOffset + ((uint64) c * region.numFrames + (uint64) written) * (uint64) bytes;
+            ok = output.setPosition ((int64) position) && output.write (block, (size_t) (numFrames * bytes));
+        }
+    }
+
+    written += numFrames;
+    return ok;
+}
+
+Result ContainerWriter::endRegion()
+{
+    if (! inRegion)
+        return Result::fail ("container region wasn't started");
+
+    const auto& region = regions.getReference (current);
+    if (written < (int64) region.numFrames)
+    {
+        // pad short sources with silence so offsets stay valid
+        AudioSampleBuffer silence ((int) region.numChannels, 4096);
+        silence.clear();
+        while (written < (int64) region.numFrames)
+            if (! writeFrames (silence.getArrayOfReadPointers(), silence.getNumSamples()))
+                return Result::fail ("could not write container region");
+    }
+
+    inRegion = false;
+    const uint64 end = region.dataOffset + region.numFrames * region.numChannels * (uint64) getBytesPerSample();
+    return output.setPosition ((int64) end) ? Result::ok()
+        : Result::fail ("could not write container region");
+}
+
+Result ContainerWriter::finish()
+{
+    if (inRegion)
+        return Result::fail ("container region wasn't finished");
+    if (current != regions.size() - 1)
+        return Result::fail ("not all container regions were written");
+
+    const uint64 fileSize = regions.isEmpty()
+        ? alignToPage (static_cast<uint64> (output.getPosition()))
+        : alignToPage (regions.getLast().dataOffset + regions.getLast().numFrames
+                        * regions.getLast().numChannels * (uint64) getBytesPerSample());
+    if (! fillTo (fileSize))
+        return Result::fail ("could not write container");
+    output.flush();
+    return Result::ok();
+}
+
+//=============================================================================
+Result ContainerReader::open (const File& file)
+{
+    header = nullptr;
+    regions = nullptr;
+    cells = nullptr;
+    list = nullptr;
+
+   #if JUCE_BIG_ENDIAN
+    ignoreUnused (file);
+    return Result::fail ("containers can only be read on little endian systems");
+   #else
+    map.reset (new MemoryMappedFile (file, MemoryMappedFile::readOnly));
+    const auto size = static_cast<uint64> (map->getSize());
+    if (map->getData() == nullptr || size < sizeof (Header))
+    {
+        map.reset();
+        return Result::fail ("could not map instrument container");
+    }
+
+    const auto* const h = static_cast<const Header*> (map->getData());
+    if (memcmp (h->magic, "VCPI", 4) != 0 || h->version != version ||
+        h->pageSize != pageSize || (h->encoding != Int16 && h->encoding != Float32))
+    {
+        map.reset();
+        return Result::fail ("not an instrument container");
+    }
+
+    // check every offset once so lookups don't have to
+    bool valid = h->fileSize <= size &&
+        h->regionsOffset + sizeof (Region) * (uint64) h->numRegions <= size &&
+        h->cellsOffset + sizeof (Cell) * (uint64) numCells <= size &&
+        h->listOffset + sizeof (uint32) * h->listSize <= size;
+
+    const auto* const r = reinterpret_cast<const Region*> (static_cast<const char*> (map->getData()) + h->regionsOffset);
+    const auto* const c = reinterpret_cast<const Cell*> (static_cast<const char*> (map->getData()) + h->cellsOffset);
+    const auto* const l = reinterpret_cast<const uint32*> (static_cast<const char*> (map->getData()) + h->listOffset);
+    const uint64 bytes = h->encoding == Int16 ? 2 : 4;
+
+    for (uint32 i = 0; valid && i < h->numRegions; ++i)
+        valid = r[i].numChannels > 0 && r[i].dataOffset % pageSize == 0 &&
+            r[i].dataOffset + r[i].numFrames * r[i].numChannels * bytes <= size;
+    for (int i = 0; valid && i < numCells; ++i)
+        valid = (uint64) c[i].first + c[i].count <= h->listSize;
+    for (uint64 i = 0; valid && i < h->listSize; ++i)
+        valid = l[i] < h->numRegions;
+
+    if (! valid)
+    {
+        map.reset();
+        return Result::fail ("instrument container is damaged");
+    }
+
+    header  = h;
+    regions = r;
+    cells   = c;
+    list    = l;
+    return Result::ok();
+   #endif
+}
+
+String ContainerReader::getName() const
+{
+    return header != nullptr ? String::fromUTF8 (header->name, (int) strnlen (header->name, sizeof (header->name)))
+                             : String();
+}
+
+const ContainerFormat::Region* ContainerReader::getRegion (int index) const
+{
+    return isPositiveAndBelow (index, getNumRegions()) ? regions + index : nullptr;
+}
+
+int ContainerReader::getRegionsFor (int note, int velocity, const uint32*& indexes) const
+{
+    indexes = nullptr;
+    if (header == nullptr || ! isPositiveAndBelow (note, 128) || ! isPositiveAndBelow (velocity, 128))
+        return 0;
+    const auto& cell = cells [getCellIndex (note, velocity)];
+    indexes = list + cell.first;
+    return (int) cell.count;
+}
+
+const char* ContainerReader::getData (uint64 offset) const
+{
+    return static_cast<const char*> (map->getData()) + offset;
+}
+
+float ContainerReader::getSample (const Region& region, int channel, int64 frame) const noexcept
+{
+    const uint64 index = (header->flags & Interleaved) != 0
+        ? (uint64) frame * region.numChannels + (uint64) channel
+        : (uint64) channel * region.numFrames + (uint64) frame;
+    if (header->encoding == Int16)
+        return static_cast<float> (reinterpret_cast<const int16*> (getData (region.dataOffset))[index]) * (1.f / 32768.f);
+    return reinterpret_cast<const float*> (getData (region.dataOffset))[index];
+}
+
+int ContainerReader::read (int index, int64 startFrame, AudioSampleBuffer& buffer,
+                           int startSample, int numFrames) const
+{
+    const auto* const region = getRegion (index);
+    if (region == nullptr || startFrame < 0 || startFrame >= (int64) region->numFrames)
+        return 0;
+
+    numFrames = (int) jmin ((int64) numFrames, (int64) region->numFrames - startFrame);
+    const int numChannels = jmin (buffer.getNumChannels(), (int) region->numChannels);
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* const dest = buffer.getWritePointer (c, startSample);
+        for (int i = 0; i < numFrames; ++i)
+            dest[i] = getSample (*region, c, startFrame + i);
+    }
+
+    return numFrames;
+}
+
+}
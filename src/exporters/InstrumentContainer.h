@@ -0,0 +1,193 @@
+#pragma once
+
+#include "engine/SampleConverter.h"
+
+namespace vcp {
+
+/** On disk layout of a monolithic instrument container. Everything is little
+    endian and laid out so the file can be memory mapped and used in place.
+
+    The header page is followed by the region table, a 128 x 128 note and
+    velocity lookup and the region index lists it points to. Each region's
+    audio starts on a page boundary, either interleaved or one channel
+    block after another. */
+namespace ContainerFormat
+{
+    enum
+    {
+        version         = 1,
+        pageSize        = 4096,
+        numCells        = 128 * 128
+    };
+
+    enum Encoding
+    {
+        Int16   = 1,
+        Float32 = 2
+    };
+
+    enum Flags
+    {
+        Interleaved     = 1 << 0
+    };
+
+    struct Header
+    {
+        char magic[4];          // "VCPI"
+        uint32 version;
+        uint32 pageSize;
+        uint32 encoding;
+        uint32 flags;
+        uint32 numRegions;
+        uint64 regionsOffset;
+        uint64 cellsOffset;
+        uint64 listOffset;
+        uint64 listSize;        // number of uint32 region indexes
+        uint64 fileSize;
+        char name[64];
+    };
+
+    struct Region
+    {
+        uint64 dataOffset;
+        uint64 numFrames;
+        int64 loopStart;        // frames, -1 = no loop
+        int64 loopEnd;          // exclusive
+        double sampleRate;
+        uint32 numChannels;
+        uint8 note;
+        uint8 lowKey;
+        uint8 highKey;
+        uint8 lowVelocity;
+        uint8 highVelocity;
+        uint8 reserved[15];
+        char name[64];
+    };
+
+    /** Regions sounding for a note and velocity */
+    struct Cell
+    {
+        uint32 first;           // index into the region list
+        uint32 count;
+    };
+
+    static_assert (sizeof (Header) == 128, "unexpected container header size");
+    static_assert (sizeof (Region) == 128, "unexpected container region size");
+    static_assert (sizeof (Cell) == 8, "unexpected container cell size");
+
+    inline int getCellIndex (int note, int velocity) { return note * 128 + velocity; }
+
+    inline uint64 alignToPage (uint64 offset)
+    {
+        return (offset + pageSize - 1) & ~static_cast<uint64> (pageSize - 1);
+    }
+}
+
+//=============================================================================
+/** Streams regions into a container file. Offsets are computed from the
+    region lengths up front, so the tables are written first and audio goes
+    straight to its final position without being held in memory */
+class ContainerWriter
+{
+public:
+    struct RegionInfo
+    {
+        String name;
+        int note            = 60;
+        int lowKey          = 0;
+        int highKey         = 127;
+        int lowVelocity     = 1;
+        int highVelocity    = 127;
+        int numChannels     = 2;
+        int64 numFrames     = 0;
+        double sampleRate   = 44100.0;
+        int64 loopStart     = -1;
+        int64 loopEnd       = -1;
+    };
+
+    /** The output must start empty and support setPosition(). Regions are
+        written in the order given here */
+    ContainerWriter (OutputStream& output, const Array<RegionInfo>& regions,
+                     int encoding, bool interleaved, int dither = 0);
+    ~ContainerWriter() = default;
+
+    /** Writes the header and tables, call once before writing audio */
+    Result begin (const String& name);
+
+    /** Starts writing the audio of the next region */
+    Result beginRegion();
+
+    /** Appends consecutive frames to the current region */
+    bool writeFrames (const float* const* data, int numFrames);
+
+    /** Finishes the current region, it must have received all its frames */
+    Result endRegion();
+
+    /** Checks that all regions were written */
+    Result finish();
+
+private:
+    OutputStream& output;
+    Array<RegionInfo> infos;
+    Array<ContainerFormat::Region> regions;
+    const int encoding;
+    const bool interleaved;
+    const int dither;
+    Array<ContainerFormat::Cell> cells;
+    Array<uint32> list;
+    int current = -1;
+    int64 written = 0;
+    bool inRegion = false;
+    SampleConverter converter;
+    HeapBlock<int> converted;
+    HeapBlock<int*> channels;
+    HeapBlock<char> block;
+    int blockSize = 0;
+
+    int getBytesPerSample() const { return encoding == ContainerFormat::Int16 ? 2 : 4; }
+    bool fillTo (uint64 position);
+
+    JUCE_DECLARE_NON_COPYABLE (ContainerWriter)
+};
+
+//=============================================================================
+/** Opens a container by memory mapping it. Region audio is accessed in place
+    and the note and velocity lookup is a single table read */
+class ContainerReader : public ReferenceCountedObject
+{
+public:
+    ContainerReader() = default;
+    ~ContainerReader() = default;
+
+    Result open (const File& file);
+    bool isOpen() const { return header != nullptr; }
+
+    String getName() const;
+    int getNumRegions() const { return header != nullptr ? (int) header->numRegions : 0; }
+    const ContainerFormat::Region* getRegion (int index) const;
+
+    /** Returns the number of regions sounding for a note and velocity and
+        points indexes at their region numbers */
+    int getRegionsFor (int note, int velocity, const uint32*& indexes) const;
+
+    /** Returns a single sample converted to float. Doesn't check bounds */
+    float getSample (const ContainerFormat::Region& region, int channel, int64 frame) const noexcept;
+
+    /** Reads frames of a region into a buffer. Returns the number of frames
+        read, which is less than requested at the end of the region */
+    int read (int region, int64 startFrame, AudioSampleBuffer& buffer,
+              int startSample, int numFrames) const;
+
+private:
+    std::unique_ptr<MemoryMappedFile> map;
+    const ContainerFormat::Header* header = nullptr;
+    const ContainerFormat::Region* regions = nullptr;
+    const ContainerFormat::Cell* cells = nullptr;
+    const uint32* list = nullptr;
+
+    const char* getData (uint64 offset) const;
+};
+
+typedef ReferenceCountedObjectPtr<ContainerReader> ContainerReaderPtr;
+
+}
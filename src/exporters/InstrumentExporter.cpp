@@ -0,0 +1,505 @@
+#include "engine/SampleConverter.h"
+#include "exporters/Exporter.h"
+#include "exporters/ExportTasks.h"
+#include "exporters/InstrumentContainer.h"
+#include "exporters/InstrumentRegion.h"
+#include "exporters/SF2Writer.h"
+#include "Project.h"
+#include "Versicap.h"
+
+namespace vcp {
+
+//=============================================================================
+class SfzWriterTask : public ExportTask
+{
+public:
+    SfzWriterTask (const File& tgt, const String& text)
+        : target (tgt), content (text) { }
+
+    Result perform() override
+    {
+        return target.replaceWithText (content)
+            ? Result::ok() : Result::fail ("could not write sfz file");
+    }
+
+    String getProgressName() const override { return target.getFileName(); }
+    String getFingerprint() const override { return SHA256 (content.toUTF8()).toHexString(); }
+    File getOutputFile() const override { return target; }
+
+private:
+    const File target;
+    const String content;
+};
+
+class SfzExporterType : public ExporterType
+{
+public:
+    SfzExporterType() = default;
+
+    String getSlug() const override { return "sfz"; }
+    String getName() const override { return "SFZ"; }
+
+    void getLoopTypes (Array<LoopType>& types) const override
+    {
+        types.addArray ({ LoopType::None, LoopType::Forwards, LoopType::Alternating });
+    }
+
+    void getProperties (const Exporter& exporter, Array<PropertyComponent*>& props) const override
+    {
+        Exporter expref = exporter;
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::bitDepth),
+            "Bit Depth", { "16 bit", "24 bit" }, { 16, 24 }));
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::dither),
+            "Dither", { "Off", "TPDF", "TPDF + Shaping" }, { 0, 1, 2 }));
+    }
+
+    void getTasks (const Project& project, const Exporter& exporter,
+                   OwnedArray<ExportTask>& tasks) const override
+    {
+        Array<InstrumentRegion> regions;
+        InstrumentRegion::getRegions (project, regions);
+
+        const LoopType loopType (LoopType::fromSlug (exporter.getProperty (Tags::loop).toString()));
+        const auto samplesDir = exporter.getPath().getChildFile ("samples");
+        tasks.add (new CreatePathTask (samplesDir));
+
+        String text;
+        text << "// " << InstrumentRegion::getInstrumentName (project) << newLine
+             << "// Exported by Versicap" << newLine << newLine
+             << "<control>" << newLine
+             << "default_path=samples/" << newLine;
+
+        String group;
+        int velocity = -1;
+        for (const auto& region : regions)
+        {
+            const String filename = region.name + ".wav";
+            auto* const task = tasks.add (new AudioFileWriterTask (
+                region.file, samplesDir.getChildFile (filename),
+                region.sampleRate, region.numChannels,
+                exporter.getProperty (Tags::bitDepth, 24), 0,
+                region.startTime, region.endTime));
+            task->setDither (exporter.getProperty (Tags::dither, 0));
+
+            if (region.group != group || region.lowVelocity != velocity)
+            {
+                group = region.group;
+                velocity = region.lowVelocity;
+                text << newLine << "<group> // " << group << newLine
+                     << "lovel=" << region.lowVelocity << " hivel=" << region.highVelocity << newLine;
+            }
+
+            text << "<region> sample=" << filename
+                 << " lokey=" << region.lowKey << " hikey=" << region.highKey
+                 << " pitch_keycenter=" << region.note;
+
+            if (loopType != LoopType::None && region.hasLoop())
+            {
+                task->setLoop (loopType, region.loopStart, region.loopEnd);
+                text << " loop_mode=loop_continuous"
+                     << " loop_start=" << region.getFrame (region.loopStart)
+                     << " loop_end=" << region.getFrame (region.loopEnd) - 1;
+                if (loopType == LoopType::Alternating)
+                    text << " loop_type=alternate";
+            }
+
+            text << newLine;
+        }
+
+        tasks.add (new SfzWriterTask (exporter.getPath().getChildFile (
+            File::createLegalFileName (InstrumentRegion::getInstrumentName (project)) + ".sfz"), text));
+    }
+
+protected:
+    void setMissingProperties (ValueTree data) const override
+    {
+        if (! data.hasProperty (Tags::bitDepth))
+            data.setProperty (Tags::bitDepth, 24, nullptr);
+        if (! data.hasProperty (Tags::dither))
+            data.setProperty (Tags::dither, 0, nullptr);
+        if (! data.hasProperty (Tags::loop))
+            data.setProperty (Tags::loop, LoopType (LoopType::Forwards).getSlug(), nullptr);
+    }
+};
+
+//=============================================================================
+class Sf2WriterTask : public ExportTask
+{
+public:
+    Sf2WriterTask (const File& tgt, const String& instrumentName,
+                   const Array<InstrumentRegion>& regionsToWrite,
+                   bool shouldLoop, int ditherType)
+        : target (tgt), name (instrumentName), regions (regionsToWrite),
+          loop (shouldLoop), dither (ditherType) { }
+
+    Result prepare (Versicap& versicap) override
+    {
+        if (target == File())
+            return Result::fail ("target not specified for export");
+        formats = &versicap.getAudioFormats();
+        return Result::ok();
+    }
+
+    Result perform() override
+    {
+        TemporaryFile tempFile (target);
+        std::unique_ptr<FileOutputStream> stream (tempFile.getFile().createOutputStream());
+        if (stream == nullptr || stream->failedToOpen())
+            return Result::fail ("could not open soundfont for writing");
+
+        SF2Writer sf2 (*stream);
+        auto result = sf2.begin (name);
+
+        for (int i = 0; result.wasOk() && i < regions.size(); ++i)
+            result = writeRegion (sf2, regions.getReference (i));
+
+        if (result.wasOk())
+            result = sf2.finish (name);
+        stream.reset();
+
+        if (result.failed())
+            return result;
+        return tempFile.overwriteTargetFileWithTemporary()
+            ? Result::ok() : Result::fail ("could not write soundfont");
+    }
+
+    String getProgressName() const override { return target.getFileName(); }
+    File getOutputFile() const override { return target; }
+
+    String getFingerprint() const override
+    {
+        String text;
+        text << name << "|" << (int) loop << "|" << dither;
+        for (const auto& region : regions)
+            text << "|" << region.file.getFullPathName()
+                 << "|" << region.file.getSize()
+                 << "|" << region.file.getLastModificationTime().toMilliseconds()
+                 << "|" << region.lowKey << "|" << region.highKey
+                 << "|" << region.lowVelocity << "|" << region.highVelocity
+                 << "|" << region.startTime << "|" << region.endTime
+                 << "|" << region.loopStart << "|" << region.loopEnd;
+        return SHA256 (text.toUTF8()).toHexString();
+    }
+
+private:
+    const File target;
+    const String name;
+    const Array<InstrumentRegion> regions;
+    const bool loop;
+    const int dither;
+    AudioFormatManager* formats = nullptr;
+
+    /** Streams one region into the bank, stereo files become a linked pair
+        of mono samples */
+    Result writeRegion (SF2Writer& sf2, const InstrumentRegion& region)
+    {
+        jassert (formats != nullptr);
+        std::unique_ptr<AudioFormatReader> reader (formats->createReaderFor (region.file));
+        if (reader == nullptr)
+            return Result::fail (String ("cannot create decoder for ") + region.file.getFileName());
+
+        const int numChannels = jmin (2, (int) reader->numChannels);
+        const int64 startFrame = roundToIntAccurate (jmax (0.0, region.startTime) * reader->sampleRate);
+        const int64 endFrame = region.endTime > region.startTime
+            ? roundToIntAccurate (region.endTime * reader->sampleRate) : reader->lengthInSamples;
+        const bool looped = loop && region.hasLoop();
+
+        const int blockSize = 8192;
+        AudioSampleBuffer buffer (numChannels, blockSize);
+        HeapBlock<int> converted (blockSize);
+        HeapBlock<int16> points (blockSize);
+        SampleConverter converter;
+        int ids[2] = { -1, -1 };
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            String sampleName = region.name;
+            if (numChannels > 1)
+                sampleName = sampleName.substring (0, 17) + (channel == 0 ? "_L" : "_R");
+            ids[channel] = sf2.beginSample (sampleName, reader->sampleRate, region.note);
+            converter.prepare (1, 16, dither);
+
+            for (int64 frame = startFrame; frame < endFrame;)
+            {
+                const int numFrames = (int) jmin ((int64) blockSize, endFrame - frame);
+                reader->read (&buffer, 0, numFrames, frame, true, numChannels > 1);
+
+                const float* input[] = { buffer.getReadPointer (channel) };
+                int* output[] = { converted.get() };
+                converter.convert (input, output, numFrames);
+                for (int i = 0; i < numFrames; ++i)
+                    points[i] = static_cast<int16> (converted[i] >> 16);
+
+                if (! sf2.writeSampleData (points, numFrames))
+                    return Result::fail ("could not write soundfont sample data");
+                frame += numFrames;
+            }
+
+            if (looped)
+                sf2.endSample (region.getFrame (region.loopStart), region.getFrame (region.loopEnd));
+            else
+                sf2.endSample();
+        }
+
+        if (numChannels > 1)
+            sf2.linkSamples (ids[0], ids[1]);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            SF2Writer::Zone zone;
+            zone.sampleIndex    = ids[channel];
+            zone.lowKey         = region.lowKey;
+            zone.highKey        = region.highKey;
+            zone.lowVelocity    = region.lowVelocity;
+            zone.highVelocity   = region.highVelocity;
+            zone.pan            = numChannels > 1 ? (channel == 0 ? -500 : 500) : 0;
+            zone.loop           = looped;
+            sf2.addZone (zone);
+        }
+
+        return Result::ok();
+    }
+};
+
+class Sf2ExporterType : public ExporterType
+{
+public:
+    Sf2ExporterType() = default;
+
+    String getSlug() const override { return "sf2"; }
+    String getName() const override { return "SoundFont 2"; }
+
+    void getLoopTypes (Array<LoopType>& types) const override
+    {
+        types.addArray ({ LoopType::None, LoopType::Forwards });
+    }
+
+    void getProperties (const Exporter& exporter, Array<PropertyComponent*>& props) const override
+    {
+        Exporter expref = exporter;
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::dither),
+            "Dither", { "Off", "TPDF", "TPDF + Shaping" }, { 0, 1, 2 }));
+    }
+
+    void getTasks (const Project& project, const Exporter& exporter,
+                   OwnedArray<ExportTask>& tasks) const override
+    {
+        Array<InstrumentRegion> regions;
+        InstrumentRegion::getRegions (project, regions);
+        const auto name = InstrumentRegion::getInstrumentName (project);
+        const LoopType loopType (LoopType::fromSlug (exporter.getProperty (Tags::loop).toString()));
+        tasks.add (new Sf2WriterTask (
+            exporter.getPath().getChildFile (File::createLegalFileName (name) + ".sf2"),
+            name, regions, loopType == LoopType::Forwards,
+            exporter.getProperty (Tags::dither, 0)));
+    }
+
+protected:
+    void setMissingProperties (ValueTree data) const override
+    {
+        if (! data.hasProperty (Tags::dither))
+            data.setProperty (Tags::dither, 1, nullptr);
+        if (! data.hasProperty (Tags::loop))
+            data.setProperty (Tags::loop, LoopType (LoopType::Forwards).getSlug(), nullptr);
+    }
+};
+
+//=============================================================================
+class ContainerWriterTask : public ExportTask
+{
+public:
+    ContainerWriterTask (const File& tgt, const String& instrumentName,
+                         const Array<InstrumentRegion>& regionsToWrite,
+                         int encodingType, bool shouldInterleave,
+                         bool shouldLoop, int ditherType)
+        : target (tgt), name (instrumentName), regions (regionsToWrite),
+          encoding (encodingType), interleaved (shouldInterleave),
+          loop (shouldLoop), dither (ditherType) { }
+
+    Result prepare (Versicap& versicap) override
+    {
+        if (target == File())
+            return Result::fail ("target not specified for export");
+        formats = &versicap.getAudioFormats();
+        return Result::ok();
+    }
+
+    Result perform() override
+    {
+        jassert (formats != nullptr);
+
+        // lengths are needed up front to lay out the file
+        Array<ContainerWriter::RegionInfo> infos;
+        Array<Range<int64>> frames;
+        for (const auto& region : regions)
+        {
+            std::unique_ptr<AudioFormatReader> reader (formats->createReaderFor (region.file));
+            if (reader == nullptr)
+                return Result::fail (String ("cannot create decoder for ") + region.file.getFileName());
+
+            const int64 startFrame = roundToIntAccurate (jmax (0.0, region.startTime) * reader->sampleRate);
+            const int64 endFrame = region.endTime > region.startTime
+                ? jmin (reader->lengthInSamples, (int64) roundToIntAccurate (region.endTime * reader->sampleRate))
+                : reader->lengthInSamples;
+            frames.add ({ startFrame, jmax (startFrame, endFrame) });
+
+            ContainerWriter::RegionInfo info;
+            info.name           = region.name;
+            info.note           = region.note;
+            info.lowKey         = region.lowKey;
+            info.highKey        = region.highKey;
+            info.lowVelocity    = region.lowVelocity;
+            info.highVelocity   = region.highVelocity;
+            info.numChannels    = jmin (2, (int) reader->numChannels);
+            info.numFrames      = frames.getLast().getLength();
+            info.sampleRate     = reader->sampleRate;
+            if (loop && region.hasLoop())
+            {
+                info.loopStart  = region.getFrame (region.loopStart);
+                info.loopEnd    = region.getFrame (region.loopEnd);
+            }
+            infos.add (info);
+        }
+
+        TemporaryFile tempFile (target);
+        std::unique_ptr<FileOutputStream> stream (tempFile.getFile().createOutputStream());
+        if (stream == nullptr || stream->failedToOpen())
+            return Result::fail ("could not open container for writing");
+
+        ContainerWriter writer (*stream, infos, encoding, interleaved, dither);
+        auto result = writer.begin (name);
+
+        const int blockSize = 8192;
+        AudioSampleBuffer buffer (2, blockSize);
+        for (int i = 0; result.wasOk() && i < regions.size(); ++i)
+        {
+            std::unique_ptr<AudioFormatReader> reader (formats->createReaderFor (regions.getReference (i).file));
+            if (reader == nullptr)
+                return Result::fail ("source sample disappeared while exporting");
+
+            result = writer.beginRegion();
+            const auto range = frames [i];
+            for (int64 frame = range.getStart(); result.wasOk() && frame < range.getEnd();)
+            {
+                const int numFrames = (int) jmin ((int64) blockSize, range.getEnd() - frame);
+                reader->read (&buffer, 0, numFrames, frame, true, infos.getReference (i).numChannels > 1);
+                if (! writer.writeFrames (buffer.getArrayOfReadPointers(), numFrames))
+                    result = Result::fail ("could not write container audio");
+                frame += numFrames;
+            }
+
+            if (result.wasOk())
+                result = writer.endRegion();
+        }
+
+        if (result.wasOk())
+            result = writer.finish();
+        stream.reset();
+
+        if (result.failed())
+            return result;
+        return tempFile.overwriteTargetFileWithTemporary()
+            ? Result::ok() : Result::fail ("could not write container");
+    }
+
+    String getProgressName() const override { return target.getFileName(); }
+    File getOutputFile() const override { return target; }
+
+    String getFingerprint() const override
+    {
+        String text;
+        text << name << "|" << encoding << "|" << (int) interleaved
+             << "|" << (int) loop << "|" << dither;
+        for (const auto& region : regions)
+            text << "|" << region.file.getFullPathName()
+                 << "|" << region.file.getSize()
+                 << "|" << region.file.getLastModificationTime().toMilliseconds()
+                 << "|" << region.lowKey << "|" << region.highKey
+                 << "|" << region.lowVelocity << "|" << region.highVelocity
+                 << "|" << region.startTime << "|" << region.endTime
+                 << "|" << region.loopStart << "|" << region.loopEnd;
+        return SHA256 (text.toUTF8()).toHexString();
+    }
+
+private:
+    const File target;
+    const String name;
+    const Array<InstrumentRegion> regions;
+    const int encoding;
+    const bool interleaved;
+    const bool loop;
+    const int dither;
+    AudioFormatManager* formats = nullptr;
+};
+
+class ContainerExporterType : public ExporterType
+{
+public:
+    ContainerExporterType() = default;
+
+    String getSlug() const override { return "vcpi"; }
+    String getName() const override { return "Instrument Container"; }
+
+    void getLoopTypes (Array<LoopType>& types) const override
+    {
+        types.addArray ({ LoopType::None, LoopType::Forwards });
+    }
+
+    void getProperties (const Exporter& exporter, Array<PropertyComponent*>& props) const override
+    {
+        Exporter expref = exporter;
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::bitDepth),
+            "Sample Format", { "16 bit", "32 bit float" }, { 16, 32 }));
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::dither),
+            "Dither", { "Off", "TPDF", "TPDF + Shaping" }, { 0, 1, 2 }));
+        props.add (new BooleanPropertyComponent (expref.getPropertyAsValue (Tags::interleaved),
+            "Interleaved", "Interleave channels"));
+    }
+
+    void getTasks (const Project& project, const Exporter& exporter,
+                   OwnedArray<ExportTask>& tasks) const override
+    {
+        Array<InstrumentRegion> regions;
+        InstrumentRegion::getRegions (project, regions);
+        const auto name = InstrumentRegion::getInstrumentName (project);
+        const LoopType loopType (LoopType::fromSlug (exporter.getProperty (Tags::loop).toString()));
+        const int encoding = (int) exporter.getProperty (Tags::bitDepth, 16) == 32
+            ? ContainerFormat::Float32 : ContainerFormat::Int16;
+        tasks.add (new ContainerWriterTask (
+            exporter.getPath().getChildFile (File::createLegalFileName (name) + ".vcpi"),
+            name, regions, encoding,
+            (bool) exporter.getProperty (Tags::interleaved, true),
+            loopType == LoopType::Forwards,
+            exporter.getProperty (Tags::dither, 0)));
+    }
+
+protected:
+    void setMissingProperties (ValueTree data) const override
+    {
+        if (! data.hasProperty (Tags::bitDepth))
+            data.setProperty (Tags::bitDepth, 16, nullptr);
+        if (! data.hasProperty (Tags::dither))
+            data.setProperty (Tags::dither, 1, nullptr);
+        if (! data.hasProperty (Tags::interleaved))
+            data.setProperty (Tags::interleaved, true, nullptr);
+        if (! data.hasProperty (Tags::loop))
+            data.setProperty (Tags::loop, LoopType (LoopType::Forwards).getSlug(), nullptr);
+    }
+};
+
+ExporterType* ExporterType::createSfzExporterType()
+{
+    return new SfzExporterType();
+}
+
+ExporterType* ExporterType::createSf2ExporterType()
+{
+    return new Sf2ExporterType();
+}
+
+ExporterType* ExporterType::createContainerExporterType()
+{
+    return new ContainerExporterType();
+}
+
+}
@@ -0,0 +1,85 @@
+#include "exporters/InstrumentRegion.h"
+#include "Project.h"
+
+namespace vcp {
+
+void InstrumentRegion::getRegions (const Project& project, Array<InstrumentRegion>& regions)
+{
+    const int step = jmax (1, (int) project.getProperty (Tags::noteStep, 4));
+
+    Array<SampleSet> layers;
+    for (int i = 0; i < project.getNumSampleSets(); ++i)
+        layers.add (project.getSampleSet (i));
+    std::stable_sort (layers.begin(), layers.end(), [](const SampleSet& a, const SampleSet& b) {
+        return a.getVelocity() < b.getVelocity();
+    });
+
+    int lastVelocity = 0, lowVelocity = 1;
+    for (int layerIdx = 0; layerIdx < layers.size(); ++layerIdx)
+    {
+        const auto& layer = layers.getReference (layerIdx);
+        const int velocity = jlimit (1, 127, (int) layer.getVelocity());
+        if (velocity != lastVelocity)
+            lowVelocity = lastVelocity + 1;
+        lastVelocity = velocity;
+        const int highVelocity = layerIdx == layers.size() - 1 ? 127 : velocity;
+
+        OwnedArray<Sample> samples;
+        layer.getSamples (samples);
+
+        for (const auto& rigId : project.getCaptureRigIds())
+        {
+            Array<const Sample*> notes;
+            for (const auto* const sample : samples)
+                if (sample->getRigUuidString() == rigId && ! sample->isEmpty() &&
+                    sample->getFile().existsAsFile())
+                    notes.add (sample);
+            std::sort (notes.begin(), notes.end(), [](const Sample* a, const Sample* b) {
+                return a->getNote() < b->getNote();
+            });
+
+            const Rig rig (project.findRig (rigId));
+            String group = layer.getName();
+            if (rig.isValid())
+                group << " - " << rig.getName();
+
+            for (int i = 0; i < notes.size(); ++i)
+            {
+                const auto& sample = *notes.getUnchecked (i);
+                InstrumentRegion region;
+                region.file         = sample.getFile();
+                region.name         = sample.getFileName();
+                region.group        = group;
+                region.note         = sample.getNote();
+                region.lowKey       = i == 0 ? region.note - step / 2
+                                             : regions.getLast().highKey + 1;
+                region.highKey      = i == notes.size() - 1 ? region.note + (step - 1) / 2
+                    : region.note + (notes.getUnchecked (i + 1)->getNote() - region.note - 1) / 2;
+                region.lowKey       = jlimit (0, 127, region.lowKey);
+                region.highKey      = jlimit (0, 127, region.highKey);
+                region.lowVelocity  = lowVelocity;
+                region.highVelocity = highVelocity;
+                region.sampleRate   = sample.getSampleRate() > 0.0 ? sample.getSampleRate() : 44100.0;
+                region.numChannels  = sample.getNumChannels() > 0 ? sample.getNumChannels()
+                                                                  : (int) project.getProperty (Tags::channels, 2);
+                region.startTime    = sample.getStartTime();
+                region.endTime      = sample.getEndTime();
+                if (sample.hasLoop())
+                {
+                    region.loopStart = sample.getLoopStart();
+                    region.loopEnd   = sample.getLoopEnd();
+                }
+
+                regions.add (region);
+            }
+        }
+    }
+}
+
+String InstrumentRegion::getInstrumentName (const Project& project)
+{
+    const auto name = project.getProperty (Tags::name).toString();
+    return name.isNotEmpty() ? name : String ("Instrument");
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+class Project;
+
+/** A sample mapped to keys and velocities of an instrument */
+struct InstrumentRegion
+{
+    File file;
+    String name;
+    String group;
+    int note            = 60;
+    int lowKey          = 0;
+    int highKey         = 127;
+    int lowVelocity     = 1;
+    int highVelocity    = 127;
+    double sampleRate   = 44100.0;
+    int numChannels     = 2;
+    double startTime    = 0.0;
+    double endTime      = 0.0;
+    double loopStart    = -1.0;
+    double loopEnd      = -1.0;
+
+    bool hasLoop() const { return loopStart >= 0.0 && loopEnd > loopStart; }
+
+    /** Returns a loop point in frames relative to the region start */
+    int64 getFrame (double seconds) const
+    {
+        return roundToIntAccurate ((seconds - jmax (0.0, startTime)) * sampleRate);
+    }
+
+    /** Maps the project's samples to regions. Layers become velocity ranges
+        in order of their velocity and each rig gets its own group. Key
+        ranges are split half way between captured notes and the outer notes
+        extend by half the note step */
+    static void getRegions (const Project& project, Array<InstrumentRegion>& regions);
+
+    /** Returns the project name or a default one */
+    static String getInstrumentName (const Project& project);
+};
+
+}
@@ -0,0 +1,312 @@
+#include "engine/SampleConverter.h"
+#include "exporters/Exporter.h"
+#include "exporters/ExportTasks.h"
+#include "exporters/InstrumentRegion.h"
+#include "vcp/PluginInstance.h"
+#include "BundleManager.h"
+#include "Project.h"
+#include "Versicap.h"
+
+namespace vcp {
+
+//=============================================================================
+/** Streams regions through a processor plugin, a few at a time. Every task
+    has its own plugin instance so tasks can be processed in parallel */
+class PluginExportTask : public ExportTask
+{
+public:
+    PluginExportTask (const String& pluginId, const File& dir,
+                      const Array<InstrumentRegion>& regionsToProcess,
+                      bool shouldLoop, int depth, int ditherType)
+        : identifier (pluginId), directory (dir), regions (regionsToProcess),
+          loop (shouldLoop), bitDepth (depth), dither (ditherType) { }
+
+    ~PluginExportTask()
+    {
+        streams.clear (true);
+        instance.reset();
+    }
+
+    Result prepare (Versicap& versicap) override
+    {
+        if (directory == File())
+            return Result::fail ("target not specified for export");
+
+        instance.reset (versicap.getBundleManager().createInstance (identifier));
+        if (instance == nullptr)
+            return Result::fail (String ("could not load plugin ") + identifier);
+        processor = instance->getProcessor();
+        if (processor == nullptr)
+            return Result::fail (String ("plugin doesn't support exporting: ") + identifier);
+
+        formats = &versicap.getAudioFormats();
+        return Result::ok();
+    }
+
+    Result perform() override
+    {
+        jassert (processor != nullptr && formats != nullptr);
+        const auto handle = instance->getHandle();
+        if (processor->prepare != nullptr &&
+            processor->prepare (handle, directory.getFullPathName().toRawUTF8(), blockSize) != 0)
+            return Result::fail ("plugin failed to prepare");
+
+        for (int i = 0; i < regions.size(); i += maxStreams)
+        {
+            for (int j = i; j < jmin (regions.size(), i + maxStreams); ++j)
+            {
+                auto result = openStream (regions.getReference (j));
+                if (result.failed())
+                    return result;
+            }
+
+            auto result = processStreams (handle);
+            streams.clear (true);
+            if (result.failed())
+                return result;
+        }
+
+        if (processor->finish != nullptr && processor->finish (handle) != 0)
+            return Result::fail ("plugin failed to finish exporting");
+
+        return Result::ok();
+    }
+
+    String getProgressName() const override
+    {
+        return regions.isEmpty() ? identifier : regions.getReference(0).name;
+    }
+
+    bool canRunInParallel() const override { return true; }
+
+private:
+    enum { blockSize = 4096, maxStreams = 8 };
+
+    const String identifier;
+    const File directory;
+    const Array<InstrumentRegion> regions;
+    const bool loop;
+    const int bitDepth;
+    const int dither;
+    AudioFormatManager* formats = nullptr;
+    std::unique_ptr<PluginInstance> instance;
+    const VCPProcessor* processor = nullptr;
+
+    struct Stream;
+    OwnedArray<Stream> streams;
+
+    /** Runs the open streams through the plugin until each one finished */
+    Result processStreams (VCPHandle handle)
+    {
+        // every pass hands the plugin one block of each unfinished region
+        Array<VCPBuffer> batch;
+        for (;;)
+        {
+            batch.clearQuick();
+            for (auto* const stream : streams)
+            {
+                stream->numFrames = (int) jmin ((int64) blockSize, stream->endFrame - stream->position);
+                if (stream->numFrames <= 0)
+                    continue;
+
+                stream->reader->read (&stream->buffer, 0, stream->numFrames, stream->position, true, true);
+                VCPBuffer buffer;
+                buffer.info         = &stream->info;
+                buffer.channels     = stream->buffer.getArrayOfWritePointers();
+                buffer.num_channels = stream->buffer.getNumChannels();
+                buffer.num_frames   = stream->numFrames;
+                buffer.offset       = stream->position - stream->startFrame;
+                buffer.flags        = (buffer.offset == 0 ? VCP_BUFFER_FIRST : 0)
+                    | (stream->position + stream->numFrames >= stream->endFrame ? VCP_BUFFER_LAST : 0);
+                batch.add (buffer);
+                stream->position += stream->numFrames;
+            }
+
+            if (batch.isEmpty())
+                break;
+
+            if (processor->process (handle, batch.getRawDataPointer(), (uint32) batch.size()) != 0)
+                return Result::fail ("plugin failed to process samples");
+
+            for (auto* const stream : streams)
+                if (stream->numFrames > 0 && stream->writer != nullptr && ! stream->write())
+                    return Result::fail (String ("could not write ") + stream->region.name);
+        }
+
+        for (auto* const stream : streams)
+        {
+            if (stream->writer == nullptr)
+                continue;
+            stream->writer.reset();
+            if (! stream->tempFile->overwriteTargetFileWithTemporary())
+                return Result::fail (String ("could not write ") + stream->region.name);
+        }
+
+        return Result::ok();
+    }
+
+    struct Stream
+    {
+        Stream (const InstrumentRegion& r) : region (r) { }
+
+        const InstrumentRegion& region;
+        String name, source;
+        VCPSampleInfo info;
+        std::unique_ptr<AudioFormatReader> reader;
+        AudioSampleBuffer buffer;
+        int64 startFrame = 0, endFrame = 0, position = 0;
+        int numFrames = 0;
+
+        std::unique_ptr<TemporaryFile> tempFile;
+        std::unique_ptr<AudioFormatWriter> writer;
+        std::unique_ptr<SampleConverter> converter;
+        HeapBlock<int> converted;
+        HeapBlock<int*> channels;
+
+        bool write()
+        {
+            if (converter == nullptr)
+                return writer->writeFromAudioSampleBuffer (buffer, 0, numFrames);
+            converter->convert (buffer.getArrayOfReadPointers(), channels, numFrames);
+            return writer->write (const_cast<const int**> (channels.get()), numFrames);
+        }
+    };
+
+    Result openStream (const InstrumentRegion& region)
+    {
+        std::unique_ptr<Stream> stream (new Stream (region));
+        stream->reader.reset (formats->createReaderFor (region.file));
+        auto* const reader = stream->reader.get();
+        if (reader == nullptr)
+            return Result::fail (String ("cannot create decoder for ") + region.file.getFileName());
+
+        stream->startFrame = roundToIntAccurate (jmax (0.0, region.startTime) * reader->sampleRate);
+        stream->endFrame = region.endTime > region.startTime
+            ? jmin (reader->lengthInSamples, (int64) roundToIntAccurate (region.endTime * reader->sampleRate))
+            : reader->lengthInSamples;
+        stream->position = stream->startFrame;
+        stream->buffer.setSize ((int) reader->numChannels, blockSize);
+
+        stream->name = region.name;
+        stream->source = region.file.getFullPathName();
+        auto& info = stream->info;
+        zerostruct (info);
+        info.name           = stream->name.toRawUTF8();
+        info.source         = stream->source.toRawUTF8();
+        info.note           = region.note;
+        info.low_key        = region.lowKey;
+        info.high_key       = region.highKey;
+        info.low_velocity   = region.lowVelocity;
+        info.high_velocity  = region.highVelocity;
+        info.sample_rate    = reader->sampleRate;
+        info.num_channels   = (int32_t) reader->numChannels;
+        info.num_frames     = jmax ((int64) 0, stream->endFrame - stream->startFrame);
+        info.loop_start     = loop && region.hasLoop() ? region.getFrame (region.loopStart) : -1;
+        info.loop_end       = loop && region.hasLoop() ? region.getFrame (region.loopEnd) : -1;
+
+        // plugins without their own format get processed audio written back
+        if (processor->file_extension == nullptr)
+        {
+            auto* format = formats->findFormatForFileExtension ("wav");
+            if (format == nullptr)
+                return Result::fail ("wave format not available");
+
+            stream->tempFile.reset (new TemporaryFile (directory.getChildFile (region.name + ".wav")));
+            std::unique_ptr<FileOutputStream> out (stream->tempFile->getFile().createOutputStream());
+            if (out == nullptr || out->failedToOpen())
+                return Result::fail (String ("could not open ") + region.name);
+            stream->writer.reset (format->createWriterFor (out.get(), reader->sampleRate,
+                reader->numChannels, bitDepth, {}, 0));
+            if (stream->writer == nullptr)
+                return Result::fail (String ("cannot create encoder for ") + region.name);
+            out.release();
+
+            const int numChannels = (int) reader->numChannels;
+            if (! stream->writer->isFloatingPoint() && (bitDepth == 16 || bitDepth == 24 || bitDepth == 32))
+            {
+                stream->converter.reset (new SampleConverter());
+                stream->converter->prepare (numChannels, bitDepth, dither);
+                stream->converted.malloc ((size_t) (numChannels * blockSize));
+                stream->channels.calloc ((size_t) numChannels + 1);
+                for (int c = 0; c < numChannels; ++c)
+                    stream->channels[c] = stream->converted + c * blockSize;
+            }
+        }
+
+        streams.add (stream.release());
+        return Result::ok();
+    }
+};
+
+//=============================================================================
+/** Exports through a processor plugin found in a .vcp bundle */
+class PluginExporterType : public ExporterType
+{
+public:
+    PluginExporterType (const String& pluginId, const String& pluginName, const String& ext)
+        : identifier (pluginId), name (pluginName), fileExtension (ext) { }
+
+    String getSlug() const override { return String ("plugin:") + identifier; }
+    String getName() const override { return name; }
+
+    void getLoopTypes (Array<LoopType>& types) const override
+    {
+        types.addArray ({ LoopType::None, LoopType::Forwards });
+    }
+
+    void getProperties (const Exporter& exporter, Array<PropertyComponent*>& props) const override
+    {
+        Exporter expref = exporter;
+        if (fileExtension.isEmpty())
+            props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::bitDepth),
+                "Bit Depth", { "16 bit", "24 bit", "32 bit float" }, { 16, 24, 32 }));
+        props.add (new ChoicePropertyComponent (expref.getPropertyAsValue (Tags::dither),
+            "Dither", { "Off", "TPDF", "TPDF + Shaping" }, { 0, 1, 2 }));
+    }
+
+    void getTasks (const Project& project, const Exporter& exporter,
+                   OwnedArray<ExportTask>& tasks) const override
+    {
+        Array<InstrumentRegion> regions;
+        InstrumentRegion::getRegions (project, regions);
+        const LoopType loopType (LoopType::fromSlug (exporter.getProperty (Tags::loop).toString()));
+
+        // a plugin writing its own format gets every region in one instance,
+        // so it can produce a single file. Host written files are split up
+        const int batchSize = fileExtension.isEmpty() ? 8 : jmax (1, regions.size());
+        for (int i = 0; i < regions.size(); i += batchSize)
+        {
+            Array<InstrumentRegion> batch;
+            for (int j = i; j < jmin (regions.size(), i + batchSize); ++j)
+                batch.add (regions.getReference (j));
+            tasks.add (new PluginExportTask (identifier, exporter.getPath(), batch,
+                loopType == LoopType::Forwards,
+                exporter.getProperty (Tags::bitDepth, 24),
+                exporter.getProperty (Tags::dither, 0)));
+        }
+    }
+
+protected:
+    void setMissingProperties (ValueTree data) const override
+    {
+        if (! data.hasProperty (Tags::bitDepth))
+            data.setProperty (Tags::bitDepth, 24, nullptr);
+        if (! data.hasProperty (Tags::dither))
+            data.setProperty (Tags::dither, 1, nullptr);
+        if (! data.hasProperty (Tags::loop))
+            data.setProperty (Tags::loop, LoopType (LoopType::Forwards).getSlug(), nullptr);
+    }
+
+private:
+    const String identifier;
+    const String name;
+    const String fileExtension;
+};
+
+ExporterType* ExporterType::createPluginExporterType (const String& identifier, const String& name,
+                                                      const String& fileExtension)
+{
+    return new PluginExporterType (identifier, name, fileExtension);
+}
+
+}
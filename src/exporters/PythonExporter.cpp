@@ -0,0 +1,332 @@
+#include "exporters/PythonExporter.h"
+
+#if VCP_PYTHON
+
+#include <pybind11/embed.h>
+#include <pybind11/numpy.h>
+
+#include "exporters/InstrumentRegion.h"
+#include "Project.h"
+#include "Versicap.h"
+
+namespace py = pybind11;
+
+namespace vcp {
+
+/** Decoded audio of one sample, channels laid out one after another. Python
+    owns it once handed to a script and sees it through the buffer protocol */
+struct PythonSampleData
+{
+    PythonSampleData (int channels, int frames)
+        : numChannels (channels), numFrames (frames)
+    {
+        data.allocate ((size_t) jmax (1, channels * frames), true);
+    }
+
+    float* getChannel (int channel) { return data + (size_t) channel * (size_t) numFrames; }
+
+    const int numChannels;
+    const int numFrames;
+    HeapBlock<float> data;
+};
+
+}
+
+PYBIND11_EMBEDDED_MODULE (versicap, m)
+{
+    using vcp::PythonSampleData;
+    py::class_<PythonSampleData> (m, "SampleData", py::buffer_protocol())
+        .def_readonly ("channels", &PythonSampleData::numChannels)
+        .def_readonly ("frames", &PythonSampleData::numFrames)
+        .def_buffer ([](PythonSampleData& sd) -> py::buffer_info {
+            return py::buffer_info (sd.data.get(), sizeof (float),
+                py::format_descriptor<float>::format(), 2,
+                { (py::ssize_t) sd.numChannels, (py::ssize_t) sd.numFrames },
+                { (py::ssize_t) (sizeof (float) * (size_t) sd.numFrames), (py::ssize_t) sizeof (float) });
+        });
+}
+
+namespace vcp {
+
+//=============================================================================
+Result PythonInterpreter::start()
+{
+    if (isRunning())
+        return Result::ok();
+
+    try
+    {
+        py::initialize_interpreter();
+    }
+    catch (const std::exception& e)
+    {
+        return Result::fail (String ("could not start python: ") + e.what());
+    }
+
+    // scripts take the GIL on the export thread
+    mainThreadState = PyEval_SaveThread();
+    DBG("[VCP] python " << Py_GetVersion());
+    return Result::ok();
+}
+
+void PythonInterpreter::stop()
+{
+    if (! isRunning())
+        return;
+    PyEval_RestoreThread (static_cast<PyThreadState*> (mainThreadState));
+    mainThreadState = nullptr;
+    py::finalize_interpreter();
+}
+
+//=============================================================================
+/** Runs a script over every sample of the project. The script defines
+
+        def process (sample, audio)
+
+    and optionally begin (project) and finish (project). audio is a float32
+    NumPy array of shape (channels, frames) viewing the decoded sample, or
+    the buffer object itself when NumPy isn't installed. The GIL is
+    released while samples are decoded */
+class PythonExportTask : public ExportTask
+{
+public:
+    PythonExportTask (PythonInterpreter& py, const File& scriptFile, const File& dir,
+                      const String& instrumentName, const Array<InstrumentRegion>& regionsToProcess,
+                      bool shouldLoop)
+        : interpreter (py), script (scriptFile), directory (dir),
+          name (instrumentName), regions (regionsToProcess), loop (shouldLoop) { }
+
+    Result prepare (Versicap& versicap) override
+    {
+        if (! script.existsAsFile())
+            return Result::fail ("python script not found");
+        formats = &versicap.getAudioFormats();
+        source = script.loadFileAsString();
+        return interpreter.start();
+    }
+
+    Result perform() override
+    {
+        jassert (interpreter.isRunning() && formats != nullptr);
+        py::gil_scoped_acquire gil;
+
+        try
+        {
+            return run();
+        }
+        catch (const std::exception& e)
+        {
+            String message ("python: ");
+            message << e.what();
+            return Result::fail (message);
+        }
+    }
+
+    String getProgressName() const override { return script.getFileName(); }
+
+private:
+    PythonInterpreter& interpreter;
+    const File script;
+    const File directory;
+    const String name;
+    const Array<InstrumentRegion> regions;
+    const bool loop;
+    AudioFormatManager* formats = nullptr;
+    String source;
+
+    /** Called with the GIL held */
+    Result run()
+    {
+        py::module::import ("versicap");
+        bool hasNumpy = true;
+        try { py::module::import ("numpy"); }
+        catch (const py::error_already_set&) { hasNumpy = false; }
+
+        py::dict globals;
+        globals["__builtins__"] = py::module::import ("builtins");
+        globals["__file__"]     = script.getFullPathName().toStdString();
+        globals["__name__"]     = "__versicap__";
+        py::exec (source.toStdString(), globals);
+
+        if (! globals.contains ("process"))
+            return Result::fail ("python script doesn't define process()");
+        py::object process = globals["process"];
+
+        py::dict project;
+        project["name"]         = name.toStdString();
+        project["path"]         = directory.getFullPathName().toStdString();
+        project["num_samples"]  = regions.size();
+        project["loop"]         = loop;
+
+        if (globals.contains ("begin"))
+            globals["begin"] (project);
+
+        for (int i = 0; i < regions.size(); ++i)
+        {
+            const auto& region = regions.getReference (i);
+            std::unique_ptr<PythonSampleData> data;
+            double sampleRate = 0.0;
+            {
+                py::gil_scoped_release release;
+                data = decode (region, sampleRate);
+            }
+
+            if (data == nullptr)
+                return Result::fail (String ("cannot read ") + region.file.getFileName());
+
+            py::dict sample;
+            sample["index"]         = i;
+            sample["name"]          = region.name.toStdString();
+            sample["file"]          = region.file.getFullPathName().toStdString();
+            sample["group"]         = region.group.toStdString();
+            sample["note"]          = region.note;
+            sample["low_key"]       = region.lowKey;
+            sample["high_key"]      = region.highKey;
+            sample["low_velocity"]  = region.lowVelocity;
+            sample["high_velocity"] = region.highVelocity;
+            sample["sample_rate"]   = sampleRate;
+            sample["loop_start"]    = loop && region.hasLoop() ? region.getFrame (region.loopStart) : (int64) -1;
+            sample["loop_end"]      = loop && region.hasLoop() ? region.getFrame (region.loopEnd) : (int64) -1;
+
+            // the array's base owns the decoded audio, nothing is copied
+            auto* const raw = data.get();
+            py::object owner = py::cast (data.release(), py::return_value_policy::take_ownership);
+            if (hasNumpy)
+            {
+                py::array_t<float> audio ({ (py::ssize_t) raw->numChannels, (py::ssize_t) raw->numFrames },
+                                          { (py::ssize_t) (sizeof (float) * (size_t) raw->numFrames), (py::ssize_t) sizeof (float) },
+                                          raw->data.get(), owner);
+                process (sample, audio);
+            }
+            else
+            {
+                process (sample, owner);
+            }
+        }
+
+        if (globals.contains ("finish"))
+            globals["finish"] (project);
+
+        return Result::ok();
+    }
+
+    /** Decodes a region, called without the GIL */
+    std::unique_ptr<PythonSampleData> decode (const InstrumentRegion& region, double& sampleRate) const
+    {
+        std::unique_ptr<AudioFormatReader> reader (formats->createReaderFor (region.file));
+        if (reader == nullptr)
+            return nullptr;
+
+        const int64 startFrame = roundToIntAccurate (jmax (0.0, region.startTime) * reader->sampleRate);
+        const int64 endFrame = region.endTime > region.startTime
+            ? jmin (reader->lengthInSamples, (int64) roundToIntAccurate (region.endTime * reader->sampleRate))
+            : reader->lengthInSamples;
+        const int numFrames = (int) jmax ((int64) 0, endFrame - startFrame);
+        const int numChannels = (int) reader->numChannels;
+
+        std::unique_ptr<PythonSampleData> data (new PythonSampleData (numChannels, numFrames));
+        HeapBlock<float*> channels ((size_t) numChannels);
+        for (int c = 0; c < numChannels; ++c)
+            channels[c] = data->getChannel (c);
+        AudioSampleBuffer buffer (channels, numChannels, numFrames);
+        reader->read (&buffer, 0, numFrames, startFrame, true, true);
+
+        sampleRate = reader->sampleRate;
+        return data;
+    }
+};
+
+//=============================================================================
+class ScriptPropertyComponent : public PropertyComponent,
+                                private FilenameComponentListener,
+                                private Value::Listener
+{
+public:
+    ScriptPropertyComponent (const Value& valueToControl)
+        : PropertyComponent ("Script"),
+          file ("Script", File(), false, false, false,
+                "*.py", String(), "Python script to run")
+    {
+        addAndMakeVisible (file);
+        file.addListener (this);
+        value.referTo (valueToControl);
+        value.addListener (this);
+        refresh();
+    }
+
+    void refresh() override
+    {
+        const String path = value.getValue().toString();
+        if (File::isAbsolutePath (path))
+            file.setCurrentFile (File (path), dontSendNotification);
+    }
+
+private:
+    FilenameComponent file;
+    Value value;
+
+    void valueChanged (Value&) override { refresh(); }
+    void filenameComponentChanged (FilenameComponent*) override
+    {
+        value.removeListener (this);
+        value.setValue (file.getCurrentFile().getFullPathName());
+        value.addListener (this);
+    }
+};
+
+//=============================================================================
+class PythonExporterType : public ExporterType
+{
+public:
+    PythonExporterType() = default;
+
+    String getSlug() const override { return "python"; }
+    String getName() const override { return "Python Script"; }
+
+    void getLoopTypes (Array<LoopType>& types) const override
+    {
+        types.addArray ({ LoopType::None, LoopType::Forwards });
+    }
+
+    void getProperties (const Exporter& exporter, Array<PropertyComponent*>& props) const override
+    {
+        Exporter expref = exporter;
+        props.add (new ScriptPropertyComponent (expref.getPropertyAsValue (Tags::script)));
+    }
+
+    void getTasks (const Project& project, const Exporter& exporter,
+                   OwnedArray<ExportTask>& tasks) const override
+    {
+        const String path = exporter.getProperty (Tags::script).toString();
+        if (! File::isAbsolutePath (path))
+            return;
+
+        Array<InstrumentRegion> regions;
+        InstrumentRegion::getRegions (project, regions);
+        const LoopType loopType (LoopType::fromSlug (exporter.getProperty (Tags::loop).toString()));
+        tasks.add (new PythonExportTask (interpreter, File (path), exporter.getPath(),
+            InstrumentRegion::getInstrumentName (project), regions,
+            loopType == LoopType::Forwards));
+    }
+
+protected:
+    void setMissingProperties (ValueTree data) const override
+    {
+        if (! data.hasProperty (Tags::script))
+            data.setProperty (Tags::script, String(), nullptr);
+        if (! data.hasProperty (Tags::loop))
+            data.setProperty (Tags::loop, LoopType (LoopType::Forwards).getSlug(), nullptr);
+    }
+
+private:
+    mutable PythonInterpreter interpreter;
+};
+
+ExporterType* ExporterType::createPythonExporterType()
+{
+    return new PythonExporterType();
+}
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "exporters/Exporter.h"
+
+#if VCP_PYTHON
+
+namespace vcp {
+
+/** The embedded interpreter. It starts on first use and the GIL is only
+    held while a script runs, so start and stop on the message thread */
+class PythonInterpreter
+{
+public:
+    PythonInterpreter() = default;
+    ~PythonInterpreter() { stop(); }
+
+    /** Starts the interpreter if not already running */
+    Result start();
+
+    /** Shuts the interpreter down. Scripts must not be running */
+    void stop();
+
+    bool isRunning() const { return mainThreadState != nullptr; }
+
+private:
+    void* mainThreadState = nullptr;
+    JUCE_DECLARE_NON_COPYABLE (PythonInterpreter)
+};
+
+}
+
+#endif
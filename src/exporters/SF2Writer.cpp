@@ -0,0 +1,292 @@
+#include "exporters/SF2Writer.h"
+
+namespace vcp {
+
+namespace {
+
+// generator operators used by the writer
+enum Generator
+{
+    genPan              = 17,
+    genInstrument       = 41,
+    genKeyRange         = 43,
+    genVelRange         = 44,
+    genSampleID         = 53,
+    genSampleModes      = 54,
+    genOverridingRootKey = 58
+};
+
+// every sample is followed by at least 46 zero valued points
+const int numPaddingPoints = 46;
+
+void writeFourCC (OutputStream& out, const char* id)
+{
+    out.write (id, 4);
+}
+
+void writeName (OutputStream& out, const String& name)
+{
+    char text[20] = { 0 };
+    name.copyToUTF8 (text, 20);
+    text[19] = 0;
+    out.write (text, 20);
+}
+
+void writeGenerator (OutputStream& out, int oper, int amount)
+{
+    out.writeShort ((short) oper);
+    out.writeShort ((short) amount);
+}
+
+void writeRange (OutputStream& out, int oper, int low, int high)
+{
+    out.writeShort ((short) oper);
+    out.writeByte ((char) jlimit (0, 127, low));
+    out.writeByte ((char) jlimit (0, 127, high));
+}
+
+bool writeChunk (OutputStream& out, const char* id, const MemoryOutputStream& data)
+{
+    writeFourCC (out, id);
+    out.writeInt ((int) data.getDataSize());
+    if (! out.write (data.getData(), data.getDataSize()))
+        return false;
+    return (data.getDataSize() & 1) == 0 || out.writeByte (0);
+}
+
+void writeString (MemoryOutputStream& out, const String& text)
+{
+    out.write (text.toRawUTF8(), text.getNumBytesAsUTF8());
+    out.writeByte (0);
+    if ((out.getDataSize() & 1) != 0)
+        out.writeByte (0);
+}
+
+}
+
+SF2Writer::SF2Writer (OutputStream& out)
+    : output (out) {}
+
+Result SF2Writer::begin (const String& bankName)
+{
+    jassert (riffStart < 0);
+    riffStart = output.getPosition();
+    writeFourCC (output, "RIFF");
+    output.writeInt (0);
+    writeFourCC (output, "sfbk");
+
+    MemoryOutputStream info;
+    writeFourCC (info, "INFO");
+    MemoryOutputStream chunk;
+    chunk.writeShort (2);
+    chunk.writeShort (1);
+    writeChunk (info, "ifil", chunk);
+    chunk.reset(); writeString (chunk, "EMU8000");
+    writeChunk (info, "isng", chunk);
+    chunk.reset(); writeString (chunk, bankName.substring (0, 255));
+    writeChunk (info, "INAM", chunk);
+    chunk.reset(); writeString (chunk, "Versicap");
+    writeChunk (info, "ISFT", chunk);
+    if (! writeChunk (output, "LIST", info))
+        return Result::fail ("could not write soundfont header");
+
+    sdtaStart = output.getPosition();
+    writeFourCC (output, "LIST");
+    output.writeInt (0);
+    writeFourCC (output, "sdta");
+    smplStart = output.getPosition();
+    writeFourCC (output, "smpl");
+    if (! output.writeInt (0))
+        return Result::fail ("could not write soundfont header");
+    return Result::ok();
+}
+
+int SF2Writer::beginSample (const String& name, double sampleRate, int originalPitch)
+{
+    if (inSample)
+        endSample();
+
+    SampleHeader header;
+    header.name          = name;
+    header.start         = position;
+    header.sampleRate    = static_cast<uint32> (roundToInt (sampleRate));
+    header.originalPitch = static_cast<uint8> (jlimit (0, 127, originalPitch));
+    samples.add (header);
+    inSample = true;
+    return samples.size() - 1;
+}
+
+bool SF2Writer::writeSampleData (const int16* data, int numFrames)
+{
+    jassert (inSample);
+   #if JUCE_LITTLE_ENDIAN
+    if (! output.write (data, sizeof (int16) * (size_t) numFrames))
+        failed = true;
+   #else
+    for (int i = 0; i < numFrames; ++i)
+        if (! output.writeShort (data[i]))
+            failed = true;
+   #endif
+    position += static_cast<uint32> (numFrames);
+    return ! failed;
+}
+
+bool SF2Writer::endSample (int64 loopStart, int64 loopEnd)
+{
+    if (! inSample)
+        return false;
+
+    auto& header = samples.getReference (samples.size() - 1);
+    header.end = position;
+    if (loopStart >= 0 && loopEnd > loopStart && header.start + loopEnd <= header.end)
+    {
+        header.loopStart = header.start + static_cast<uint32> (loopStart);
+        header.loopEnd   = header.start + static_cast<uint32> (loopEnd);
+    }
+    else
+    {
+        header.loopStart = header.start;
+        header.loopEnd   = header.end;
+    }
+
+    const int16 zeros [numPaddingPoints] = { 0 };
+    inSample = false;
+    return writeSampleData (zeros, numPaddingPoints);
+}
+
+void SF2Writer::linkSamples (int left, int right)
+{
+    if (! isPositiveAndBelow (left, samples.size()) || ! isPositiveAndBelow (right, samples.size()))
+        return;
+    auto& l = samples.getReference (left);
+    auto& r = samples.getReference (right);
+    l.type = LeftSample;    l.link = static_cast<uint16> (right);
+    r.type = RightSample;   r.link = static_cast<uint16> (left);
+}
+
+bool SF2Writer::patchSize (int64 chunkStart, int64 chunkEnd)
+{
+    if (! output.setPosition (chunkStart + 4))
+        return false;
+    output.writeInt (static_cast<int> (chunkEnd - chunkStart - 8));
+    return true;
+}
+
+Result SF2Writer::finish (const String& presetName)
+{
+    if (riffStart < 0)
+        return Result::fail ("soundfont was not started");
+    if (inSample)
+        endSample();
+    if (failed)
+        return Result::fail ("could not write soundfont sample data");
+
+    const int64 sdtaEnd = output.getPosition();
+    if (! patchSize (smplStart, sdtaEnd) || ! patchSize (sdtaStart, sdtaEnd) ||
+        ! output.setPosition (sdtaEnd))
+        return Result::fail ("could not update soundfont chunk sizes");
+
+    MemoryOutputStream pdta, chunk;
+    writeFourCC (pdta, "pdta");
+
+    // one preset playing the instrument
+    writeName (chunk, presetName);
+    chunk.writeShort (0); chunk.writeShort (0); chunk.writeShort (0);
+    chunk.writeInt (0); chunk.writeInt (0); chunk.writeInt (0);
+    writeName (chunk, "EOP");
+    chunk.writeShort (0); chunk.writeShort (0); chunk.writeShort (1);
+    chunk.writeInt (0); chunk.writeInt (0); chunk.writeInt (0);
+    writeChunk (pdta, "phdr", chunk);
+
+    chunk.reset();
+    chunk.writeShort (0); chunk.writeShort (0);
+    chunk.writeShort (1); chunk.writeShort (0);
+    writeChunk (pdta, "pbag", chunk);
+
+    chunk.reset();
+    chunk.writeRepeatedByte (0, 10);
+    writeChunk (pdta, "pmod", chunk);
+
+    chunk.reset();
+    writeGenerator (chunk, genInstrument, 0);
+    writeGenerator (chunk, 0, 0);
+    writeChunk (pdta, "pgen", chunk);
+
+    // the instrument with one zone per sample region
+    chunk.reset();
+    writeName (chunk, presetName);
+    chunk.writeShort (0);
+    writeName (chunk, "EOI");
+    chunk.writeShort ((short) zones.size());
+    writeChunk (pdta, "inst", chunk);
+
+    MemoryOutputStream igen;
+    chunk.reset();
+    int numGenerators = 0;
+    for (const auto& zone : zones)
+    {
+        chunk.writeShort ((short) numGenerators);
+        chunk.writeShort (0);
+
+        // key and velocity ranges must come first and the sample last
+        writeRange (igen, genKeyRange, zone.lowKey, zone.highKey);
+        writeRange (igen, genVelRange, zone.lowVelocity, zone.highVelocity);
+        numGenerators += 2;
+        if (zone.pan != 0)
+        {
+            writeGenerator (igen, genPan, jlimit (-500, 500, zone.pan));
+            ++numGenerators;
+        }
+        if (zone.loop)
+        {
+            writeGenerator (igen, genSampleModes, 1);
+            ++numGenerators;
+        }
+        if (zone.rootKey >= 0)
+        {
+            writeGenerator (igen, genOverridingRootKey, jlimit (0, 127, zone.rootKey));
+            ++numGenerators;
+        }
+        writeGenerator (igen, genSampleID, zone.sampleIndex);
+        ++numGenerators;
+    }
+    chunk.writeShort ((short) numGenerators);
+    chunk.writeShort (0);
+    writeChunk (pdta, "ibag", chunk);
+
+    chunk.reset();
+    chunk.writeRepeatedByte (0, 10);
+    writeChunk (pdta, "imod", chunk);
+
+    writeGenerator (igen, 0, 0);
+    writeChunk (pdta, "igen", igen);
+
+    chunk.reset();
+    for (const auto& header : samples)
+    {
+        writeName (chunk, header.name);
+        chunk.writeInt ((int) header.start);
+        chunk.writeInt ((int) header.end);
+        chunk.writeInt ((int) header.loopStart);
+        chunk.writeInt ((int) header.loopEnd);
+        chunk.writeInt ((int) header.sampleRate);
+        chunk.writeByte ((char) header.originalPitch);
+        chunk.writeByte (0);
+        chunk.writeShort ((short) header.link);
+        chunk.writeShort ((short) header.type);
+    }
+    writeName (chunk, "EOS");
+    chunk.writeRepeatedByte (0, 26);
+    writeChunk (pdta, "shdr", chunk);
+
+    if (! writeChunk (output, "LIST", pdta))
+        return Result::fail ("could not write soundfont presets");
+
+    const int64 riffEnd = output.getPosition();
+    if (! patchSize (riffStart, riffEnd) || ! output.setPosition (riffEnd))
+        return Result::fail ("could not update soundfont chunk sizes");
+    output.flush();
+    return Result::ok();
+}
+
+}
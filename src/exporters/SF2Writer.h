@@ -0,0 +1,90 @@
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace vcp {
+
+/** Writes a SoundFont 2 bank with a single instrument and preset. Sample
+    data is streamed into the sdta chunk as it is written and chunk sizes
+    are patched when finished, so memory use doesn't depend on the size of
+    the bank. The output stream must support setPosition() */
+class SF2Writer
+{
+public:
+    enum SampleType
+    {
+        MonoSample  = 1,
+        RightSample = 2,
+        LeftSample  = 4
+    };
+
+    struct Zone
+    {
+        int sampleIndex     = -1;
+        int lowKey          = 0;
+        int highKey         = 127;
+        int lowVelocity     = 0;
+        int highVelocity    = 127;
+        int rootKey         = -1;   // -1 uses the sample's original pitch
+        int pan             = 0;    // -500 = left, 500 = right
+        bool loop           = false;
+    };
+
+    explicit SF2Writer (OutputStream& output);
+    ~SF2Writer() = default;
+
+    /** Writes the header and info chunks, call once before adding samples */
+    Result begin (const String& bankName);
+
+    /** Starts a new mono sample and returns its index */
+    int beginSample (const String& name, double sampleRate, int originalPitch);
+
+    /** Appends 16 bit data to the current sample */
+    bool writeSampleData (const int16* data, int numFrames);
+
+    /** Finishes the current sample. Loop points are frames relative to the
+        start of the sample, the end is exclusive */
+    bool endSample (int64 loopStart = -1, int64 loopEnd = -1);
+
+    /** Marks two mono samples as the left and right side of a stereo pair */
+    void linkSamples (int left, int right);
+
+    /** Adds a zone to the instrument */
+    void addZone (const Zone& zone) { zones.add (zone); }
+
+    /** Writes the instrument, preset and sample headers and fixes up chunk
+        sizes. The stream is left at the end of the file */
+    Result finish (const String& presetName);
+
+    int getNumSamples() const { return samples.size(); }
+
+private:
+    struct SampleHeader
+    {
+        String name;
+        uint32 start        = 0;
+        uint32 end          = 0;
+        uint32 loopStart    = 0;
+        uint32 loopEnd      = 0;
+        uint32 sampleRate   = 44100;
+        uint8 originalPitch = 60;
+        uint16 link         = 0;
+        uint16 type         = MonoSample;
+    };
+
+    OutputStream& output;
+    Array<SampleHeader> samples;
+    Array<Zone> zones;
+    int64 riffStart = -1;
+    int64 sdtaStart = -1;
+    int64 smplStart = -1;
+    uint32 position = 0;    // in sample points from the start of smpl
+    bool inSample = false;
+    bool failed = false;
+
+    bool patchSize (int64 chunkStart, int64 chunkEnd);
+
+    JUCE_DECLARE_NON_COPYABLE (SF2Writer)
+};
+
+}
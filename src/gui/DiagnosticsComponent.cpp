@@ -0,0 +1,161 @@
+#include "engine/AudioEngine.h"
+#include "gui/DiagnosticsComponent.h"
+#include "Versicap.h"
+
+namespace vcp {
+
+DiagnosticsComponent::DiagnosticsComponent (Versicap& vc)
+    : versicap (vc)
+{
+    addAndMakeVisible (resetButton);
+    resetButton.setButtonText ("Reset");
+    resetButton.onClick = [this]()
+    {
+        versicap.getAudioEngine().getStats().reset();
+        versicap.getAudioEngine().getMonitor()->resetPeaks();
+        versicap.getAudioEngine().resetMidiStats();
+        timerCallback();
+    };
+
+    addAndMakeVisible (saveButton);
+    saveButton.setButtonText ("Save JSON...");
+    saveButton.onClick = [this]() { saveToFile(); };
+
+    setSize (520, 440);
+    timerCallback();
+    startTimerHz (4);
+}
+
+DiagnosticsComponent::~DiagnosticsComponent()
+{
+    stopTimer();
+}
+
+void DiagnosticsComponent::timerCallback()
+{
+    snapshot = versicap.getAudioEngine().getStats().getSnapshot();
+    repaint();
+}
+
+void DiagnosticsComponent::saveToFile()
+{
+    FileChooser chooser ("Save Engine Diagnostics",
+        File::getSpecialLocation (File::userDesktopDirectory).getChildFile ("versicap-diagnostics.json"),
+        "*.json", true, false, nullptr);
+    if (! chooser.browseForFileToSave (true))
+        return;
+
+    const auto result = versicap.getAudioEngine().getStats().writeToFile (
+        chooser.getResult().withFileExtension ("json"));
+    if (result.failed())
+        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
+            "Versicap", result.getErrorMessage());
+}
+
+void DiagnosticsComponent::paint (Graphics& g)
+{
+    g.fillAll (kv::LookAndFeel_KV1::widgetBackgroundColor.darker());
+    g.setColour (kv::LookAndFeel_KV1::textColor);
+    g.setFont (13.f);
+
+    auto r = getLocalBounds().reduced (10);
+    r.removeFromBottom (34);
+
+    String summary;
+    summary << "Cycles: " << snapshot.numCycles
+            << "   Xruns: " << snapshot.numXruns
+            << "   Overruns: " << snapshot.numOverruns
+            << "   Writer overflows: " << snapshot.numWriterOverflows;
+    g.drawText (summary, r.removeFromTop (20), Justification::centredLeft);
+
+    String deadline;
+    deadline << "Block: " << snapshot.blockSize << " @ " << String (snapshot.sampleRate, 0) << " Hz"
+             << "   Deadline: " << String (snapshot.getDeadline(), 2) << " ms"
+             << "   Max load: " << String (snapshot.maxLoad * 100.0, 0) << "%";
+    g.drawText (deadline, r.removeFromTop (20), Justification::centredLeft);
+
+    String outputs ("Output peaks:");
+    auto monitor = versicap.getAudioEngine().getMonitor();
+    for (int c = 0; c < jmin (8, monitor->getNumChannels()); ++c)
+    {
+        outputs << "   " << (c + 1) << ": " << String (Decibels::gainToDecibels (monitor->getPeakHold (c)), 1) << " dB";
+        if (monitor->getNumClips (c) > 0)
+            outputs << " (" << monitor->getNumClips (c) << " clipped)";
+    }
+    g.drawText (outputs, r.removeFromTop (20), Justification::centredLeft);
+    g.drawText ("MIDI: " + versicap.getAudioEngine().getMidiStats().toString(),
+                r.removeFromTop (20), Justification::centredLeft);
+    r.removeFromTop (8);
+
+    // per stage timing in milliseconds
+    const int nameWidth = 100;
+    const int colWidth  = (r.getWidth() - nameWidth) / 4;
+    auto drawRow = [&] (const String& name, const StringArray& columns)
+    {
+        auto row = r.removeFromTop (18);
+        g.drawText (name, row.removeFromLeft (nameWidth), Justification::centredLeft);
+        for (const auto& text : columns)
+            g.drawText (text, row.removeFromLeft (colWidth), Justification::centredRight);
+    };
+
+    auto formatStage = [] (const EngineStats::StageInfo& info) -> StringArray
+    {
+        return StringArray (String (info.meanMs, 3), String (info.getPercentile (0.5), 3),
+                            String (info.getPercentile (0.99), 3), String (info.maxMs, 3));
+    };
+
+    drawRow ("Stage (ms)", { "Mean", "P50", "P99", "Max" });
+    for (int i = 0; i < EngineStats::numStages; ++i)
+        drawRow (EngineStats::getStageName (i), formatStage (snapshot.stages[i]));
+    drawRow (EngineStats::getStageName (EngineStats::numStages), formatStage (snapshot.total));
+    r.removeFromTop (10);
+
+    auto graphs = r;
+    paintHistogram (g, graphs.removeFromLeft (graphs.getWidth() / 2).withTrimmedRight (5),
+                    "Load", snapshot.load, 5);
+    paintHistogram (g, graphs.withTrimmedLeft (5), "Writer FIFO", snapshot.writerFill, 10);
+}
+
+void DiagnosticsComponent::paintHistogram (Graphics& g, Rectangle<int> r, const String& title,
+                                           const EngineStats::Histogram& histogram, int percentPerBin)
+{
+    g.setColour (kv::LookAndFeel_KV1::textColor);
+    g.drawText (title, r.removeFromTop (18), Justification::centredLeft);
+    auto labels = r.removeFromBottom (16);
+    g.drawText ("0%", labels, Justification::centredLeft);
+    g.drawText (String ((histogram.counts.size() - 1) * percentPerBin) + "%+", labels, Justification::centredRight);
+
+    g.setColour (kv::LookAndFeel_KV1::widgetBackgroundColor);
+    g.fillRect (r);
+
+    int64 highest = 0;
+    for (const auto count : histogram.counts)
+        highest = jmax (highest, count);
+    if (highest <= 0 || histogram.counts.isEmpty())
+        return;
+
+    const float barWidth = static_cast<float> (r.getWidth()) / static_cast<float> (histogram.counts.size());
+    g.setColour (Colours::orange);
+    for (int i = 0; i < histogram.counts.size(); ++i)
+    {
+        // log scale so rare slow cycles stay visible
+        const auto count = histogram.counts.getUnchecked (i);
+        if (count <= 0)
+            continue;
+        const float height = static_cast<float> (r.getHeight())
+            * static_cast<float> (std::log1p ((double) count) / std::log1p ((double) highest));
+        g.fillRect (r.getX() + barWidth * i, r.getBottom() - height, jmax (1.f, barWidth - 1.f), height);
+    }
+}
+
+void DiagnosticsComponent::resized()
+{
+    auto r = getLocalBounds().reduced (10).removeFromBottom (24);
+    saveButton.changeWidthToFitText (24);
+    saveButton.setBounds (r.removeFromRight (saveButton.getWidth()));
+    r.removeFromRight (6);
+    resetButton.changeWidthToFitText (24);
+    resetButton.setBounds (r.removeFromRight (resetButton.getWidth()));
+}
+
+}
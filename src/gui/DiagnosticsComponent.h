@@ -0,0 +1,59 @@
+#pragma once
+
+#include "engine/EngineStats.h"
+
+namespace vcp {
+
+class Versicap;
+
+/** Shows the audio engine's callback timing, xruns, load and writer FIFO
+    fill. Refreshes a few times per second while visible */
+class DiagnosticsComponent : public Component,
+                             private Timer
+{
+public:
+    DiagnosticsComponent (Versicap& vc);
+    ~DiagnosticsComponent();
+
+    void paint (Graphics&) override;
+    void resized() override;
+
+private:
+    Versicap& versicap;
+    EngineStats::Snapshot snapshot;
+    TextButton resetButton;
+    TextButton saveButton;
+
+    void timerCallback() override;
+    void saveToFile();
+
+    void paintHistogram (Graphics&, Rectangle<int>, const String& title,
+                         const EngineStats::Histogram&, int percentPerBin);
+};
+
+//=============================================================================
+class DiagnosticsWindow : public DocumentWindow
+{
+public:
+    DiagnosticsWindow (std::unique_ptr<DiagnosticsWindow>& o, Versicap& vc)
+        : DocumentWindow ("Engine Diagnostics", Colours::black, DocumentWindow::closeButton),
+          owner (o)
+    {
+        owner.reset (this);
+        setUsingNativeTitleBar (true);
+        setContentOwned (new DiagnosticsComponent (vc), true);
+        setResizable (true, false);
+        centreWithSize (getWidth(), getHeight());
+        setVisible (true);
+    }
+
+    void closeButtonPressed() override
+    {
+        owner.reset();
+    }
+
+private:
+    std::unique_ptr<DiagnosticsWindow>& owner;
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "engine/AudioEngine.h"
+#include "Versicap.h"
+
+namespace vcp {
+
+/** Shows a measured latency and lets the user measure it again */
+class LatencyPropertyComponent : public PropertyComponent,
+                                 private Value::Listener
+{
+public:
+    LatencyPropertyComponent (Versicap& vc, const Value& latencyValue,
+                              const LatencyProbe::Options& probeOptions,
+                              const String& midiOutputName = String())
+        : PropertyComponent ("Latency"),
+          versicap (vc),
+          options (probeOptions),
+          midiOutput (midiOutputName)
+    {
+        value.referTo (latencyValue);
+        value.addListener (this);
+        addAndMakeVisible (button);
+        button.setTriggeredOnMouseDown (true);
+        button.onClick = [this]()
+        {
+            PopupMenu menu;
+            menu.addItem (1, "Measure with MIDI note");
+            menu.addItem (2, "Measure audio loopback");
+            menu.addSeparator();
+            menu.addItem (3, "Use estimate", (double) value.getValue() >= 0.0);
+            menu.showMenuAsync (PopupMenu::Options().withTargetComponent (&button),
+                ModalCallbackFunction::forComponent (&LatencyPropertyComponent::menuResult, this));
+        };
+
+        refresh();
+    }
+
+    ~LatencyPropertyComponent()
+    {
+        value.removeListener (this);
+    }
+
+    void refresh() override
+    {
+        const double millis = (double) value.getValue();
+        button.setButtonText (millis >= 0.0 ? String (millis, 2) + " ms" : String ("Estimate"));
+    }
+
+private:
+    Versicap& versicap;
+    LatencyProbe::Options options;
+    String midiOutput;
+    Value value;
+    TextButton button;
+
+    static void menuResult (int result, LatencyPropertyComponent* component)
+    {
+        if (component != nullptr && result > 0)
+            component->menuResult (result);
+    }
+
+    void menuResult (int result)
+    {
+        if (result == 3)
+        {
+            value.setValue (-1.0);
+            return;
+        }
+
+        auto opts = options;
+        opts.mode = result == 2 ? LatencyProbe::AudioLoopback : LatencyProbe::MidiNote;
+        
+        Value target (value);
+        const auto started = versicap.getAudioEngine().startLatencyMeasurement (opts, midiOutput,
+            [target](const Result& r, double millis) mutable
+            {
+                if (r.failed())
+                {
+                    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
+                        "Latency", r.getErrorMessage());
+                    return;
+                }
+
+                target.setValue (millis);
+            });
+
+        if (started.failed())
+            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Latency", started.getErrorMessage());
+        else
+            button.setButtonText ("Measuring...");
+    }
+
+    void valueChanged (Value&) override { refresh(); }
+};
+
+}
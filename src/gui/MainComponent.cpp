@@ -461,9 +461,11 @@ private:
     Project project;
     Value projectName;
 
-    AudioEngine::MonitorPtr monitor;
+    OutputMeter::Ptr monitor;
+    OutputMeter::Window levels;
     kv::DigitalMeter meterLeft;
     kv::DigitalMeter meterRight;
+    uint32 lastLevelTime = 0;
 
     std::unique_ptr<ContentView> view;
     std::unique_ptr<MainPropertiesContentView> props;
@@ -506,13 +508,25 @@ private:
     {
         if (! monitor)
             monitor = versicap.getAudioEngine().getMonitor();
-        if (monitor)
-        {
-            meterLeft.setValue (0, monitor->levelLeft.get());
-            meterLeft.refresh();
-            meterRight.setValue (0, monitor->levelRight.get());
-            meterRight.refresh();
-        }
+        if (! monitor)
+            return;
+
+        // every window since the last tick counts, so short peaks show up.
+        // Large device blocks deliver windows in bursts, hold until then
+        const auto now = Time::getMillisecondCounter();
+        if (monitor->read (levels))
+            lastLevelTime = now;
+        else if (now - lastLevelTime > 250)
+            zerostruct (levels);
+        else
+            return;
+
+        const float left  = levels.numChannels > 0 ? levels.peak[0] : 0.f;
+        const float right = levels.numChannels > 1 ? levels.peak[1] : left;
+        meterLeft.setValue (0, left);
+        meterLeft.refresh();
+        meterRight.setValue (0, right);
+        meterRight.refresh();
     }
 };
 
@@ -92,6 +92,8 @@ void MainMenu::buildFileMenu (PopupMenu& menu)
 void MainMenu::buildProjectMenu (PopupMenu& menu)
 {
     menu.addCommandItem (&commands, Commands::projectRecord, "Record...");
+    menu.addCommandItem (&commands, Commands::projectFindLoops, "Find loop points");
+    menu.addCommandItem (&commands, Commands::projectPreviewContainer, "Preview container...");
     menu.addCommandItem (&commands, Commands::projectShowDataPath, "Show data path");
 }
 
@@ -103,6 +105,8 @@ void MainMenu::buildDebugMenu (PopupMenu& menu)
 void MainMenu::buildHelpMenu (PopupMenu& menu)
 {
     menu.addItem (3000, "Online documentation...");
+    menu.addSeparator();
+    menu.addCommandItem (&commands, Commands::showDiagnostics, "Engine diagnostics...");
 }
 
 }
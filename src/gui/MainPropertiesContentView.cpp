@@ -4,6 +4,27 @@
 
 namespace vcp {
 
+class RigButtonPropertyComponent : public ButtonPropertyComponent
+{
+public:
+    RigButtonPropertyComponent (const String& text, std::function<void()> callback)
+        : ButtonPropertyComponent (String(), false),
+          buttonText (text), onClick (callback) { }
+
+    void buttonClicked() override
+    {
+        // the panel is rebuilt by this, so defer it
+        auto callback = onClick;
+        MessageManager::callAsync ([callback]() { if (callback) callback(); });
+    }
+
+    String getButtonText() const override { return buttonText; }
+
+private:
+    String buttonText;
+    std::function<void()> onClick;
+};
+
 MainPropertiesContentView::MainPropertiesContentView (Versicap& vc)
     : ContentView (vc)
 {
@@ -12,7 +33,7 @@ MainPropertiesContentView::MainPropertiesContentView (Versicap& vc)
     watcher.setProject (vc.getProject());
     addComponentListener (this);
     watcher.onChanged = watcher.onActiveLayerChanged = watcher.onActiveSampleChanged = 
-        std::bind (&MainPropertiesContentView::refreshCompletePanel, this);
+        watcher.onRigsChanged = std::bind (&MainPropertiesContentView::refreshCompletePanel, this);
     refreshCompletePanel();
 }
 
@@ -45,6 +66,23 @@ void MainPropertiesContentView::refreshCompletePanel()
     project.getDevicesProperties (versicap, props);
     panel.addSection ("Devices", props);
 
+    for (int i = 0; i < project.getNumRigs(); ++i)
+    {
+        props.clearQuick();
+        auto rig = project.getRig (i);
+        rig.getProperties (versicap, props);
+        props.add (new RigButtonPropertyComponent ("Remove", [project, i]() mutable {
+            project.removeRig (i);
+        }));
+        panel.addSection (String ("Rig: ") + rig.getName(), props);
+    }
+
+    props.clearQuick();
+    props.add (new RigButtonPropertyComponent ("Add Rig", [project]() mutable {
+        project.addRig();
+    }));
+    panel.addSection ("Rigs", props);
+
     if (xml)
         panel.restoreOpennessState (*xml);
 
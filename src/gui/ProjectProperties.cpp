@@ -1,6 +1,7 @@
 
 #include "engine/AudioEngine.h"
 #include "gui/AudioDeviceSelect.h"
+#include "gui/LatencyPropertyComponent.h"
 #include "gui/PluginPicker.h"
 #include "PluginManager.h"
 #include "Project.h"
@@ -523,17 +524,35 @@ void Project::getDevicesProperties (Versicap& versicap, Array<PropertyComponent*
     props.add (new MidiDevicePropertyComponent (versicap,  *this, true));
     props.add (new MidiDevicePropertyComponent (versicap,  *this, false));
     props.add (new BufferSizePropertyComponent (versicap,  *this));
+
+    LatencyProbe::Options options;
+    options.numInputs   = (int) getProperty (Tags::channels, 2);
+    options.midiChannel = jlimit (1, 16, getActiveSampleSet().getMidiChannel());
+    props.add (new LatencyPropertyComponent (versicap, 
+        getPropertyAsValue (Tags::measuredLatency), options));
 }
 
 void Project::getRecordingProperties (Versicap& versicap, Array<PropertyComponent*>& props)
 {
     props.add (new SampleRatePropertyComponent (versicap,  *this));
+    props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::fileSampleRate),
+        "File Rate", { "Device", "44.1 kHz", "48 kHz", "88.2 kHz", "96 kHz" },
+                     { 0, 44100, 48000, 88200, 96000 }));
     props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::format),
         "Format", FormatType::getChoices (true), FormatType::getValues (true)));
     props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::channels),
         "Channels", { "Mono", "Stereo" }, { 1, 2 }));
     props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::bitDepth),
         "Bit Depth", { "16 bit", "24 bit" }, { 16, 24 }));
+    props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::dither),
+        "Dither", { "Off", "TPDF", "TPDF + Shaping" }, { 0, 1, 2 }));
+    props.add (new SliderPropertyComponent (getPropertyAsValue (Tags::programSettle),
+        "Program Settle (ms)", 50.0, 10000.0, 10.0));
+    props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::workers),
+        "Plugin Workers", { "Off", "1", "2", "4", "Auto" }, { 0, 1, 2, 4, -1 }));
+    props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::trimThreshold),
+        "Auto Trim", { "Off", "-40 dB", "-50 dB", "-60 dB", "-70 dB" },
+                     { 0, -40, -50, -60, -70 }));
 }
 
 }
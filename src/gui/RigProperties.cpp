@@ -0,0 +1,78 @@
+
+#include "gui/LatencyPropertyComponent.h"
+#include "Project.h"
+
+namespace vcp {
+
+class RigChannelPropertyComponent : public SliderPropertyComponent
+{
+public:
+    RigChannelPropertyComponent (const Value& valueToControl,
+                                 const String& propertyName)
+        : SliderPropertyComponent (valueToControl, propertyName,
+                                   0, 16, 1.0, 1.0, false)
+    {
+        slider.textFromValueFunction = [this](double value) -> String {
+            auto intVal = roundToInt (value);
+            return intVal > 0 ? String (intVal) : "layer";
+        };
+
+        slider.valueFromTextFunction = [this](const String& text) -> double {
+            return static_cast<double> (jlimit (0, 16, text.getIntValue()));
+        };
+
+        slider.updateText();
+    }
+};
+
+class RigInputPropertyComponent : public SliderPropertyComponent
+{
+public:
+    RigInputPropertyComponent (const Value& valueToControl,
+                               const String& propertyName)
+        : SliderPropertyComponent (valueToControl, propertyName,
+                                   0, 63, 1.0, 1.0, false)
+    {
+        slider.textFromValueFunction = [this](double value) -> String {
+            return String (1 + roundToInt (value));
+        };
+
+        slider.valueFromTextFunction = [this](const String& text) -> double {
+            return static_cast<double> (jlimit (0, 63, text.getIntValue() - 1));
+        };
+
+        slider.updateText();
+    }
+};
+
+void Rig::getProperties (Versicap& versicap, Array<PropertyComponent*>& props)
+{
+    props.add (new TextPropertyComponent (getPropertyAsValue (Tags::name), 
+        "Name", 100, false, true));
+
+    StringArray choices ("Default");
+    Array<var> values (var (String()));
+    for (const auto& name : MidiOutput::getDevices())
+    {
+        choices.add (name);
+        values.add (name);
+    }
+
+    props.add (new ChoicePropertyComponent (getPropertyAsValue (Tags::midiOutput),
+        "MIDI Out", choices, values));
+    props.add (new RigChannelPropertyComponent (getPropertyAsValue (Tags::midiChannel, true),
+        "Channel"));
+    props.add (new RigInputPropertyComponent (getPropertyAsValue (Tags::inputChannel, true),
+        "Audio Input"));
+
+    const Project project (versicap.getProject());
+    LatencyProbe::Options options;
+    options.inputChannel = getInputChannel();
+    options.numInputs    = (int) project.getProperty (Tags::channels, 2);
+    options.midiChannel  = getMidiChannel() > 0 ? getMidiChannel() 
+                         : jlimit (1, 16, project.getActiveSampleSet().getMidiChannel());
+    props.add (new LatencyPropertyComponent (versicap,
+        getPropertyAsValue (Tags::measuredLatency), options, getMidiOutputName()));
+}
+
+}
@@ -6,14 +6,26 @@
 namespace vcp {
 
 class SampleTable : public TableListBox,
-                    public TableListBoxModel
+                    public TableListBoxModel,
+                    private AsyncUpdater
 {
 public:
     enum Columns {
-        NoteColumn = 1,
-        MidiColumn = 2,
-        NameColumn = 3
+        NoteColumn      = 1,
+        MidiColumn      = 2,
+        NameColumn      = 3,
+        PeakColumn      = 4,
+        RmsColumn       = 5,
+        LoudnessColumn  = 6,
+        PitchColumn     = 7,
+        CentsColumn     = 8,
+        NoiseColumn     = 9
     };
+
+    /** Analysis results outside these are flagged */
+    static constexpr double maxCents        = 10.0;
+    static constexpr double maxLoudnessJump = 3.0;
+    static constexpr double maxPeak         = -0.1;
     
     std::function<void(const Sample&)> onSelected;
 
@@ -24,13 +36,24 @@ public:
         getHeader().addColumn ("Note", NoteColumn, 52);
         getHeader().addColumn ("MIDI", MidiColumn, 52);
         getHeader().addColumn ("Name", NameColumn, 96);
+        getHeader().addColumn ("Peak", PeakColumn, 60);
+        getHeader().addColumn ("RMS", RmsColumn, 60);
+        getHeader().addColumn ("LUFS", LoudnessColumn, 60);
+        getHeader().addColumn ("Pitch", PitchColumn, 64);
+        getHeader().addColumn ("Cents", CentsColumn, 56);
+        getHeader().addColumn ("Noise", NoiseColumn, 60);
+        getHeader().setSortColumnId (NoteColumn, true);
 
-        watcher.onChanged = [this]() { refreshSamples(); };
-        watcher.onSamplesAdded = watcher.onSampleAdded = watcher.onSampleRemoved = [this]()
+        watcher.onChanged = watcher.onSamplesAdded = watcher.onSamplesRemoved = [this]()
         { 
             refreshSamples(); 
         };
-        
+
+        // single samples are patched into the sorted rows
+        watcher.onSampleInserted = [this] (const Sample& sample) { sampleInserted (sample); };
+        watcher.onSampleErased   = [this] (const Sample& sample) { sampleErased (sample); };
+        watcher.onDelta = [this] (const ProjectWatcher::Delta& delta) { samplesChanged (delta); };
+
         watcher.onActiveLayerChanged = [this]()
         {
             layer = watcher.getProject().getActiveSampleSet();
@@ -53,36 +76,41 @@ public:
 
     Project getProject() const { return watcher.getProject(); }
 
+    /** Rebuilds all rows, used when the project or layer changes */
     void refreshSamples()
     {
         const auto project = watcher.getProject();
-        filtered.clearQuick (true);
-        auto layerIdx = project.indexOf (layer);
-        
-        if (isPositiveAndBelow (layerIdx, project.getNumSampleSets()))
-            project.getSamples (layerIdx, filtered);
-        
-        struct NameSort
-        {
-            int compareElements (Sample* lhs, Sample* rhs) {
-                return lhs->getNote() < rhs->getNote() ? -1 
-                     : lhs->getNote() == rhs->getNote() ? 0
-                     : lhs->getNote() > rhs->getNote() ? 1
-                     : 0;
-            }
-        } sorter;
+        const auto samples = project.getSamples();
+        layerId = project.indexOf (layer) >= 0 ? layer.getUuidString() : String();
 
-        filtered.sort (sorter);
+        rows.clearQuick();
+        rows.ensureStorageAllocated (samples.size());
+        for (int i = 0; i < samples.size(); ++i)
+        {
+            const auto sample = samples.getSample (i);
+            if (isInLayer (sample))
+                rows.add (sample);
+        }
 
+        sortRows();
+        updateMedianLoudness();
         updateContent();
         repaint();
     }
 
-    int indexOf (const Sample& sample)
+    /** Returns the row of a sample by searching for its sort position,
+        only valid while its sorted properties are unchanged */
+    int indexOf (const Sample& sample) const
     {
-        for (int i = 0; i < filtered.size(); ++i)
-            if (sample.getUuidString() == filtered[i]->getUuidString())
+        for (int i = lowerBound (sample); i < rows.size(); ++i)
+        {
+            const auto& row = rows.getReference (i);
+            if (row.getValueTree() == sample.getValueTree())
                 return i;
+            if (compareRows (row, sample) != 0)
+                break;
+        }
+
         return -1;
     }
 
@@ -92,12 +120,12 @@ public:
         const auto sample = project.getActiveSample();
         auto sampleIdx = indexOf (sample);
         ProjectWatcher::ScopedBlock sb (watcher);
-        if (isPositiveAndBelow (sampleIdx, filtered.size()))
+        if (isPositiveAndBelow (sampleIdx, rows.size()))
             selectRow (sampleIdx);
     }
 
     //=========================================================================
-    int getNumRows() override { return filtered.size(); }
+    int getNumRows() override { return rows.size(); }
 
     void paintRowBackground (Graphics& g, int rowNumber,
                              int width, int height, bool rowIsSelected) override
@@ -116,15 +144,35 @@ public:
         g.setColour (rowIsSelected ? Colours::white
                                    : kv::LookAndFeel_KV1::textColor);
 
-        if (auto* const sample = filtered [rowNumber])
+        if (isPositiveAndBelow (rowNumber, rows.size()))
         {
+            const auto* const sample = &rows.getReference (rowNumber);
             String text;
             switch (columnId)
             {
                 case MidiColumn: text = String (sample->getNote()); break;
                 case NoteColumn: text = MidiMessage::getMidiNoteName (sample->getNote(), true, true, 4); break;
-                case NameColumn: text = sample->getProperty (Tags::name);
-            } 
+                case NameColumn: text = sample->getProperty (Tags::name); break;
+                case PeakColumn:
+                case RmsColumn:
+                case LoudnessColumn:
+                case CentsColumn:
+                case NoiseColumn:
+                {
+                    const auto& property = getProperty (columnId);
+                    if (sample->hasProperty (property))
+                        text = String ((double) sample->getProperty (property), 1);
+                } break;
+                case PitchColumn:
+                {
+                    const double hz = sample->getProperty (Tags::fundamental, 0.0);
+                    if (hz > 0.0)
+                        text = String (hz, 1);
+                } break;
+            }
+
+            if (! rowIsSelected && isFlagged (*sample, columnId))
+                g.setColour (Colours::red);
 
             g.drawText (text, 10, 0, width - 10, height, Justification::centredLeft);
         }
@@ -134,15 +182,25 @@ public:
     {
         ignoreUnused (columnId, ev);
         auto project = getProject();
-        if (auto* sample = filtered [rowNumber])
-            project.setActiveSample (*sample);
+        if (isPositiveAndBelow (rowNumber, rows.size()))
+            project.setActiveSample (rows.getReference (rowNumber));
     }
 
     void selectedRowsChanged (int lastRowSelected) override
     {
-        if (auto* sample = filtered [lastRowSelected])
+        if (isPositiveAndBelow (lastRowSelected, rows.size()))
             if (onSelected)
-                onSelected (*sample);
+                onSelected (rows.getReference (lastRowSelected));
+    }
+
+    void sortOrderChanged (int newSortColumnId, bool isForwards) override
+    {
+        sortColumn   = newSortColumnId;
+        sortForwards = isForwards;
+        sortRows();
+        updateContent();
+        repaint();
+        selectActiveSample();
     }
 
    #if 0
@@ -164,7 +222,259 @@ public:
 private:
     ProjectWatcher watcher;
     SampleSet layer;
-    OwnedArray<Sample> filtered;
+    String layerId;
+    Array<Sample> rows;     // samples of the active layer in sort order
+    Array<double> levels;
+    int sortColumn = NoteColumn;
+    bool sortForwards = true;
+    double medianLoudness = 0.0;
+
+    static const Identifier& getProperty (int columnId)
+    {
+        switch (columnId)
+        {
+            case PeakColumn:        return Tags::peak;
+            case RmsColumn:         return Tags::rms;
+            case LoudnessColumn:    return Tags::loudness;
+            case PitchColumn:       return Tags::fundamental;
+            case CentsColumn:       return Tags::cents;
+            case NoiseColumn:       return Tags::noiseFloor;
+        }
+
+        return Tags::note;
+    }
+
+    static double getSortValue (const Sample& sample, int columnId)
+    {
+        if (columnId == NoteColumn || columnId == MidiColumn)
+            return sample.getNote();
+        // unanalyzed samples sort below all others
+        return sample.getProperty (getProperty (columnId), std::numeric_limits<double>::lowest());
+    }
+
+    bool isInLayer (const Sample& sample) const
+    {
+        return layerId.isNotEmpty() && sample.getProperty (Tags::set).toString() == layerId;
+    }
+
+    /** Returns true if the property decides where a sample is sorted */
+    bool isSortedBy (const Identifier& property) const
+    {
+        if (property == Tags::note)
+            return true;
+        return property == (sortColumn == NameColumn ? Tags::name : getProperty (sortColumn));
+    }
+
+    int compareRows (const Sample& lhs, const Sample& rhs) const
+    {
+        int result = 0;
+        if (sortColumn == NameColumn)
+            result = lhs.getProperty (Tags::name).toString().compareNatural (
+                        rhs.getProperty (Tags::name).toString());
+        else
+        {
+            const auto a = getSortValue (lhs, sortColumn), b = getSortValue (rhs, sortColumn);
+            result = a < b ? -1 : a > b ? 1 : 0;
+        }
+
+        if (result == 0)
+            result = lhs.getNote() < rhs.getNote() ? -1 : lhs.getNote() > rhs.getNote() ? 1 : 0;
+        return sortForwards ? result : -result;
+    }
+
+    /** Returns the first row that doesn't sort before the sample */
+    int lowerBound (const Sample& sample) const
+    {
+        int first = 0, last = rows.size();
+        while (first < last)
+        {
+            const int middle = (first + last) / 2;
+            if (compareRows (rows.getReference (middle), sample) < 0)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        return first;
+    }
+
+    /** Finds a row by comparing trees, for when its sort position may be stale */
+    int findRow (const Sample& sample) const
+    {
+        for (int i = 0; i < rows.size(); ++i)
+            if (rows.getReference(i).getValueTree() == sample.getValueTree())
+                return i;
+        return -1;
+    }
+
+    void sortRows()
+    {
+        // in place, the note tie break makes a stable sort unnecessary
+        struct Sorter
+        {
+            const SampleTable& table;
+            int compareElements (const Sample& lhs, const Sample& rhs) const { return table.compareRows (lhs, rhs); }
+        } sorter { *this };
+        rows.sort (sorter);
+    }
+
+    int insertRow (const Sample& sample)
+    {
+        int index = lowerBound (sample);
+        while (index < rows.size() && compareRows (rows.getReference (index), sample) == 0)
+            ++index;
+        rows.insert (index, sample);
+        return index;
+    }
+
+    void repaintRows (int first, int last)
+    {
+        const int height = jmax (1, getRowHeight());
+        const int firstVisible = getViewport()->getViewPositionY() / height;
+        const int lastVisible  = firstVisible + getViewport()->getViewHeight() / height + 1;
+        for (int i = jmax (first, firstVisible); i <= jmin (last, lastVisible); ++i)
+            repaintRow (i);
+    }
+
+    void sampleInserted (const Sample& sample)
+    {
+        if (! isInLayer (sample))
+            return;
+        const int row = insertRow (sample);
+        updateContent();
+        repaintRows (row, rows.size() - 1);
+        if (sample.hasProperty (Tags::loudness))
+            triggerAsyncUpdate();
+        selectActiveSample();
+    }
+
+    void sampleErased (const Sample& sample)
+    {
+        int row = indexOf (sample);
+        if (row < 0)
+            row = findRow (sample);
+        if (row < 0)
+            return;
+
+        rows.remove (row);
+        updateContent();
+        repaintRows (row, rows.size());
+        triggerAsyncUpdate();
+        selectActiveSample();
+    }
+
+    void samplesChanged (const ProjectWatcher::Delta& delta)
+    {
+        if (delta.samples.isEmpty())
+            return;
+
+        // samples moved to or from the active layer
+        if (delta.hasChanged (Tags::set))
+        {
+            for (const auto& tree : delta.samples)
+            {
+                const Sample sample (tree);
+                const int row = findRow (sample);
+                if (row >= 0 && ! isInLayer (sample))
+                    sampleErased (sample);
+                else if (row < 0 && isInLayer (sample) && tree.getParent().isValid())
+                    sampleInserted (sample);
+            }
+        }
+
+        bool resort = false;
+        for (const auto& property : delta.properties)
+            resort = resort || isSortedBy (property);
+
+        if (resort && delta.samples.size() > 16)
+        {
+            // cheaper to sort a batch in place than to move rows one by one
+            sortRows();
+            repaint();
+            selectActiveSample();
+        }
+        else if (resort)
+        {
+            // take all changed rows out first so the others are in order again
+            Array<Sample> moved;
+            int first = rows.size(), last = 0;
+            for (const auto& tree : delta.samples)
+            {
+                const int row = findRow (Sample (tree));
+                if (row < 0)
+                    continue;
+                moved.add (rows.removeAndReturn (row));
+                first = jmin (first, row);
+                last  = jmax (last, row);
+            }
+
+            for (const auto& sample : moved)
+            {
+                const int row = insertRow (sample);
+                first = jmin (first, row);
+                last  = jmax (last, row);
+            }
+
+            if (! moved.isEmpty())
+            {
+                repaintRows (first, last);
+                selectActiveSample();
+            }
+        }
+        else
+        {
+            for (const auto& tree : delta.samples)
+            {
+                const int row = indexOf (Sample (tree));
+                if (row >= 0)
+                    repaintRow (row);
+            }
+        }
+
+        if (delta.hasChanged (Tags::loudness))
+            refreshMedianLoudness();
+    }
+
+    void refreshMedianLoudness()
+    {
+        const double lastMedian = medianLoudness;
+        updateMedianLoudness();
+        if (lastMedian != medianLoudness)
+            repaint();
+    }
+
+    void updateMedianLoudness()
+    {
+        levels.clearQuick();
+        for (const auto& sample : rows)
+            if (sample.hasProperty (Tags::loudness))
+                levels.add (sample.getProperty (Tags::loudness));
+        levels.sort();
+        medianLoudness = levels.isEmpty() ? 0.0 : levels [levels.size() / 2];
+    }
+
+    bool isFlagged (const Sample& sample, int columnId) const
+    {
+        if (! sample.hasProperty (Tags::analyzed))
+            return false;
+
+        switch (columnId)
+        {
+            case CentsColumn:
+                return (double) sample.getProperty (Tags::fundamental, 0.0) > 0.0 &&
+                    std::abs ((double) sample.getProperty (Tags::cents)) > maxCents;
+            case LoudnessColumn:
+                return std::abs ((double) sample.getProperty (Tags::loudness) - medianLoudness) > maxLoudnessJump;
+            case PeakColumn:
+                return (double) sample.getProperty (Tags::peak) >= maxPeak;
+        }
+
+        return false;
+    }
+
+    void handleAsyncUpdate() override
+    {
+        refreshMedianLoudness();
+    }
 };
 
 class SamplesTableContentView::Content : public Component
@@ -0,0 +1,57 @@
+#include "Tests.h"
+#include "engine/EngineStats.h"
+
+namespace vcp {
+
+class EngineStatsTests : public UnitTestBase
+{
+public:
+    EngineStatsTests() : UnitTestBase ("Engine Stats", "engine", "engineStats") {}
+
+    void runTest() override
+    {
+        beginTest ("time bins");
+        expectEquals (EngineStats::getTimeBin (0.5), 0);
+        expectEquals (EngineStats::getTimeBin (1000.0), 40);
+        expectEquals (EngineStats::getTimeBin (1e12), (int) EngineStats::numTimeBins - 1);
+        expectWithinAbsoluteError (EngineStats::getTimeBinEdge (40), 1.024, 1e-9);
+        for (const double micros : { 3.0, 250.0, 11000.0 })
+            expect (EngineStats::getTimeBinEdge (EngineStats::getTimeBin (micros)) * 1000.0 >= micros);
+
+        beginTest ("percentiles");
+        EngineStats::Histogram histogram;
+        histogram.counts.addArray ({ 90, 0, 9, 1 });
+        histogram.total = 100;
+        expectEquals (histogram.getPercentileBin (0.5), 0);
+        expectEquals (histogram.getPercentileBin (0.95), 2);
+        expectEquals (histogram.getPercentileBin (1.0), 3);
+
+        beginTest ("cycles");
+        EngineStats stats;
+        for (int i = 0; i < 10; ++i)
+        {
+            EngineStats::Cycle cycle (stats, 512, 44100.0);
+            cycle.lap (EngineStats::midi);
+            cycle.setWriterFill (0.3f, i == 3);
+            cycle.lap (EngineStats::writer);
+        }
+
+        auto snapshot = stats.getSnapshot();
+        expectEquals (snapshot.numCycles, (int64) 10);
+        expectEquals (snapshot.numWriterOverflows, (int64) 1);
+        expectEquals (snapshot.blockSize, 512);
+        expectEquals (snapshot.total.histogram.total, (int64) 10);
+        expectEquals (snapshot.writerFill.counts[3], (int64) 10);
+
+        const auto json = JSON::parse (snapshot.toJSON());
+        expectEquals ((int) json["cycles"], 10);
+        expect (json["stages"]["writer"]["histogram"].isArray());
+
+        stats.reset();
+        expectEquals (stats.getSnapshot().numCycles, (int64) 0);
+    }
+};
+
+static EngineStatsTests sEngineStatsTests;
+
+}
@@ -0,0 +1,92 @@
+#include "Tests.h"
+#include "exporters/InstrumentContainer.h"
+
+namespace vcp {
+
+class InstrumentContainerTests : public UnitTestBase
+{
+public:
+    InstrumentContainerTests() : UnitTestBase ("Instrument Container", "exporters", "instrumentContainer") {}
+
+    void runTest() override
+    {
+        for (const bool interleaved : { false, true })
+        {
+            beginTest (interleaved ? "interleaved" : "planar");
+            testRoundTrip (ContainerFormat::Int16, interleaved, 1.0f / 32768.f);
+            testRoundTrip (ContainerFormat::Float32, interleaved, 0.f);
+        }
+    }
+
+private:
+    static float getValue (int channel, int64 frame)
+    {
+        return static_cast<float> ((frame % 1000) / 2000.0) * (channel == 0 ? 1.f : -1.f);
+    }
+
+    void testRoundTrip (int encoding, bool interleaved, float tolerance)
+    {
+        Array<ContainerWriter::RegionInfo> infos;
+        for (int i = 0; i < 3; ++i)
+        {
+            ContainerWriter::RegionInfo info;
+            info.name       = String ("region") + String (i);
+            info.note       = 36 + i * 4;
+            info.lowKey     = info.note - 2;
+            info.highKey    = info.note + 1;
+            info.numFrames  = 10000 + i * 777;
+            info.loopStart  = 100;
+            info.loopEnd    = 9000;
+            infos.add (info);
+        }
+
+        TemporaryFile temp (".vcpi");
+        {
+            std::unique_ptr<FileOutputStream> stream (temp.getFile().createOutputStream());
+            ContainerWriter writer (*stream, infos, encoding, interleaved);
+            expect (writer.begin ("Test").wasOk());
+
+            AudioSampleBuffer block (2, 1000);
+            for (const auto& info : infos)
+            {
+                expect (writer.beginRegion().wasOk());
+                for (int64 frame = 0; frame < info.numFrames; frame += block.getNumSamples())
+                {
+                    for (int c = 0; c < 2; ++c)
+                        for (int i = 0; i < block.getNumSamples(); ++i)
+                            block.setSample (c, i, getValue (c, frame + i));
+                    expect (writer.writeFrames (block.getArrayOfReadPointers(), block.getNumSamples()));
+                }
+                expect (writer.endRegion().wasOk());
+            }
+            expect (writer.finish().wasOk());
+        }
+
+        ContainerReader reader;
+        expect (reader.open (temp.getFile()).wasOk());
+        expectEquals (reader.getNumRegions(), infos.size());
+        expectEquals (reader.getName(), String ("Test"));
+
+        const uint32* indexes = nullptr;
+        expectEquals (reader.getRegionsFor (41, 100, indexes), 1);
+        expectEquals ((int) indexes[0], 1);
+        expectEquals (reader.getRegionsFor (80, 100, indexes), 0);
+
+        const auto* const region = reader.getRegion (2);
+        expect (region->dataOffset % ContainerFormat::pageSize == 0);
+        expectEquals ((int) region->numFrames, 10000 + 2 * 777);
+        expectEquals ((int) region->loopEnd, 9000);
+
+        AudioSampleBuffer audio (2, 2000);
+        expectEquals (reader.read (2, 11000, audio, 0, 2000), 554);
+        float error = 0.f;
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < 554; ++i)
+                error = jmax (error, std::abs (audio.getSample (c, i) - getValue (c, 11000 + i)));
+        expectLessOrEqual (error, tolerance);
+    }
+};
+
+static InstrumentContainerTests sInstrumentContainerTests;
+
+}
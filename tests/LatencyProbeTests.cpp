@@ -0,0 +1,49 @@
+#include "Tests.h"
+#include "engine/LatencyProbe.h"
+
+namespace vcp {
+
+class LatencyProbeTests : public UnitTestBase
+{
+public:
+    LatencyProbeTests() : UnitTestBase ("Latency Probe", "engine", "latencyProbe") {}
+    
+    void runTest() override
+    {
+        beginTest ("sequence");
+        Array<float> sequence;
+        LatencyProbe::createMaximumLengthSequence (12, sequence);
+        expect (sequence.size() == 4095);
+        float sum = 0.f;
+        for (const auto& value : sequence)
+            sum += value;
+        expect (sum == 1.f, "sequence should have one more 1 than -1");
+
+        beginTest ("loopback offset");
+        const int delay = 1234;
+        Array<float> signal;
+        signal.insertMultiple (0, 0.f, delay + sequence.size() + 500);
+        Random random (1);
+        for (int i = 0; i < signal.size(); ++i)
+            signal.set (i, 0.01f * (random.nextFloat() - 0.5f));
+        for (int i = 0; i < sequence.size(); ++i)
+            signal.set (delay + i, signal[delay + i] + 0.25f * sequence[i]);
+        expectEquals (LatencyProbe::findOffset (signal.getRawDataPointer(), signal.size(),
+                                                sequence.getRawDataPointer(), sequence.size()), delay);
+
+        beginTest ("no loopback");
+        for (int i = 0; i < signal.size(); ++i)
+            signal.set (i, 0.01f * (random.nextFloat() - 0.5f));
+        expectEquals (LatencyProbe::findOffset (signal.getRawDataPointer(), signal.size(),
+                                                sequence.getRawDataPointer(), sequence.size()), -1);
+
+        beginTest ("onset");
+        for (int i = 0; i < signal.size(); ++i)
+            signal.set (i, i >= 300 ? 0.5f : 0.001f);
+        expectEquals (LatencyProbe::findOnset (signal.getRawDataPointer(), signal.size(), 0.01f, 100), 300);
+    }
+};
+
+static LatencyProbeTests sLatencyProbeTests;
+
+}
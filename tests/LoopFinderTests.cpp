@@ -0,0 +1,42 @@
+#include "Tests.h"
+#include "analysis/LoopFinder.h"
+
+namespace vcp {
+
+class LoopFinderTests : public UnitTestBase
+{
+public:
+    LoopFinderTests() : UnitTestBase ("Loop Finder", "analysis", "loopFinder") {}
+    
+    void runTest() override
+    {
+        const double sampleRate = 44100.0;
+        const int period = 100; // 441 Hz
+        AudioSampleBuffer audio (2, 2 * 44100);
+        for (int i = 0; i < audio.getNumSamples(); ++i)
+        {
+            const double phase = MathConstants<double>::twoPi * i / period;
+            const float value = static_cast<float> (0.5 * std::sin (phase) + 0.2 * std::sin (2.0 * phase + 0.3));
+            audio.setSample (0, i, value);
+            audio.setSample (1, i, value);
+        }
+
+        beginTest ("periodic");
+        const auto loop = LoopFinder::find (audio, sampleRate, 0, audio.getNumSamples());
+        expect (loop.isValid());
+        expect (loop.end - loop.start >= 11025, "loop should be at least the minimum length");
+        expectEquals (static_cast<int> ((loop.end - loop.start) % period), 0);
+        expect (loop.score > 0.95f);
+
+        beginTest ("too short");
+        expect (! LoopFinder::find (audio, sampleRate, 0, 4000).isValid());
+
+        beginTest ("silence");
+        audio.clear();
+        expect (! LoopFinder::find (audio, sampleRate, 0, audio.getNumSamples()).isValid());
+    }
+};
+
+static LoopFinderTests sLoopFinderTests;
+
+}
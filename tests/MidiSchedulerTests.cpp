@@ -0,0 +1,61 @@
+#include "Tests.h"
+#include "engine/MidiScheduler.h"
+
+namespace vcp {
+
+class MidiSchedulerTests : public UnitTestBase
+{
+public:
+    MidiSchedulerTests() : UnitTestBase ("MIDI Scheduler", "engine", "midiScheduler") {}
+
+    void runTest() override
+    {
+        beginTest ("clock follows drift through callback jitter");
+        {
+            // audio clock 50 ppm fast, callbacks up to a millisecond late
+            const double sampleRate = 48000.0;
+            const double ratio = 1.00005;
+            const int blockSize = 256;
+            Random random (1234);
+            MidiScheduler::Clock clock;
+            clock.reset (sampleRate);
+
+            // the estimate sits on the mean callback delay, only the spread matters.
+            // The jitter moves the rate of single blocks by more than the drift,
+            // so the rate is averaged once the loop has settled
+            int64 frame = 0;
+            double worst = 0.0, ratioSum = 0.0;
+            int numRatios = 0;
+            for (int i = 0; i < 8000; ++i, frame += blockSize)
+            {
+                const double trueTime = 5000.0 + 1000.0 * frame / (sampleRate * ratio);
+                clock.update (frame, trueTime + random.nextDouble());
+                if (i >= 2000)
+                {
+                    worst = jmax (worst, std::abs (clock.getTime (frame) - trueTime - 0.5));
+                    ratioSum += clock.getRatio();
+                    ++numRatios;
+                }
+            }
+
+            expect (clock.isLocked());
+            expect (worst < 0.25, String (worst));
+            expectWithinAbsoluteError (ratioSum / numRatios, ratio, 1e-5);
+        }
+
+        beginTest ("clock restarts after a gap");
+        {
+            MidiScheduler::Clock clock;
+            clock.reset (44100.0);
+            clock.update (0, 100.0);
+            clock.update (512, 100.0 + 1000.0 * 512 / 44100.0);
+            clock.update (1024, 900.0);
+            expectWithinAbsoluteError (clock.getTime (1024), 900.0, 1e-9);
+            expectWithinAbsoluteError (clock.getRatio(), 1.0, 1e-9);
+        }
+    }
+};
+
+static MidiSchedulerTests sMidiSchedulerTests;
+
+}
@@ -0,0 +1,62 @@
+#include "Tests.h"
+#include "engine/OutputMeter.h"
+
+namespace vcp {
+
+class OutputMeterTests : public UnitTestBase
+{
+public:
+    OutputMeterTests() : UnitTestBase ("Output Meter", "engine", "outputMeter") {}
+
+    void runTest() override
+    {
+        beginTest ("measure");
+        {
+            HeapBlock<float> data (37);
+            for (int i = 0; i < 37; ++i)
+                data[i] = (i % 2 == 0) ? 0.5f : -0.5f;
+            data[20] = -1.25f;
+            double squares = 0.0;
+            int clips = 0;
+            expectEquals (OutputMeter::measure (data, 37, squares, clips), 1.25f);
+            expectEquals (clips, 1);
+            expectWithinAbsoluteError (squares, 36 * 0.25 + 1.5625, 1e-6);
+        }
+
+        beginTest ("windows");
+        OutputMeter meter;
+        meter.prepare (44100.0);
+        expect (! meter.read (window));
+
+        // a single sample peak in a stream of tiny blocks is kept
+        AudioSampleBuffer audio (3, 16);
+        for (int block = 0; block < 100; ++block)
+        {
+            audio.clear();
+            FloatVectorOperations::fill (audio.getWritePointer (0), 0.25f, 16);
+            if (block == 37)
+                audio.setSample (2, 5, 0.9f);
+            meter.process (audio.getArrayOfReadPointers(), 3, 16);
+        }
+
+        expect (meter.read (window));
+        expectEquals (window.numChannels, 3);
+        expectEquals (window.peak[0], 0.25f);
+        expectWithinAbsoluteError (window.rms[0], 0.25f, 1e-5f);
+        expectEquals (window.peak[1], 0.f);
+        expectEquals (window.peak[2], 0.9f);
+        expect (! meter.read (window));
+        expectEquals (meter.getPeakHold (2), 0.9f);
+        expectEquals (meter.getNumClips (2), 0);
+
+        meter.resetPeaks();
+        expectEquals (meter.getPeakHold (2), 0.f);
+    }
+
+private:
+    OutputMeter::Window window;
+};
+
+static OutputMeterTests sOutputMeterTests;
+
+}
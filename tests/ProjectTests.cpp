@@ -1,4 +1,5 @@
 #include "Tests.h"
+#include "ProjectWatcher.h"
 
 namespace vcp {
 
@@ -14,6 +15,75 @@ public:
         expect (project.getNumSampleSets() == 0);
         expect (project.getFormatType() == FormatType::WAVE);
         expect (project.getFormatTypeSlug() == FormatType::getSlug (project.getFormatType()));
+
+        beginTest ("rigs keep existing samples");
+        {
+            auto rigged = Project::create();
+            rigged.setNotes (60, 60);
+            rigged.addSampleSet();
+            rigged.rebuildSampleList();
+            expectEquals (rigged.getNumSamples(), 1);
+            rigged.getSample(0).setProperty (Tags::loudness, -12.0);
+
+            const auto rig = rigged.addRig();
+            expectEquals (rigged.getNumSamples(), 1);
+            expect (rigged.getSample(0).getRigUuidString() == rig.getUuidString());
+            expect (rigged.getSample(0).hasProperty (Tags::loudness));
+
+            rigged.addRig();
+            expectEquals (rigged.getNumSamples(), 2);
+            rigged.removeRig (1);
+            expectEquals (rigged.getNumSamples(), 1);
+            rigged.removeRig (0);
+            expectEquals (rigged.getNumSamples(), 1);
+            expect (rigged.getSample(0).getRigUuidString().isEmpty());
+            expect (rigged.getSample(0).hasProperty (Tags::loudness));
+        }
+
+        beginTest ("sample notifications");
+        auto samples = project.getValueTree().getOrCreateChildWithName (Tags::samples, nullptr);
+        ProjectWatcher watcher;
+        watcher.setProject (project);
+
+        Array<ValueTree> inserted, erased;
+        watcher.onSampleInserted = [&] (const Sample& s) { inserted.add (s.getValueTree()); };
+        watcher.onSampleErased   = [&] (const Sample& s) { erased.add (s.getValueTree()); };
+
+        ValueTree sample (Tags::sample);
+        samples.appendChild (sample, nullptr);
+        samples.removeChild (sample, nullptr);
+        expect (inserted.size() == 1 && inserted.getFirst() == sample);
+        expect (erased.size() == 1 && erased.getFirst() == sample);
+
+        beginTest ("coalesced changes");
+        int numDeltas = 0, numModified = 0;
+        ProjectWatcher::Delta last;
+        watcher.onDelta = [&] (const ProjectWatcher::Delta& delta) { ++numDeltas; last = delta; };
+        watcher.onProjectModified = [&]() { ++numModified; };
+
+        samples.appendChild (sample, nullptr);
+        {
+            ProjectWatcher::Transaction transaction;
+            {
+                ProjectWatcher::Transaction nested;
+                for (int i = 0; i < 100; ++i)
+                {
+                    sample.setProperty (Tags::timeIn, i * 0.01, nullptr);
+                    sample.setProperty (Tags::timeOut, 2.0 + i * 0.01, nullptr);
+                }
+            }
+            expectEquals (numDeltas, 0);
+        }
+
+        expectEquals (numDeltas, 1);
+        expectEquals (numModified, 1);
+        expectEquals (last.samples.size(), 1);
+        expect (last.hasChanged (sample));
+        expect (! last.hasChanged (ValueTree (Tags::sample)));
+        expect (! last.hasChanged (Tags::note));
+        expect (last.hasChanged (Tags::timeIn) && last.hasChanged (Tags::timeOut));
+        expectEquals (last.properties.size(), 2);
+        expectEquals (last.numChanges, 201);
     }
 };
 
@@ -0,0 +1,56 @@
+#include "Tests.h"
+#include "engine/RenderWorker.h"
+
+namespace vcp {
+
+class RenderWorkerTests : public UnitTestBase
+{
+public:
+    RenderWorkerTests() : UnitTestBase ("Render Worker", "engine", "renderWorker") {}
+
+    void runTest() override
+    {
+        beginTest ("shared ring");
+        TemporaryFile temp (".ring");
+        SharedAudioRing reader, writer;
+        expect (reader.create (temp.getFile(), 2, 64, 4).wasOk());
+        expect (writer.open (temp.getFile()).wasOk());
+        expectEquals (writer.getNumChannels(), 2);
+        expectEquals (writer.getBlockSize(), 64);
+        expect (reader.read() == nullptr);
+
+        AudioSampleBuffer audio (2, 64);
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < 64; ++i)
+                audio.setSample (c, i, static_cast<float> (i) * (c == 0 ? 0.01f : -0.01f));
+
+        // the writing side only sees space the reader released
+        for (int i = 0; i < 4; ++i)
+            expect (writer.write (i, audio.getArrayOfReadPointers(), 2, 64 - i, i == 3 ? SharedAudioRing::LastBlock : 0));
+        expect (! writer.write (4, audio.getArrayOfReadPointers(), 2, 64, 0));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const auto* block = reader.read();
+            expect (block != nullptr);
+            expectEquals ((int) block->job, i);
+            expectEquals ((int) block->numFrames, 64 - i);
+            expect (((block->flags & SharedAudioRing::LastBlock) != 0) == (i == 3));
+            expectEquals (reader.getChannel (*block, 0)[10], audio.getSample (0, 10));
+            expectEquals (reader.getChannel (*block, 1)[63 - i], audio.getSample (1, 63 - i));
+            reader.finishedRead();
+        }
+
+        expect (reader.read() == nullptr);
+        expect (writer.write (5, audio.getArrayOfReadPointers(), 1, 64, 0));
+        expectEquals (reader.read()->job, 5);
+        expectEquals (reader.getChannel (*reader.read(), 1)[20], 0.f);
+
+        writer.close();
+        reader.close();
+    }
+};
+
+static RenderWorkerTests sRenderWorkerTests;
+
+}
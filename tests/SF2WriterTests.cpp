@@ -0,0 +1,73 @@
+#include "Tests.h"
+#include "exporters/SF2Writer.h"
+
+namespace vcp {
+
+class SF2WriterTests : public UnitTestBase
+{
+public:
+    SF2WriterTests() : UnitTestBase ("SF2 Writer", "exporters", "sf2Writer") {}
+
+    void runTest() override
+    {
+        TemporaryFile temp (".sf2");
+        const int numFrames = 1000;
+
+        {
+            std::unique_ptr<FileOutputStream> stream (temp.getFile().createOutputStream());
+            SF2Writer sf2 (*stream);
+            expect (sf2.begin ("Test Bank").wasOk());
+
+            HeapBlock<int16> data (numFrames, true);
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                sf2.beginSample (channel == 0 ? "left" : "right", 48000.0, 60);
+                for (int i = 0; i < 4; ++i)
+                    sf2.writeSampleData (data, numFrames / 4);
+                sf2.endSample (100, 900);
+            }
+
+            sf2.linkSamples (0, 1);
+            SF2Writer::Zone zone;
+            zone.sampleIndex = 0;   zone.pan = -500;    sf2.addZone (zone);
+            zone.sampleIndex = 1;   zone.pan = 500;     sf2.addZone (zone);
+            expect (sf2.finish ("Test Preset").wasOk());
+        }
+
+        MemoryBlock block;
+        expect (temp.getFile().loadFileAsData (block));
+        const auto* const bytes = static_cast<const char*> (block.getData());
+
+        beginTest ("riff");
+        expect (String (bytes, 4) == "RIFF");
+        expect (String (bytes + 8, 4) == "sfbk");
+        expectEquals ((int) ByteOrder::littleEndianInt (bytes + 4), (int) block.getSize() - 8);
+
+        beginTest ("chunks");
+        // walk the three top level lists
+        StringArray lists;
+        int64 smplSize = 0, shdrSize = 0;
+        for (size_t pos = 12; pos + 12 <= block.getSize();)
+        {
+            const auto size = (size_t) ByteOrder::littleEndianInt (bytes + pos + 4);
+            lists.add (String (bytes + pos + 8, 4));
+            for (size_t sub = pos + 12; sub + 8 <= pos + 8 + size;)
+            {
+                const auto subSize = (size_t) ByteOrder::littleEndianInt (bytes + sub + 4);
+                const String id (bytes + sub, 4);
+                if (id == "smpl") smplSize = (int64) subSize;
+                if (id == "shdr") shdrSize = (int64) subSize;
+                sub += 8 + subSize + (subSize & 1);
+            }
+            pos += 8 + size;
+        }
+
+        expect (lists == StringArray ({ "INFO", "sdta", "pdta" }));
+        expectEquals (smplSize, (int64) (2 * (numFrames + 46) * 2));
+        expectEquals (shdrSize, (int64) (3 * 46));
+    }
+};
+
+static SF2WriterTests sSF2WriterTests;
+
+}
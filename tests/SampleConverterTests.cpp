@@ -0,0 +1,94 @@
+#include "Tests.h"
+#include "engine/SampleConverter.h"
+
+namespace vcp {
+
+class SampleConverterTests : public UnitTestBase
+{
+public:
+    SampleConverterTests() : UnitTestBase ("Sample Converter", "engine", "sampleConverter") {}
+
+    void runTest() override
+    {
+        const int numFrames = 65536;
+        AudioSampleBuffer audio (2, numFrames);
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto value = static_cast<float> (0.5 * std::sin (0.01 * i));
+            audio.setSample (0, i, value);
+            audio.setSample (1, i, -value);
+        }
+
+        HeapBlock<int> block ((size_t) numFrames * 2);
+        int* output[] = { block.get(), block.get() + numFrames };
+        SampleConverter converter;
+
+        beginTest ("quantize");
+        converter.prepare (2, 16, SampleConverter::NoDither);
+        converter.convert (audio.getArrayOfReadPointers(), output, numFrames);
+        int errors = 0;
+        for (int i = 0; i < numFrames; ++i)
+            if (output[0][i] >> 16 != roundToInt (audio.getSample (0, i) * 32768.f))
+                ++errors;
+        expectEquals (errors, 0);
+        expectEquals (output[0][0] & 0xffff, 0);
+
+        beginTest ("clip");
+        audio.setSample (0, 0, 2.f);
+        audio.setSample (1, 0, -2.f);
+        converter.prepare (2, 24, SampleConverter::NoDither);
+        converter.convert (audio.getArrayOfReadPointers(), output, 1);
+        expectEquals (output[0][0] >> 8, 8388607);
+        expectEquals (output[1][0] >> 8, -8388608);
+
+        beginTest ("dither");
+        AudioSampleBuffer dc (1, numFrames);
+        for (int i = 0; i < numFrames; ++i)
+            dc.setSample (0, i, 0.25f / 32768.f);
+        for (const int dither : { (int) SampleConverter::TriangularDither, (int) SampleConverter::ShapedDither })
+        {
+            converter.prepare (1, 16, dither);
+            converter.convert (dc.getArrayOfReadPointers(), output, numFrames);
+            double sum = 0.0;
+            for (int i = 0; i < numFrames; ++i)
+                sum += output[0][i] >> 16;
+            // dither keeps the sub-LSB level on average
+            expectWithinAbsoluteError (sum / numFrames, 0.25, 0.02);
+        }
+
+        beginTest ("benchmark");
+        const int numRuns = 100;
+        converter.prepare (2, 24, SampleConverter::TriangularDither);
+        auto start = Time::getHighResolutionTicks();
+        for (int i = 0; i < numRuns; ++i)
+            converter.convert (audio.getArrayOfReadPointers(), output, numFrames);
+        const double converterTime = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+        // triangular dither stays within one LSB before rounding
+        double worst = 0.0;
+        for (int c = 0; c < 2; ++c)
+            for (int i = 0; i < numFrames; ++i)
+            {
+                const double exact = jlimit (-8388608.0, 8388607.0, 8388608.0 * audio.getSample (c, i));
+                worst = jmax (worst, std::abs ((output[c][i] >> 8) - exact));
+            }
+        expect (worst > 0.0 && worst < 1.6, String (worst));
+
+        using Source = AudioData::Pointer<AudioData::Float32, AudioData::NativeEndian, AudioData::NonInterleaved, AudioData::Const>;
+        using Dest   = AudioData::Pointer<AudioData::Int32, AudioData::NativeEndian, AudioData::NonInterleaved, AudioData::NonConst>;
+        AudioData::ConverterInstance<Source, Dest> reference;
+        start = Time::getHighResolutionTicks();
+        for (int i = 0; i < numRuns; ++i)
+            for (int c = 0; c < 2; ++c)
+                reference.convertSamples (output[c], audio.getReadPointer (c), numFrames);
+        const double referenceTime = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+        const double numSamples = 2.0 * numFrames * numRuns;
+        logMessage (String ("dithered: ") + String (1.0e9 * converterTime / numSamples, 2) + " ns/sample, "
+            + "juce: " + String (1.0e9 * referenceTime / numSamples, 2) + " ns/sample");
+    }
+};
+
+static SampleConverterTests sSampleConverterTests;
+
+}
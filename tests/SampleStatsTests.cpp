@@ -0,0 +1,47 @@
+#include "Tests.h"
+#include "analysis/SampleStats.h"
+
+namespace vcp {
+
+class SampleStatsTests : public UnitTestBase
+{
+public:
+    SampleStatsTests() : UnitTestBase ("Sample Stats", "analysis", "sampleStats") {}
+    
+    void runTest() override
+    {
+        const double sampleRate = 48000.0;
+        AudioSampleBuffer audio (2, 3 * 48000);
+        for (int i = 0; i < audio.getNumSamples(); ++i)
+        {
+            const auto value = static_cast<float> (0.1 * std::sin (MathConstants<double>::twoPi * 1000.0 * i / sampleRate));
+            audio.setSample (0, i, value);
+            audio.setSample (1, i, value);
+        }
+
+        const int64 length = audio.getNumSamples();
+
+        beginTest ("levels");
+        expectWithinAbsoluteError (SampleStats::getPeak (audio, 0, length), -20.f, 0.01f);
+        expectWithinAbsoluteError (SampleStats::getRMS (audio, 0, length), -23.01f, 0.01f);
+
+        beginTest ("loudness");
+        // a 1 kHz sine in both channels reads its peak level in LUFS
+        expectWithinAbsoluteError (SampleStats::getLoudness (audio, sampleRate, 0, length), -20.f, 0.1f);
+
+        beginTest ("pitch");
+        const double fundamental = SampleStats::getFundamental (audio, sampleRate, 0, length);
+        expectWithinAbsoluteError (fundamental, 1000.0, 0.5);
+        expectWithinAbsoluteError (SampleStats::getCents (440.0 * std::pow (2.0, 0.1 / 12.0), 69), 10.0, 0.001);
+        expectWithinAbsoluteError (SampleStats::getCents (880.0, 69), 0.0, 0.001);
+
+        beginTest ("silence");
+        audio.clear();
+        expectEquals (SampleStats::getFundamental (audio, sampleRate, 0, length), 0.0);
+        expectEquals (SampleStats::getNoiseFloor (audio, sampleRate), -120.f);
+    }
+};
+
+static SampleStatsTests sSampleStatsTests;
+
+}
@@ -42,11 +42,20 @@ def check_xmingw (self):
     for l in mingw_libs.split():
         self.check_cxx(lib=l, uselib_store=l.upper())
 
+@conf
+def check_python (self):
+    self.env.VCP_PYTHON = False
+    if not self.options.enable_python:
+        return
+    # embedding needs python3-embed since 3.8
+    if not self.check_cfg (package='python3-embed', uselib_store='PYTHON', args=['--cflags', '--libs'], mandatory=False):
+        self.check_cfg (package='python3', uselib_store='PYTHON', args=['--cflags', '--libs'], mandatory=True)
+    self.env.VCP_PYTHON = True
+    self.define ('VCP_PYTHON', 1)
+
 @conf
 def check_mac (self):
-    # Python scripting
-    if (self.options.enable_python):
-        self.check_cfg(path='python-config', args='--includes', package='Python', use='PYTHON')
+    return
 
 @conf
 def check_linux (self):